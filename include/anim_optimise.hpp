@@ -0,0 +1,52 @@
+//
+// Animation key-frame passes run by the converter before writing
+// First version 17 Oct 2026
+//
+// Exporters such as Blender's bake a key for every frame of every bone. Most
+// of those keys lie on the straight line, or the slerp, between their
+// neighbours and can be removed without changing what is played back.
+// Going the other way, keys can be resampled to a fixed rate so that no
+// search is needed to find them at playback. Clips of the same skeleton often
+// repeat channels, such as bones that never move, and these can be stored
+// once.
+//
+
+#ifndef _ANIM_OPTIMISE_H_
+#define _ANIM_OPTIMISE_H_
+
+#include "mesh_loader.hpp"
+#include <vector>
+
+// largest error allowed when removing keys. rot is in degrees, as -reduce_tol
+// takes it
+struct Key_Tolerances {
+	float tra;
+	float rot;
+	float sca;
+};
+
+//
+// removes every key that interpolating between the kept keys either side of it
+// reproduces to within tol - distance for translation and scale, angle in
+// radians for rotation. the first and last keys are always kept, unless the whole channel
+// stays within tol of its first key, in which case only that key is kept
+void reduce_pos_keys (std::vector<pos_key>& keys, float tol);
+void reduce_rot_keys (std::vector<rot_key>& keys, float tol);
+
+//
+// replaces a channel's keys with keys every 1/rate seconds from 0 to duration,
+// interpolated as the viewer would. the player can then find a key from the
+// time alone. channels with fewer than 2 keys are left as they are
+void resample_pos_keys (std::vector<pos_key>& keys, float rate,
+	double duration);
+void resample_rot_keys (std::vector<rot_key>& keys, float rate,
+	double duration);
+
+//
+// makes channels with the same keys, in one clip or across clips, share one
+// range of the mesh's key pools, and drops the copies. each pool is rebuilt
+// holding every distinct run of keys once. returns the number of ranges that
+// now share keys with another channel
+int share_channels (Mesh* mesh);
+
+#endif
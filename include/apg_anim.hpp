@@ -0,0 +1,141 @@
+//
+// Skeletal animation evaluation, with no graphics dependencies
+// First version 17 Oct 2026
+//
+// An Animation from apg_loader keeps its keys with their times, so finding the
+// keys either side of a time means searching every channel. An
+// Apg_Sampled_Anim instead holds every node's translation, scale and rotation
+// at a fixed rate. The two samples around time t are then at floor (t * rate)
+// and the one after, with no search and no stored times. It is built from a
+// loaded Animation, or the converter's -resample option writes keys at a
+// fixed rate in the first place so that nothing is lost by resampling.
+// Keys can also be found from where the last search left off, with an
+// Apg_Anim_Cursor per playing instance.
+//
+// A pose is evaluated without recursion. An Apg_Skeleton orders the nodes so
+// that every parent comes before its children, then global transforms are
+// built in one forward loop over the parent indices, from local translation,
+// rotation and scale kept as separate arrays.
+//
+// Rotation keys are blended with slerp () unless a clip, or the global
+// setting, asks for nlerp (), which needs no acos () or sin ().
+//
+
+#ifndef _APG_ANIM_H_
+#define _APG_ANIM_H_
+
+#include "apg_loader.hpp"
+
+//
+// ways of blending between two rotation keys. for keys 30 degrees apart nlerp
+// strays from slerp by up to about 0.03 degrees and corrected nlerp by 0.002
+enum Apg_Rot_Interp {
+	APG_ROT_DEFAULT = 0, // use the global setting
+	APG_ROT_SLERP,
+	APG_ROT_NLERP,
+	APG_ROT_NLERP_CORRECTED
+};
+
+// the mode for clips with APG_ROT_DEFAULT. APG_ROT_SLERP to begin with
+void apg_set_rot_interp (Apg_Rot_Interp mode);
+Apg_Rot_Interp apg_get_rot_interp ();
+
+struct Apg_Sampled_Anim {
+	// frame_count * node_count of each. a frame's nodes are stored together
+	vec3* tra;
+	vec3* sca;
+	versor* rot;
+	float rate; // samples per second
+	double duration;
+	int frame_count; // the last frame holds the pose at the end
+	int node_count;
+	int rot_interp; // copied from the Animation. see Apg_Rot_Interp
+};
+
+//
+// local translation, scale and rotation of every node at time t, found by
+// scanning each channel's keys from the start as the viewer does. channels
+// without keys give identity
+void apg_eval_keys (const Animation* anim, double t, vec3* tra, vec3* sca,
+	versor* rot);
+
+// keys a cursor steps forwards through before it binary searches instead
+#define APG_CURSOR_MAX_STEPS 4
+
+//
+// one playing instance's place in an animation: the key each channel last
+// interpolated from. playback that moves forwards in small steps then finds
+// its keys in a step or two however long the animation is. seeks and loops
+// fall back to a binary search. 12 bytes per channel
+struct Apg_Anim_Cursor {
+	int* spans; // tra, sca and rot key of each channel
+	int channel_count;
+};
+
+// a new cursor starts at time 0. a cursor only suits the anim it was made for
+bool apg_init_anim_cursor (const Animation* anim, Apg_Anim_Cursor* cursor);
+void apg_free_anim_cursor (Apg_Anim_Cursor* cursor);
+
+//
+// gives the same results as apg_eval_keys () for any t, searching from where
+// the cursor was left and moving it to t
+void apg_eval_keys_cursor (const Animation* anim, Apg_Anim_Cursor* cursor,
+	double t, vec3* tra, vec3* sca, versor* rot);
+
+// samples anim every 1 / rate seconds, from 0 to its duration. samples are
+// always slerped from the keys, whatever the clip's rot_interp
+bool apg_resample_anim (const Animation* anim, float rate,
+	Apg_Sampled_Anim* sampled);
+void apg_free_sampled_anim (Apg_Sampled_Anim* sampled);
+
+//
+// as apg_eval_keys () but blending the two samples around t. t is clamped to
+// the animation's duration
+void apg_sample_anim (const Apg_Sampled_Anim* sampled, double t, vec3* tra,
+	vec3* sca, versor* rot);
+
+// node hierarchy flattened for evaluation
+struct Apg_Skeleton {
+	// all node_count long, in evaluation order: every parent before its children
+	int* order; // node, i.e. animation channel, at each position
+	int* parents; // position of each node's parent in this order. -1 for roots
+	int* bone_ids; // bone each node drives, or -1
+	int node_count;
+};
+
+//
+// local and global transforms of every node. tra, sca and rot are indexed by
+// node as apg_eval_keys () and apg_sample_anim () fill them. globals are in
+// skeleton order, as affine 3x4 matrices
+struct Apg_Pose {
+	vec3* tra;
+	vec3* sca;
+	versor* rot;
+	mat3x4* globals;
+	int node_count;
+};
+
+//
+// node_parents gives each node's parent, or -1, as stored in an Apg_Mesh.
+// node_bone_ids, which may be NULL, gives each node's bone, or -1. fails if a
+// parent or bone is out of range or the parents form a loop
+bool apg_init_skeleton (const int* node_parents, const int* node_bone_ids,
+	int node_count, int bone_count, Apg_Skeleton* skeleton);
+void apg_free_skeleton (Apg_Skeleton* skeleton);
+
+bool apg_alloc_pose (int node_count, Apg_Pose* pose);
+void apg_free_pose (Apg_Pose* pose);
+
+//
+// builds each node's transform, translation * rotation * scale, straight from
+// the local values and multiplies it onto its parent's global transform
+void apg_pose_globals (const Apg_Skeleton* skeleton, Apg_Pose* pose);
+
+//
+// skinning matrix of every bone: root * global * offset. palette is indexed
+// by bone id. bones no node drives are left as they are. convert mat4s with
+// mat3x4_from_mat4 () once, at load
+void apg_pose_palette (const Apg_Skeleton* skeleton, const Apg_Pose* pose,
+	const mat3x4& root_transform, const mat3x4* offset_mats, mat3x4* palette);
+
+#endif
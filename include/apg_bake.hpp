@@ -0,0 +1,78 @@
+//
+// Baked skinning palettes for constant-time playback of fixed loops
+// First version 17 Oct 2026
+//
+// A baked clip holds the final skinning palette of every bone - root * global
+// * offset, as apg_pose_palette () gives it - sampled at a fixed rate. Playing
+// it fetches the two palettes around t and blends them value by value, with no
+// keys to find and no hierarchy to walk, so the cost per frame is the same
+// whatever the skeleton's depth or the clip's key count.
+//
+// Blending matrices rather than rotations shrinks a bone slightly between
+// samples when it turns fast, so the error falls as the rate goes up and the
+// table grows with it: bone_count * sample_count * 48 bytes, or 24 bytes
+// quantised to 16 bits. apg_baked_error () measures what a rate costs in
+// accuracy. The converter's -bake option writes a table for every clip, and
+// apg_init_rig () picks them up so a crowd plays those clips from the table.
+//
+
+#ifndef _APG_BAKE_H_
+#define _APG_BAKE_H_
+
+#include "apg_anim.hpp"
+
+// floats in one baked matrix: a mat3x4
+#define APG_BAKED_COMPS 12
+
+struct Apg_Baked_Clip {
+	// sample_count * bone_count matrices, a sample's bones together. a table is
+	// float or 16-bit, so one of these is set
+	const mat3x4* palettes;
+	const uint16_t* packed;
+	// for packed tables: the smallest then the largest value each of the 12
+	// components takes over the table
+	float range[APG_BAKED_COMPS * 2];
+	float rate; // samples per second
+	double duration;
+	int sample_count; // the last holds the palette at the end
+	int bone_count;
+	void* owned; // the table, if this clip allocated it. NULL if it is mapped
+};
+
+//
+// evaluates anim every 1 / rate seconds from 0 to its duration and keeps each
+// bone's palette. bones no node drives are identity
+bool apg_bake_clip (const Animation* anim, const Apg_Skeleton* skeleton,
+	const mat3x4& root_transform, const mat3x4* offset_mats, int bone_count,
+	float rate, Apg_Baked_Clip* baked);
+// a 16-bit copy of a float table, each component scaled into its range
+bool apg_quantise_baked_clip (const Apg_Baked_Clip* in, Apg_Baked_Clip* out);
+void apg_free_baked_clip (Apg_Baked_Clip* baked);
+
+//
+// points at the table a binary file holds for animation anim. false if the
+// mesh is not a mapped binary file or has no table for it
+bool apg_get_baked_clip (const Apg_Mesh* mesh, int anim,
+	Apg_Baked_Clip* baked);
+
+// bytes the table takes
+size_t apg_baked_size (const Apg_Baked_Clip* baked);
+
+//
+// every bone's palette at time t, blended from the two samples around it. t is
+// clamped to the clip's duration. uses SSE2 unless MATHS_NO_SIMD is defined.
+// apg_sample_baked_scalar () is the reference, giving the same results
+void apg_sample_baked (const Apg_Baked_Clip* baked, double t,
+	mat3x4* palette);
+void apg_sample_baked_scalar (const Apg_Baked_Clip* baked, double t,
+	mat3x4* palette);
+
+//
+// the furthest any point within radius of the mesh's origin is skinned from
+// where the keys put it, checked at every sample and at steps - 1 times
+// between each pair. an upper bound, taken from each bone's matrix difference
+float apg_baked_error (const Apg_Baked_Clip* baked, const Animation* anim,
+	const Apg_Skeleton* skeleton, const mat3x4& root_transform,
+	const mat3x4* offset_mats, float radius, int steps);
+
+#endif
@@ -0,0 +1,124 @@
+//
+// Shared benchmark helpers
+// First version 17 Oct 2026
+//
+// Timing, argument and random number helpers, and a synthetic clip factory,
+// for the bench_ programs. Include from the one file of a benchmark's main ()
+// only: it defines my_argc and my_argv, which main () sets for check_arg ()
+//
+
+#ifndef _APG_BENCH_H_
+#define _APG_BENCH_H_
+
+#include "apg_loader.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+// bench_make_clip () options
+#define BENCH_CLIP_JITTER 1 // key times off the 1/30 grid, as if hand-keyed
+#define BENCH_CLIP_SCALE 2 // a scale channel on every fourth node
+
+int my_argc;
+char** my_argv;
+
+inline double bench_time_ms () {
+	return std::chrono::duration<double, std::milli> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+// index of str in the command line, or -1
+inline int check_arg (const char* str) {
+	for (int i = 0; i < my_argc; i++) {
+		if (strcmp (str, my_argv[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+inline float bench_rand_range (float lo, float hi) {
+	return lo + rand () / (float)RAND_MAX * (hi - lo);
+}
+
+inline versor bench_rand_versor () {
+	versor q;
+
+	for (int i = 0; i < 4; i++) {
+		q.q[i] = bench_rand_range (-1.0f, 1.0f);
+	}
+	return normalise_scalar (q);
+}
+
+//
+// smooth translation and rotation curves keyed 30 times a second, the last key
+// at 'seconds'. seed varies the curves so clips differ, and translation is
+// within about tra_size of the rest pose. jitter draws on rand (), so seed
+// srand () first for a repeatable clip
+inline bool bench_make_clip (int nodes, double seconds, int seed,
+	float tra_size, int options, Animation* anim) {
+	int keys = (int)(seconds * 30.0) + 1;
+
+	memset (anim, 0, sizeof (Animation));
+	sprintf (anim->name, "clip%i", seed);
+	anim->duration = seconds;
+	anim->num_channels = nodes;
+	anim->channels = (Channel*)calloc (nodes, sizeof (Channel));
+	if (!anim->channels) {
+		fprintf (stderr, "ERROR: allocating %i channels\n", nodes);
+		return false;
+	}
+	for (int i = 0; i < nodes; i++) {
+		Channel* c = &anim->channels[i];
+		bool sca = (options & BENCH_CLIP_SCALE) && 0 == i % 4;
+
+		c->tra_keys = (TraAnimKey*)malloc (keys * sizeof (TraAnimKey));
+		c->rot_keys = (RotAnimKey*)malloc (keys * sizeof (RotAnimKey));
+		if (sca) {
+			c->sca_keys = (ScaAnimKey*)malloc (keys * sizeof (ScaAnimKey));
+		}
+		if (!c->tra_keys || !c->rot_keys || (sca && !c->sca_keys)) {
+			fprintf (stderr, "ERROR: allocating %i keys\n", keys);
+			return false;
+		}
+		c->tra_keys_count = keys;
+		c->rot_keys_count = keys;
+		c->sca_keys_count = sca ? keys : 0;
+		for (int k = 0; k < keys; k++) {
+			float t = k < keys - 1 ? (float)(k / 30.0) : (float)seconds;
+			versor q;
+
+			if ((options & BENCH_CLIP_JITTER) && k > 0 && k < keys - 1) {
+				t += bench_rand_range (-0.01f, 0.01f);
+			}
+			c->tra_keys[k].time = t;
+			c->tra_keys[k].tra = vec3 (sinf (t + i + seed), 0.5f,
+				cosf (t * 0.5f)) * tra_size;
+			q.q[0] = 1.0f;
+			q.q[1] = sinf (t * 0.7f + i) * 0.5f;
+			q.q[2] = cosf (t * 1.3f + seed) * 0.5f;
+			q.q[3] = sinf (t * 2.1f) * 0.2f;
+			c->rot_keys[k].time = t;
+			c->rot_keys[k].rot = normalise (q);
+			if (sca) {
+				c->sca_keys[k].time = t;
+				c->sca_keys[k].sca = vec3 (1.0f, 1.0f + sinf (t) * 0.2f, 1.0f);
+			}
+		}
+	}
+	return true;
+}
+
+// frees a clip from bench_make_clip (), also after it fails part way
+inline void bench_free_clip (Animation* anim) {
+	for (int i = 0; i < anim->num_channels; i++) {
+		free (anim->channels[i].tra_keys);
+		free (anim->channels[i].sca_keys);
+		free (anim->channels[i].rot_keys);
+	}
+	free (anim->channels);
+}
+
+#endif
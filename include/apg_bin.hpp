@@ -0,0 +1,223 @@
+//
+// Binary .apg container format
+// First version 17 Oct 2026
+//
+// Layout of a binary .apg file:
+//
+//   Apg_Bin_Header        fixed-size header at byte 0
+//   Apg_Bin_Section[n]    section directory at header.directory_offset
+//   section payloads      each one starting on an APG_BIN_ALIGN boundary
+//
+// Every payload is a tightly-packed array of 'count' elements, each of
+// 'comps' components of 'type'. Because payloads are aligned, a reader can
+// map the whole file into memory and point straight into it - there is no
+// parsing and no intermediate copy. All values are little-endian.
+//
+// Vertex sections may instead be stored quantised, given by the section's
+// 'encoding'. 'type' and 'comps' then describe the stored values, and
+// apg_bin_decode() turns them back into floats.
+//
+
+#ifndef _APG_BIN_H_
+#define _APG_BIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define APG_BIN_MAGIC "APGB"
+// version 2 lets clips share key sections, so readers of version 1 must not
+// open it. apg_bin_validate () accepts APG_BIN_MIN_VERSION to APG_BIN_VERSION
+#define APG_BIN_VERSION 2
+#define APG_BIN_MIN_VERSION 1
+// alignment of every section payload in bytes. enough for SSE loads
+#define APG_BIN_ALIGN 16
+
+// element types
+#define APG_TYPE_U8 1
+#define APG_TYPE_I16 2
+#define APG_TYPE_U16 3
+#define APG_TYPE_I32 4
+#define APG_TYPE_U32 5
+#define APG_TYPE_F32 6
+#define APG_TYPE_F64 7
+
+// section ids. per-animation sections use 'index' to give the animation number
+#define APG_SECTION_VP 1 // f32 positions
+#define APG_SECTION_VN 2 // f32 normals
+#define APG_SECTION_VT 3 // f32 texture coordinates
+#define APG_SECTION_VTAN 4 // f32 tangents with determinant in w
+#define APG_SECTION_VB 5 // i32 bone ids, or u8 x APG_BONE_INFLUENCES
+// f32 bone weights, or u8 x APG_BONE_INFLUENCES as APG_ENCODING_UNORM8
+#define APG_SECTION_VW 6
+#define APG_SECTION_INDICES 7 // u16 or u32 vertex indices. 3 per triangle
+// f32 x 6: min xyz then max xyz of positions stored as APG_ENCODING_AABB16
+#define APG_SECTION_VP_BOUNDS 8
+#define APG_SECTION_ROOT_TRANSFORM 16 // f32 x 16. column-order
+#define APG_SECTION_OFFSET_MATS 17 // f32 x 16 per bone. column-order
+#define APG_SECTION_NODE_PARENTS 18 // i32 parent node per node. -1 for root
+#define APG_SECTION_NODE_BONE_IDS 19 // i32 bone per node. -1 if not a bone
+#define APG_SECTION_ANIM_NAME 32 // u8 nul-terminated string
+#define APG_SECTION_ANIM_DURATION 33 // f64 x 1. seconds
+// i32 x 6 per node: first and count of tra, sca, and rot keys for that node
+#define APG_SECTION_ANIM_CHANNELS 34
+#define APG_SECTION_TRA_KEYS 35 // f32 x 4 per key: t x y z
+#define APG_SECTION_SCA_KEYS 36 // f32 x 4 per key: t x y z
+#define APG_SECTION_ROT_KEYS 37 // f32 x 5 per key: t w x y z
+// an animation with no key section of its own at its index uses the one at
+// index 0, so clips can share keys. version 2 and later
+// f32 x 12 per bone per sample: the skinning palette as mat3x4 rows, samples
+// one after another. or u16 x 12 as APG_ENCODING_RANGE16. see apg_bake.hpp
+#define APG_SECTION_BAKED_PALETTES 38
+// f32 x 24: smallest then largest value of each component of a RANGE16 table
+#define APG_SECTION_BAKED_RANGE 39
+#define APG_SECTION_BAKED_RATE 40 // f32 x 1. samples per second
+
+// section encodings
+#define APG_ENCODING_NONE 0 // values stored as 'type'
+// u16 per comp. 0 is the minimum and 65535 the maximum of APG_SECTION_VP_BOUNDS
+#define APG_ENCODING_AABB16 1
+#define APG_ENCODING_UNORM16 2 // u16 per comp. value / 65535
+#define APG_ENCODING_HALF 3 // u16 per comp holding IEEE half-precision bits
+// i16 x 2. unit vector in octahedral mapping, as snorm. decodes to xyz
+#define APG_ENCODING_OCT16 4
+// u32 x 1. xyz snorm10 in bits 0-29, w as a signed 2-bit int in bits 30-31, as
+// in GL_INT_2_10_10_10_REV. decodes to xyzw
+#define APG_ENCODING_10_10_10_2 5
+// u16 x 4 per rotation key. time as a fraction of the animation duration, then
+// the versor in smallest-three form. decodes to t w x y z
+#define APG_ENCODING_SMALLEST3 6
+#define APG_ENCODING_UNORM8 7 // u8 per comp. value / 255
+// u16 per comp. 0 is the minimum and 65535 the maximum of that comp, given as
+// comps minimums then comps maximums
+#define APG_ENCODING_RANGE16 8
+
+// bone ids and weights per vertex in packed APG_SECTION_VB and VW sections
+#define APG_BONE_INFLUENCES 4
+
+// components in an APG_SECTION_ANIM_CHANNELS element
+#define APG_CHANNEL_COMPS 6
+
+struct Apg_Bin_Header {
+	char magic[4]; // APG_BIN_MAGIC
+	uint32_t version; // APG_BIN_VERSION
+	uint32_t header_size; // sizeof (Apg_Bin_Header) when written
+	uint32_t section_count;
+	uint64_t directory_offset; // in bytes from start of file
+	uint64_t file_size;
+	uint32_t vert_count;
+	uint32_t bone_count;
+	uint32_t anim_node_count;
+	uint32_t animation_count;
+	float bounding_radius;
+	uint32_t reserved[3];
+};
+
+// one entry in the section directory
+struct Apg_Bin_Section {
+	uint32_t id; // APG_SECTION_*
+	uint32_t type; // APG_TYPE_*
+	uint32_t comps; // components per element
+	uint32_t count; // number of elements
+	uint32_t index; // animation index for per-animation sections, else 0
+	uint32_t encoding; // APG_ENCODING_*
+	uint64_t offset; // in bytes from start of file. multiple of APG_BIN_ALIGN
+	uint64_t size; // in bytes. count * comps * sizeof (type)
+};
+
+// a whole file mapped read-only into memory
+struct Apg_Mapped_File {
+	void* ptr;
+	size_t size;
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int fd;
+#endif
+};
+
+// size in bytes of one component of an APG_TYPE_*. 0 if unknown
+size_t apg_bin_type_size (uint32_t type);
+
+// map a whole file read-only. on failure returns false and mf->ptr is NULL
+bool apg_map_file (const char* file_name, Apg_Mapped_File* mf);
+void apg_unmap_file (Apg_Mapped_File* mf);
+
+// true if the first bytes of memory look like a binary .apg header
+bool apg_bin_is_bin (const void* ptr, size_t size);
+// checks magic, version, and that the directory and all payloads are in bounds
+// and aligned. must pass before using any of the getters below
+bool apg_bin_validate (const void* ptr, size_t size);
+// finds a section by id and index. returns NULL if not present
+const Apg_Bin_Section* apg_bin_find_section (const void* ptr, uint32_t id,
+	uint32_t index);
+// pointer to the payload of a section inside the mapped file
+const void* apg_bin_section_data (const void* ptr, const Apg_Bin_Section* s);
+// float components per element once a section is decoded. 0 if the encoding
+// is unknown or does not match the section's type and comps
+uint32_t apg_bin_decoded_comps (const Apg_Bin_Section* s);
+// decodes an encoded section into count * apg_bin_decoded_comps () floats.
+// params is the APG_SECTION_VP_BOUNDS payload for APG_ENCODING_AABB16, the
+// animation duration for APG_ENCODING_SMALLEST3, or the ranges for
+// APG_ENCODING_RANGE16
+bool apg_bin_decode (const void* ptr, const Apg_Bin_Section* s,
+	const float* params, float* out);
+
+// quantisers for the encodings above. apg_bin_decode () reverses them
+uint16_t apg_encode_aabb16 (float v, float min, float max);
+uint16_t apg_encode_unorm16 (float v);
+uint16_t apg_encode_half (float v);
+float apg_decode_half (uint16_t h);
+// n must be unit length
+void apg_encode_oct16 (const float* n, int16_t* out);
+uint32_t apg_encode_10_10_10_2 (const float* v);
+//
+// smallest-three versor in 48 bits. the largest component is dropped, after
+// negating the versor if needed to make it positive, and rebuilt from the
+// others as they make a unit versor. the other three are stored in order in
+// the low 15 bits of each word, over [-1/sqrt(2), 1/sqrt(2)], and the index of
+// the dropped one in the top bits of the first two words
+void apg_encode_smallest3 (const float* q, uint16_t* out);
+void apg_decode_smallest3 (const uint16_t* in, float* q);
+uint16_t apg_encode_key_time (double t, double duration);
+// in float, as the loader's vectorised unpacking does it
+inline float apg_decode_key_time (uint16_t t, double duration) {
+	return t * (float)(duration / 65535.0);
+}
+//
+// packs a vertex's count bone influences into APG_BONE_INFLUENCES u8 ids and
+// unorm8 weights, largest weight first. the largest are kept, any that would
+// round to 0 are dropped, and the rest are scaled to sum to exactly 255.
+// unused slots are 0. with no weight at all the vertex gets all of bone 0.
+// ids must be in [0, 255]. returns how many influences were kept
+int apg_encode_bone_weights (const int* ids, const float* weights, int count,
+	uint8_t* out_ids, uint8_t* out_weights);
+
+//
+// writer: add sections, then write the file. the writer only stores pointers
+// so section data must remain valid until apg_bin_write() returns. the file is
+// assembled in one exact-size allocation and written with a single fwrite()
+#define APG_BIN_MAX_SECTIONS 1024
+
+struct Apg_Bin_Writer {
+	Apg_Bin_Header header;
+	Apg_Bin_Section sections[APG_BIN_MAX_SECTIONS];
+	const void* data[APG_BIN_MAX_SECTIONS];
+	uint32_t section_count;
+};
+
+void apg_bin_writer_init (Apg_Bin_Writer* w);
+bool apg_bin_add_section (Apg_Bin_Writer* w, uint32_t id, uint32_t type,
+	uint32_t comps, uint32_t count, uint32_t index, const void* data);
+// as above for a section stored with one of the APG_ENCODING_* quantisations
+bool apg_bin_add_encoded_section (Apg_Bin_Writer* w, uint32_t id,
+	uint32_t type, uint32_t comps, uint32_t count, uint32_t index,
+	uint32_t encoding, const void* data);
+// works out every section offset and returns the exact file size in bytes
+uint64_t apg_bin_layout (Apg_Bin_Writer* w);
+// copies the laid-out file into dst, which must hold apg_bin_layout () bytes
+void apg_bin_assemble (const Apg_Bin_Writer* w, void* dst);
+bool apg_bin_write (Apg_Bin_Writer* w, FILE* f);
+
+#endif
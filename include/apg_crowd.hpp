@@ -0,0 +1,80 @@
+//
+// Many animated instances of one skeleton, evaluated across threads
+// First version 17 Oct 2026
+//
+// An Apg_Rig holds what every instance of a mesh shares and nothing writes to
+// while a crowd is updated: the clips, the flattened skeleton and the bind
+// matrices. Each Apg_Crowd_Instance holds one instance's own state: which clip
+// it plays, how far in, and a key cursor. Its skinning palette is its slice of
+// the crowd's palettes. An update hands out instances in chunks to a
+// work-stealing pool, with a scratch pose per thread, so no two threads ever
+// write the same memory.
+//
+// An instance whose clip has a baked table (see apg_bake.hpp) fetches its
+// palette from the table instead of evaluating keys.
+//
+
+#ifndef _APG_CROWD_H_
+#define _APG_CROWD_H_
+
+#include "apg_anim.hpp"
+#include "apg_bake.hpp"
+#include "apg_pool.hpp"
+
+// instances a thread takes at a time
+#define APG_CROWD_CHUNK_SIZE 16
+
+struct Apg_Rig {
+	const Animation* clips; // every clip has node_count channels
+	int clip_count;
+	Apg_Skeleton skeleton;
+	mat3x4 root_transform;
+	mat3x4* offset_mats; // bone_count
+	int bone_count;
+	int node_count;
+	// clip_count. sample_count is 0 for a clip with no table
+	Apg_Baked_Clip* baked;
+};
+
+struct Apg_Crowd_Instance {
+	int clip; // index into the rig's clips
+	double time; // seconds into the clip. loops at the clip's duration
+	float speed; // 1 plays at normal speed
+	Apg_Anim_Cursor cursor;
+	int cursor_clip; // the clip the cursor was last used on
+};
+
+struct Apg_Crowd {
+	const Apg_Rig* rig;
+	Apg_Crowd_Instance* instances;
+	// bone_count per instance, instance after instance
+	mat3x4* palettes;
+	int instance_count;
+	Apg_Pose* poses; // one per thread
+	Apg_Pool pool;
+	double dt; // the step of the update under way
+};
+
+//
+// points at mesh's clips and any baked tables, which must outlive the rig, and
+// builds the rest. fails if the mesh has no skeleton or no animations
+bool apg_init_rig (const Apg_Mesh* mesh, Apg_Rig* rig);
+void apg_free_rig (Apg_Rig* rig);
+
+//
+// every instance starts at the start of clip 0 at normal speed. thread_count
+// as for apg_init_pool (). rig must outlive the crowd
+bool apg_init_crowd (const Apg_Rig* rig, int instance_count, int thread_count,
+	Apg_Crowd* crowd);
+void apg_free_crowd (Apg_Crowd* crowd);
+
+// palette of instance i, bone_count matrices
+mat3x4* apg_crowd_palette (const Apg_Crowd* crowd, int i);
+
+//
+// moves every instance on dt * speed seconds, looping its clip, and writes its
+// palette. instances' clip, time and speed can be changed between updates.
+// 0 re-evaluates every instance where it is
+void apg_update_crowd (Apg_Crowd* crowd, double dt);
+
+#endif
@@ -0,0 +1,128 @@
+//
+// .apg file loader - ASCII and binary - with no graphics dependencies
+// First version 17 Oct 2026
+//
+// ASCII files are read into memory in one go and parsed by walking a pointer
+// over the buffer. numbers are parsed by hand so there is no per-value libc
+// stream locking or format-string interpretation, and the parse does not
+// depend on the C locale. binary files are mapped and used in place.
+//
+
+#ifndef _APG_LOADER_H_
+#define _APG_LOADER_H_
+
+#include "maths_funcs.hpp"
+#include "apg_bin.hpp"
+
+#define MAX_ANIM_NAME_LEN 64
+
+// key layouts match the binary .apg key sections so they can be mapped as-is
+struct TraAnimKey {
+	float time;
+	vec3 tra;
+};
+struct ScaAnimKey {
+	float time;
+	vec3 sca;
+};
+struct RotAnimKey {
+	float time;
+	versor rot;
+};
+// a rotation key from a binary file written with -quant. see
+// APG_ENCODING_SMALLEST3. 8 bytes against 20 for a RotAnimKey
+struct PackedRotKey {
+	uint16_t time; // fraction of the animation duration
+	uint16_t rot[3]; // smallest-three versor
+};
+struct Channel {
+	TraAnimKey* tra_keys;
+	int tra_keys_count;
+	ScaAnimKey* sca_keys;
+	int sca_keys_count;
+	// one of these is set. rot_keys_count applies to either
+	RotAnimKey* rot_keys;
+	PackedRotKey* packed_rot_keys;
+	int rot_keys_count;
+};
+// an animation to be played using the skeleton hierarchy
+struct Animation {
+	char name[MAX_ANIM_NAME_LEN];
+	double duration;
+	// mem order of channels corresponds to anim nodes in hierarchy
+	Channel* channels;
+	int num_channels;
+	// how apg_anim blends this clip's rotation keys, an Apg_Rot_Interp. 0 uses
+	// apg_anim's global setting
+	int rot_interp;
+};
+
+// a mesh read from an .apg file. if 'mapped' is set then arrays point into
+// the read-only file mapping and must not be written to
+struct Apg_Mesh {
+	float* vps;
+	float* vns;
+	float* vts;
+	float* vtans;
+	void* vbs; // float from ASCII files, int32 or uint8 from binary files
+	void* vws; // float from ASCII files, float or unorm8 from binary files
+	int vp_comps;
+	int vn_comps;
+	int vt_comps;
+	int vtan_comps;
+	int vb_comps;
+	int vb_type; // APG_TYPE_F32, APG_TYPE_I32 or APG_TYPE_U8
+	int vw_comps;
+	int vw_type; // APG_TYPE_F32 or APG_TYPE_U8
+	int vert_count;
+	void* indices; // 3 per triangle. NULL if the mesh is not indexed
+	int index_type; // APG_TYPE_U16 or APG_TYPE_U32
+	int index_count;
+	// quantised streams from a binary file, decoded. vps etc. point into it
+	float* decoded;
+
+	mat4 root_transform;
+	mat4* offset_mats;
+	int* node_parents;
+	int* node_bone_ids;
+	Animation* animations;
+	int bone_count;
+	int anim_node_count;
+	int animation_count;
+	float bounding_radius;
+
+	bool mapped;
+	Apg_Mapped_File file;
+};
+
+// load an ASCII or binary .apg. detects which from the first bytes
+bool apg_load_mesh (const char* file_name, Apg_Mesh* mesh);
+// load an ASCII .apg from a nul-terminated buffer holding the whole file
+bool apg_parse_mesh (const char* buffer, Apg_Mesh* mesh);
+// release everything owned by the mesh, including the file mapping
+void apg_free_mesh (Apg_Mesh* mesh);
+
+//
+// a mesh's bone influences as APG_BONE_INFLUENCES uint8 ids and unorm8
+// weights per vertex, however the file stored them. see
+// apg_encode_bone_weights (). with one bone a vertex that bone gets all the
+// weight, as files from before weights were written have 0 there. false if
+// the mesh has no bone ids or any is out of range
+bool apg_mesh_packed_bones (const Apg_Mesh* mesh, uint8_t* ids,
+	uint8_t* weights);
+
+//
+// unpacks keys [first, first + count) of a channel's rotations into out,
+// decoding packed keys 4 at a time with SSE2 where available. plain keys are
+// copied
+void apg_get_rot_keys (const Animation* anim, int channel, int first,
+	int count, RotAnimKey* out);
+// time of one of a channel's rotation keys, packed or not
+float apg_rot_key_time (const Animation* anim, int channel, int key);
+
+// locale-independent number parsers. skip leading blanks and advance *p past
+// the number. return 0 and leave *p at the first non-blank if no number found
+float apg_parse_float (const char** p);
+int apg_parse_int (const char** p);
+
+#endif
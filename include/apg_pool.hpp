@@ -0,0 +1,36 @@
+//
+// Work-stealing thread pool
+// First version 17 Oct 2026
+//
+// Runs a function over a range of items split into chunks. Each thread starts
+// with an even share of the chunks and takes them from the front of its own
+// queue. A thread that runs out steals the back half of another's queue, so a
+// share that turns out slow to work through is spread over the others. The
+// calling thread works too, and apg_pool_run () returns when every chunk is
+// done. Threads sleep between runs.
+//
+
+#ifndef _APG_POOL_H_
+#define _APG_POOL_H_
+
+//
+// called for items [first, last). worker is 0 for the calling thread and
+// 1 to thread_count - 1 for the pool's threads, for indexing per-thread scratch
+typedef void (*Apg_Pool_Func) (void* user, int first, int last, int worker);
+
+struct Apg_Pool {
+	struct Apg_Pool_Internal* internal;
+	int thread_count; // including the thread calling apg_pool_run ()
+};
+
+// thread_count 0 uses one per hardware thread. 1 runs everything on the caller
+bool apg_init_pool (int thread_count, Apg_Pool* pool);
+void apg_free_pool (Apg_Pool* pool);
+
+//
+// calls func over [0, count) in chunks of chunk_size items and waits for all
+// of them. not to be called from inside func or by two threads at once
+void apg_pool_run (Apg_Pool* pool, int count, int chunk_size,
+	Apg_Pool_Func func, void* user);
+
+#endif
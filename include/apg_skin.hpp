@@ -0,0 +1,63 @@
+//
+// Linear blend skinning on the CPU
+// First version 17 Oct 2026
+//
+// Transforms vertex points, normals and tangents by a palette of bone
+// matrices, as the viewer's vertex shader does, for anything that needs the
+// skinned mesh without a GPU: physics, picking, baking. Each vertex has 1 to
+// APG_SKIN_MAX_INFLUENCES bones. With more than one, the bones' matrices are
+// blended by the vertex's weights before transforming it.
+//
+// apg_skin () uses SSE, working on two vertices at a time with AVX, whenever
+// the compiler targets them and MATHS_NO_SIMD is not defined.
+// apg_skin_scalar () is the reference. The two add up in the same order, so
+// unless the compiler fuses the reference's multiplies and adds, they give the
+// same results bit for bit.
+//
+
+#ifndef _APG_SKIN_H_
+#define _APG_SKIN_H_
+
+#include "apg_loader.hpp"
+
+#define APG_SKIN_MAX_INFLUENCES 4
+
+struct Apg_Skin_Input {
+	const float* vps; // 3 per vertex
+	const float* vns; // 3 per vertex, or NULL
+	const float* vtans; // vtan_comps per vertex, or NULL
+	int vtan_comps; // 3, or 4 with the 4th copied as it is
+	const int* bone_ids; // influences per vertex, each in [0, bone_count)
+	const float* weights; // influences per vertex. NULL means all 1
+	int influences;
+	int vert_count;
+};
+
+//
+// same layout as the input. a NULL stream is not written. may be the input's
+// own streams, to skin in place
+struct Apg_Skin_Output {
+	float* vps;
+	float* vns;
+	float* vtans;
+};
+
+//
+// normals and tangents are transformed by the blended matrix without its
+// translation and made unit length again. false if the input is malformed
+bool apg_skin (const Apg_Skin_Input* in, const mat3x4* palette, int bone_count,
+	Apg_Skin_Output* out);
+bool apg_skin_scalar (const Apg_Skin_Input* in, const mat3x4* palette,
+	int bone_count, Apg_Skin_Output* out);
+
+//
+// a mesh's bone ids as ints, whether the file stored them as float, int32 or
+// uint8. bone_ids needs vert_count * vb_comps. false if any is out of range
+bool apg_mesh_bone_ids (const Apg_Mesh* mesh, int* bone_ids);
+//
+// a mesh's bone weights as floats, for the ids above. weights needs
+// vert_count * vw_comps. false if there is not one weight per id. files with
+// one bone a vertex need none: pass NULL weights to apg_skin ()
+bool apg_mesh_bone_weights (const Apg_Mesh* mesh, float* weights);
+
+#endif
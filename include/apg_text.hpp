@@ -0,0 +1,45 @@
+//
+// Buffered ASCII .apg writer
+// First version 17 Oct 2026
+//
+// Formats straight into a large buffer and hands it to fwrite() in big chunks,
+// instead of making one fprintf() call per number. The number formatters give
+// byte-identical output to the printf() formats noted beside them, including
+// rounding of ties and the sign of values that round to zero. Anything out of
+// the common range (huge values, NaN, exponent notation) is passed on to
+// snprintf() so the output never differs.
+//
+
+#ifndef _APG_TEXT_H_
+#define _APG_TEXT_H_
+
+#include <stdio.h>
+
+// bytes buffered before a flush
+#define APG_TEXT_BUFFER_SIZE (1024 * 1024)
+// room kept free for any one number. "%f" of a huge double is over 300 chars
+#define APG_TEXT_MAX_NUMBER_LEN 512
+
+struct Apg_Text_Writer {
+	FILE* f;
+	char* buffer;
+	size_t used;
+	bool ok; // false after any failed write
+};
+
+// allocates the buffer. f must stay open until apg_text_close()
+bool apg_text_open (Apg_Text_Writer* w, FILE* f);
+// flushes what is left and frees the buffer. does not close the file.
+// returns false if any write failed
+bool apg_text_close (Apg_Text_Writer* w);
+bool apg_text_flush (Apg_Text_Writer* w);
+
+void apg_text_char (Apg_Text_Writer* w, char c);
+void apg_text_str (Apg_Text_Writer* w, const char* str);
+// for tag lines and anything else not in a hot loop
+void apg_text_printf (Apg_Text_Writer* w, const char* fmt, ...);
+void apg_text_int (Apg_Text_Writer* w, int v); // "%i"
+void apg_text_fixed (Apg_Text_Writer* w, double v, int decimals); // "%.*f"
+void apg_text_sig (Apg_Text_Writer* w, double v, int sig_figs); // "%.*g"
+
+#endif
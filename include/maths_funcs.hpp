@@ -18,6 +18,18 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+// SSE versions of mat4 multiply, inverse and quat_to_mat4, and of versor
+// normalise, are used where the compiler targets SSE2. AVX also widens mat4
+// multiply. define MATHS_NO_SIMD to use only the scalar code, which is kept
+// in the *_scalar functions as the reference
+#if defined(__SSE2__) && !defined(MATHS_NO_SIMD)
+#define MATHS_SIMD
+#include <emmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#endif
+
 // const used to convert degrees into radians
 #define TAU 2.0 * M_PI
 #define ONE_DEG_IN_RAD (2.0 * M_PI) / 360.0 // 0.017444444
@@ -29,6 +41,7 @@ struct vec3;
 struct vec4;
 struct mat3;
 struct mat4;
+struct mat3x4;
 struct versor;
 
 // print functions
@@ -37,6 +50,7 @@ void print (const vec3& v);
 void print (const vec4& v);
 void print (const mat3& m);
 void print (const mat4& m);
+void print (const mat3x4& m);
 void print (const versor& q);
 // vector functions
 float length (const vec3& v);
@@ -73,6 +87,31 @@ versor slerp (const versor& q, const versor& r);
 // stupid overloading wouldn't let me use const
 versor normalise (versor& q);
 versor slerp (versor& q, versor& r, float t);
+// cheaper approximations of slerp. these don't modify q or r
+versor nlerp (const versor& q, const versor& r, float t);
+versor nlerp_corrected (const versor& q, const versor& r, float t);
+// matrix product, as mat4 operator*
+mat4 mat4_mul (const mat4& a, const mat4& b);
+// reference versions of the functions with SIMD versions
+mat4 mat4_mul_scalar (const mat4& a, const mat4& b);
+mat4 inverse_scalar (const mat4& mm);
+mat4 quat_to_mat4_scalar (const versor& q);
+versor normalise_scalar (versor& q);
+// affine 3x4 matrix functions
+mat3x4 identity_mat3x4 ();
+mat3x4 mat3x4_from_mat4 (const mat4& m);
+mat4 mat4_from_mat3x4 (const mat3x4& m);
+mat3x4 mat3x4_mul (const mat3x4& a, const mat3x4& b);
+mat3x4 mat3x4_mul_scalar (const mat3x4& a, const mat3x4& b);
+mat3x4 inverse_affine (const mat3x4& m);
+mat3x4 trs_mat3x4 (const vec3& t, const versor& r, const vec3& s);
+#ifdef MATHS_SIMD
+mat3x4 mat3x4_mul_simd (const mat3x4& a, const mat3x4& b);
+mat4 mat4_mul_simd (const mat4& a, const mat4& b);
+mat4 inverse_simd (const mat4& mm);
+mat4 quat_to_mat4_simd (const versor& q);
+versor normalise_simd (versor& q);
+#endif
 
 struct vec2 {
 	vec2 () {}
@@ -233,8 +272,9 @@ struct mat3 {
 0 4 8  12
 1 5 9  13
 2 6 10 14
-3 7 11 15*/
-struct mat4 {
+3 7 11 15
+aligned so that columns can be loaded straight into SSE registers*/
+struct alignas (16) mat4 {
 	mat4 () {}
 	mat4 (float a, float b, float c, float d,
 				float e, float f, float g, float h,
@@ -283,19 +323,7 @@ struct mat4 {
 	}
 
 	mat4 operator* (const mat4& rhs) {
-		mat4 r = zero_mat4 ();
-		int r_index = 0;
-		for (int col = 0; col < 4; col++) {
-			for (int row = 0; row < 4; row++) {
-				float sum = 0.0f;
-				for (int i = 0; i < 4; i++) {
-					sum += rhs.m[i + col * 4] * m[row + i * 4];
-				}
-				r.m[r_index] = sum;
-				r_index++;
-			}
-		}
-		return r;
+		return mat4_mul (*this, rhs);
 	}
 
 	mat4& operator= (const mat4& rhs) {
@@ -308,6 +336,21 @@ struct mat4 {
 	float m[16];
 };
 
+/* an affine transform - a mat4 whose bottom row is 0 0 0 1 - stored as its
+top 3 rows, row by row:
+0 1 2  3
+4 5 6  7
+8 9 10 11
+48 bytes instead of 64, and a product is 36 multiplies instead of 64. in GLSL
+an array of these is a mat3x4 uniform, applied as vec4 (p, 1.0) * m */
+struct alignas (16) mat3x4 {
+	mat3x4 () {}
+	mat3x4 operator* (const mat3x4& rhs) const {
+		return mat3x4_mul (*this, rhs);
+	}
+	float m[12];
+};
+
 struct versor {
 	versor () {}
 	versor operator/ (float rhs) {
@@ -386,6 +429,14 @@ inline void print (const versor& q) {
 	printf ("[%.2f ,%.2f, %.2f, %.2f]\n", q.q[0], q.q[1], q.q[2], q.q[3]);
 }
 
+inline void print (const mat3x4& m) {
+	printf ("\n");
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[0], m.m[1], m.m[2], m.m[3]);
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[4], m.m[5], m.m[6], m.m[7]);
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[8], m.m[9], m.m[10], m.m[11]);
+	printf ("[0.00][0.00][0.00][1.00]\n");
+}
+
 /*------------------------------VECTOR FUNCTIONS-----------------------------*/
 // create from truncated vec4
 inline vec3::vec3 (const vec4& vv) {
@@ -447,6 +498,30 @@ inline vec3 heading_to_direction (float degrees) {
 }
 
 /*-----------------------------MATRIX FUNCTIONS------------------------------*/
+inline mat4 mat4_mul_scalar (const mat4& a, const mat4& b) {
+	mat4 r = zero_mat4 ();
+	int r_index = 0;
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			float sum = 0.0f;
+			for (int i = 0; i < 4; i++) {
+				sum += b.m[i + col * 4] * a.m[row + i * 4];
+			}
+			r.m[r_index] = sum;
+			r_index++;
+		}
+	}
+	return r;
+}
+
+inline mat4 mat4_mul (const mat4& a, const mat4& b) {
+#ifdef MATHS_SIMD
+	return mat4_mul_simd (a, b);
+#else
+	return mat4_mul_scalar (a, b);
+#endif
+}
+
 inline mat3 zero_mat3 () {
 	return mat3 (
 		0.0f, 0.0f, 0.0f,
@@ -522,6 +597,14 @@ inline float determinant (const mat4& mm) {
 /* returns a 16-element array that is the inverse of a 16-element array (4x4
 matrix). see http://www.euclideanspace.com/maths/algebra/matrix/functions/inverse/fourD/index.htm */
 inline mat4 inverse (const mat4& mm) {
+#ifdef MATHS_SIMD
+	return inverse_simd (mm);
+#else
+	return inverse_scalar (mm);
+#endif
+}
+
+inline mat4 inverse_scalar (const mat4& mm) {
 	float det = determinant (mm);
 	/* there is no inverse if determinant is zero (not likely unless scale is
 	broken) */
@@ -738,6 +821,14 @@ inline versor quat_from_axis_deg (float degrees, float x, float y, float z) {
 }
 
 inline mat4 quat_to_mat4 (const versor& q) {
+#ifdef MATHS_SIMD
+	return quat_to_mat4_simd (q);
+#else
+	return quat_to_mat4_scalar (q);
+#endif
+}
+
+inline mat4 quat_to_mat4_scalar (const versor& q) {
 	float w = q.q[0];
 	float x = q.q[1];
 	float y = q.q[2];
@@ -763,6 +854,14 @@ inline mat4 quat_to_mat4 (const versor& q) {
 }
 
 inline versor normalise (versor& q) {
+#ifdef MATHS_SIMD
+	return normalise_simd (q);
+#else
+	return normalise_scalar (q);
+#endif
+}
+
+inline versor normalise_scalar (versor& q) {
 	// norm(q) = q / magnitude (q)
 	// magnitude (q) = sqrt (w*w + x*x...)
 	// only compute sqrt if interior sum != 1.0
@@ -782,6 +881,9 @@ inline float dot (const versor& q, const versor& r) {
 	return q.q[0] * r.q[0] + q.q[1] * r.q[1] + q.q[2] * r.q[2] + q.q[3] * r.q[3];
 }
 
+//
+// acos () and sin () cost far more than the blend, so there is no SIMD version.
+// one only doing the blend 4-wide measured no faster
 inline versor slerp (versor& q, versor& r, float t) {
 	// angle between q0-q1
 	float cos_half_theta = dot (q, r);
@@ -819,4 +921,335 @@ inline versor slerp (versor& q, versor& r, float t) {
 	return result;
 }
 
+/* normalised lerp: a straight line between q and r pushed back out to unit
+length. it follows the same path as slerp but not at a constant speed - it
+runs slow at the ends and fast in the middle - so it is furthest from slerp at
+t = 1/4 and 3/4. about 0.03 degrees off for keys 30 degrees apart and 1 degree
+for 90, with no acos () or sin (). returns unit length whatever the lengths of
+q and r */
+inline versor nlerp (const versor& q, const versor& r, float t) {
+	// take the short way around, as slerp does, without touching r
+	float b = dot (q, r) < 0.0f ? -t : t;
+	float a = 1.0f - t;
+	versor result;
+	for (int i = 0; i < 4; i++) {
+		result.q[i] = q.q[i] * a + r.q[i] * b;
+	}
+	float sum = dot (result, result);
+	if (0.0f == sum) {
+		return q;
+	}
+	float inv_mag = 1.0f / sqrtf (sum);
+	for (int i = 0; i < 4; i++) {
+		result.q[i] *= inv_mag;
+	}
+	return result;
+}
+
+/* nlerp with t first bent by a polynomial in t and the cosine of the angle
+between the keys, so that it moves at close to slerp's constant speed.
+polynomial fitted by A. Kapoulkine in "Approximating slerp". q and r should be
+unit length */
+inline versor nlerp_corrected (const versor& q, const versor& r, float t) {
+	float d = fabsf (dot (q, r));
+	float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+	float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+	float k = a * (t - 0.5f) * (t - 0.5f) + b;
+	return nlerp (q, r, t + t * (t - 0.5f) * (t - 1.0f) * k);
+}
+
+/*------------------------AFFINE 3X4 MATRIX FUNCTIONS------------------------*/
+inline mat3x4 identity_mat3x4 () {
+	mat3x4 r;
+	for (int i = 0; i < 12; i++) {
+		r.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+	return r;
+}
+
+// drops the bottom row, which must be 0 0 0 1
+inline mat3x4 mat3x4_from_mat4 (const mat4& m) {
+	mat3x4 r;
+	for (int row = 0; row < 3; row++) {
+		for (int col = 0; col < 4; col++) {
+			r.m[row * 4 + col] = m.m[col * 4 + row];
+		}
+	}
+	return r;
+}
+
+inline mat4 mat4_from_mat3x4 (const mat3x4& m) {
+	return mat4 (
+		m.m[0], m.m[4], m.m[8], 0.0f,
+		m.m[1], m.m[5], m.m[9], 0.0f,
+		m.m[2], m.m[6], m.m[10], 0.0f,
+		m.m[3], m.m[7], m.m[11], 1.0f
+	);
+}
+
+/* the sums are added up in the same order as mat4 multiply, leaving out the
+terms of the bottom row, so the result is the same as multiplying as mat4s */
+inline mat3x4 mat3x4_mul_scalar (const mat3x4& a, const mat3x4& b) {
+	mat3x4 r;
+	for (int row = 0; row < 3; row++) {
+		const float* a_row = &a.m[row * 4];
+		for (int col = 0; col < 4; col++) {
+			r.m[row * 4 + col] = b.m[col] * a_row[0] + b.m[4 + col] * a_row[1] +
+				b.m[8 + col] * a_row[2];
+		}
+		r.m[row * 4 + 3] += a_row[3];
+	}
+	return r;
+}
+
+inline mat3x4 mat3x4_mul (const mat3x4& a, const mat3x4& b) {
+#ifdef MATHS_SIMD
+	return mat3x4_mul_simd (a, b);
+#else
+	return mat3x4_mul_scalar (a, b);
+#endif
+}
+
+/* inverts the 3x3 part by cofactors and applies it to the negated translation.
+a fraction of the work of inverting a mat4 */
+inline mat3x4 inverse_affine (const mat3x4& m) {
+	float c00 = m.m[5] * m.m[10] - m.m[6] * m.m[9];
+	float c01 = m.m[6] * m.m[8] - m.m[4] * m.m[10];
+	float c02 = m.m[4] * m.m[9] - m.m[5] * m.m[8];
+	float det = m.m[0] * c00 + m.m[1] * c01 + m.m[2] * c02;
+	if (0.0f == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return m;
+	}
+	float inv_det = 1.0f / det;
+	mat3x4 r;
+	r.m[0] = c00 * inv_det;
+	r.m[1] = (m.m[2] * m.m[9] - m.m[1] * m.m[10]) * inv_det;
+	r.m[2] = (m.m[1] * m.m[6] - m.m[2] * m.m[5]) * inv_det;
+	r.m[4] = c01 * inv_det;
+	r.m[5] = (m.m[0] * m.m[10] - m.m[2] * m.m[8]) * inv_det;
+	r.m[6] = (m.m[2] * m.m[4] - m.m[0] * m.m[6]) * inv_det;
+	r.m[8] = c02 * inv_det;
+	r.m[9] = (m.m[1] * m.m[8] - m.m[0] * m.m[9]) * inv_det;
+	r.m[10] = (m.m[0] * m.m[5] - m.m[1] * m.m[4]) * inv_det;
+	for (int row = 0; row < 3; row++) {
+		r.m[row * 4 + 3] = -(r.m[row * 4] * m.m[3] + r.m[row * 4 + 1] * m.m[7] +
+			r.m[row * 4 + 2] * m.m[11]);
+	}
+	return r;
+}
+
+/* translate (t) * quat_to_mat4 (r) * scale (s), built directly: the rotation's
+columns are scaled and the translation is put in the last column */
+inline mat3x4 trs_mat3x4 (const vec3& t, const versor& r, const vec3& s) {
+	float w = r.q[0];
+	float x = r.q[1];
+	float y = r.q[2];
+	float z = r.q[3];
+	mat3x4 m;
+	m.m[0] = (1.0f - 2.0f * y * y - 2.0f * z * z) * s.v[0];
+	m.m[1] = (2.0f * x * y - 2.0f * w * z) * s.v[1];
+	m.m[2] = (2.0f * x * z + 2.0f * w * y) * s.v[2];
+	m.m[3] = t.v[0];
+	m.m[4] = (2.0f * x * y + 2.0f * w * z) * s.v[0];
+	m.m[5] = (1.0f - 2.0f * x * x - 2.0f * z * z) * s.v[1];
+	m.m[6] = (2.0f * y * z - 2.0f * w * x) * s.v[2];
+	m.m[7] = t.v[1];
+	m.m[8] = (2.0f * x * z - 2.0f * w * y) * s.v[0];
+	m.m[9] = (2.0f * y * z + 2.0f * w * x) * s.v[1];
+	m.m[10] = (1.0f - 2.0f * x * x - 2.0f * y * y) * s.v[2];
+	m.m[11] = t.v[2];
+	return m;
+}
+
+/*-------------------------------SIMD FUNCTIONS------------------------------*/
+/* each gives the same result, bit for bit, as its scalar version by doing the
+same operations in the same order, but on 4 floats at a time. the exception is
+inverse, which works on 2x2 blocks and rounds differently. loads are unaligned
+as versors sit unaligned in animation keys, and arrays from malloc () are
+only 8-byte aligned on 32-bit systems */
+#ifdef MATHS_SIMD
+#define MATHS_SHUFFLE(a, b, x, y, z, w) \
+	_mm_shuffle_ps (a, b, _MM_SHUFFLE (w, z, y, x))
+#define MATHS_SWIZZLE(a, x, y, z, w) MATHS_SHUFFLE (a, a, x, y, z, w)
+
+inline mat4 mat4_mul_simd (const mat4& a, const mat4& b) {
+	mat4 r;
+#ifdef __AVX__
+	// two columns of the result at once
+	__m256 a0 = _mm256_broadcast_ps ((const __m128*)&a.m[0]);
+	__m256 a1 = _mm256_broadcast_ps ((const __m128*)&a.m[4]);
+	__m256 a2 = _mm256_broadcast_ps ((const __m128*)&a.m[8]);
+	__m256 a3 = _mm256_broadcast_ps ((const __m128*)&a.m[12]);
+	for (int col = 0; col < 4; col += 2) {
+		__m256 bb = _mm256_loadu_ps (&b.m[col * 4]);
+		__m256 sum = _mm256_setzero_ps ();
+		sum = _mm256_add_ps (sum, _mm256_mul_ps (_mm256_permute_ps (bb, 0x00), a0));
+		sum = _mm256_add_ps (sum, _mm256_mul_ps (_mm256_permute_ps (bb, 0x55), a1));
+		sum = _mm256_add_ps (sum, _mm256_mul_ps (_mm256_permute_ps (bb, 0xaa), a2));
+		sum = _mm256_add_ps (sum, _mm256_mul_ps (_mm256_permute_ps (bb, 0xff), a3));
+		_mm256_storeu_ps (&r.m[col * 4], sum);
+	}
+#else
+	__m128 a0 = _mm_loadu_ps (&a.m[0]);
+	__m128 a1 = _mm_loadu_ps (&a.m[4]);
+	__m128 a2 = _mm_loadu_ps (&a.m[8]);
+	__m128 a3 = _mm_loadu_ps (&a.m[12]);
+	for (int col = 0; col < 4; col++) {
+		// starting from 0 as the scalar sum does, so -0 comes out as 0 alike
+		__m128 sum = _mm_setzero_ps ();
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_set1_ps (b.m[col * 4]), a0));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_set1_ps (b.m[col * 4 + 1]), a1));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_set1_ps (b.m[col * 4 + 2]), a2));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_set1_ps (b.m[col * 4 + 3]), a3));
+		_mm_storeu_ps (&r.m[col * 4], sum);
+	}
+#endif
+	return r;
+}
+
+/* a row of the result is the rows of b weighted by a row of a, plus a's
+translation in the last lane */
+inline mat3x4 mat3x4_mul_simd (const mat3x4& a, const mat3x4& b) {
+	__m128 b0 = _mm_loadu_ps (&b.m[0]);
+	__m128 b1 = _mm_loadu_ps (&b.m[4]);
+	__m128 b2 = _mm_loadu_ps (&b.m[8]);
+	__m128 last = _mm_setr_ps (0.0f, 0.0f, 0.0f, 1.0f);
+	mat3x4 r;
+	for (int row = 0; row < 3; row++) {
+		__m128 sum = _mm_setzero_ps ();
+		sum = _mm_add_ps (sum, _mm_mul_ps (b0, _mm_set1_ps (a.m[row * 4])));
+		sum = _mm_add_ps (sum, _mm_mul_ps (b1, _mm_set1_ps (a.m[row * 4 + 1])));
+		sum = _mm_add_ps (sum, _mm_mul_ps (b2, _mm_set1_ps (a.m[row * 4 + 2])));
+		sum = _mm_add_ps (sum, _mm_mul_ps (last, _mm_set1_ps (a.m[row * 4 + 3])));
+		_mm_storeu_ps (&r.m[row * 4], sum);
+	}
+	return r;
+}
+
+// 2x2 blocks are stored in one register as (m00, m01, m10, m11)
+inline __m128 _mat2_mul (__m128 a, __m128 b) {
+	return _mm_add_ps (_mm_mul_ps (a, MATHS_SWIZZLE (b, 0, 3, 0, 3)),
+		_mm_mul_ps (MATHS_SWIZZLE (a, 1, 0, 3, 2), MATHS_SWIZZLE (b, 2, 1, 2, 1)));
+}
+// adjugate (a) * b
+inline __m128 _mat2_adj_mul (__m128 a, __m128 b) {
+	return _mm_sub_ps (_mm_mul_ps (MATHS_SWIZZLE (a, 3, 3, 0, 0), b),
+		_mm_mul_ps (MATHS_SWIZZLE (a, 1, 1, 2, 2), MATHS_SWIZZLE (b, 2, 3, 0, 1)));
+}
+// a * adjugate (b)
+inline __m128 _mat2_mul_adj (__m128 a, __m128 b) {
+	return _mm_sub_ps (_mm_mul_ps (a, MATHS_SWIZZLE (b, 3, 0, 3, 0)),
+		_mm_mul_ps (MATHS_SWIZZLE (a, 1, 0, 3, 2), MATHS_SWIZZLE (b, 2, 1, 2, 1)));
+}
+
+/* inverse by 2x2 blocks [A B; C D]. the columns are read as if they were rows,
+which inverts the transpose, and the inverse written back the same way, which
+transposes it again */
+inline mat4 inverse_simd (const mat4& mm) {
+	__m128 r0 = _mm_loadu_ps (&mm.m[0]);
+	__m128 r1 = _mm_loadu_ps (&mm.m[4]);
+	__m128 r2 = _mm_loadu_ps (&mm.m[8]);
+	__m128 r3 = _mm_loadu_ps (&mm.m[12]);
+	__m128 a = _mm_movelh_ps (r0, r1);
+	__m128 b = _mm_movehl_ps (r1, r0);
+	__m128 c = _mm_movelh_ps (r2, r3);
+	__m128 d = _mm_movehl_ps (r3, r2);
+	// determinants of the blocks (|A| |B| |C| |D|)
+	__m128 det_sub = _mm_sub_ps (
+		_mm_mul_ps (MATHS_SHUFFLE (r0, r2, 0, 2, 0, 2),
+			MATHS_SHUFFLE (r1, r3, 1, 3, 1, 3)),
+		_mm_mul_ps (MATHS_SHUFFLE (r0, r2, 1, 3, 1, 3),
+			MATHS_SHUFFLE (r1, r3, 0, 2, 0, 2))
+	);
+	__m128 det_a = MATHS_SWIZZLE (det_sub, 0, 0, 0, 0);
+	__m128 det_b = MATHS_SWIZZLE (det_sub, 1, 1, 1, 1);
+	__m128 det_c = MATHS_SWIZZLE (det_sub, 2, 2, 2, 2);
+	__m128 det_d = MATHS_SWIZZLE (det_sub, 3, 3, 3, 3);
+	__m128 d_c = _mat2_adj_mul (d, c);
+	__m128 a_b = _mat2_adj_mul (a, b);
+	__m128 x = _mm_sub_ps (_mm_mul_ps (det_d, a), _mat2_mul (b, d_c));
+	__m128 w = _mm_sub_ps (_mm_mul_ps (det_a, d), _mat2_mul (c, a_b));
+	__m128 y = _mm_sub_ps (_mm_mul_ps (det_b, c), _mat2_mul_adj (d, a_b));
+	__m128 z = _mm_sub_ps (_mm_mul_ps (det_c, b), _mat2_mul_adj (a, d_c));
+	__m128 det = _mm_add_ps (_mm_mul_ps (det_a, det_d), _mm_mul_ps (det_b, det_c));
+	// minus the trace of (A#B)(D#C)
+	__m128 tr = _mm_mul_ps (a_b, MATHS_SWIZZLE (d_c, 0, 2, 1, 3));
+	tr = _mm_add_ps (tr, _mm_movehl_ps (tr, tr));
+	tr = _mm_add_ps (tr, MATHS_SWIZZLE (tr, 1, 0, 0, 0));
+	det = _mm_sub_ps (det, MATHS_SWIZZLE (tr, 0, 0, 0, 0));
+	if (0.0f == _mm_cvtss_f32 (det)) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	__m128 inv_det = _mm_div_ps (_mm_setr_ps (1.0f, -1.0f, -1.0f, 1.0f), det);
+	mat4 r;
+
+	x = _mm_mul_ps (x, inv_det);
+	y = _mm_mul_ps (y, inv_det);
+	z = _mm_mul_ps (z, inv_det);
+	w = _mm_mul_ps (w, inv_det);
+	_mm_storeu_ps (&r.m[0], MATHS_SHUFFLE (x, y, 3, 1, 3, 1));
+	_mm_storeu_ps (&r.m[4], MATHS_SHUFFLE (x, y, 2, 0, 2, 0));
+	_mm_storeu_ps (&r.m[8], MATHS_SHUFFLE (z, w, 3, 1, 3, 1));
+	_mm_storeu_ps (&r.m[12], MATHS_SHUFFLE (z, w, 2, 0, 2, 0));
+	return r;
+}
+
+/* each column is 1 or 0, plus and minus two products of the versor doubled
+with the versor, as in the scalar version. e.g. column 0 is
+(1 - 2yy - 2zz, 0 + 2xy + 2wz, 0 + 2xz - 2wy) */
+inline mat4 quat_to_mat4_simd (const versor& q) {
+	__m128 v = _mm_loadu_ps (q.q); // w x y z
+	__m128 v2 = _mm_add_ps (v, v);
+	__m128 one = _mm_setr_ps (1.0f, 0.0f, 0.0f, 0.0f);
+	__m128 c0, c1, c2;
+	mat4 r;
+
+	// (2y y, 2x y, 2x z) - (2z z, -2w z, 2w y)
+	c0 = _mm_sub_ps (one, _mm_xor_ps (_mm_mul_ps (MATHS_SWIZZLE (v2, 2, 1, 1, 0),
+		MATHS_SWIZZLE (v, 2, 2, 3, 0)), _mm_setr_ps (0.0f, -0.0f, -0.0f, 0.0f)));
+	c0 = _mm_sub_ps (c0, _mm_xor_ps (_mm_mul_ps (MATHS_SWIZZLE (v2, 3, 0, 0, 0),
+		MATHS_SWIZZLE (v, 3, 3, 2, 0)), _mm_setr_ps (0.0f, -0.0f, 0.0f, 0.0f)));
+	// (2x y, 2x x, 2y z) - (2w z, 2z z, -2w x)
+	c1 = _mm_sub_ps (_mm_setr_ps (0.0f, 1.0f, 0.0f, 0.0f), _mm_xor_ps (
+		_mm_mul_ps (MATHS_SWIZZLE (v2, 1, 1, 2, 0), MATHS_SWIZZLE (v, 2, 1, 3, 0)),
+		_mm_setr_ps (-0.0f, 0.0f, -0.0f, 0.0f)));
+	c1 = _mm_sub_ps (c1, _mm_xor_ps (_mm_mul_ps (MATHS_SWIZZLE (v2, 0, 3, 0, 0),
+		MATHS_SWIZZLE (v, 3, 3, 1, 0)), _mm_setr_ps (0.0f, 0.0f, -0.0f, 0.0f)));
+	// (2x z, 2y z, 2x x) - (-2w y, 2w x, 2y y)
+	c2 = _mm_sub_ps (_mm_setr_ps (0.0f, 0.0f, 1.0f, 0.0f), _mm_xor_ps (
+		_mm_mul_ps (MATHS_SWIZZLE (v2, 1, 2, 1, 0), MATHS_SWIZZLE (v, 3, 3, 1, 0)),
+		_mm_setr_ps (-0.0f, -0.0f, 0.0f, 0.0f)));
+	c2 = _mm_sub_ps (c2, _mm_xor_ps (_mm_mul_ps (MATHS_SWIZZLE (v2, 0, 0, 2, 0),
+		MATHS_SWIZZLE (v, 2, 1, 2, 0)), _mm_setr_ps (-0.0f, 0.0f, 0.0f, 0.0f)));
+	_mm_storeu_ps (&r.m[0], c0);
+	_mm_storeu_ps (&r.m[4], c1);
+	_mm_storeu_ps (&r.m[8], c2);
+	_mm_storeu_ps (&r.m[12], _mm_setr_ps (0.0f, 0.0f, 0.0f, 1.0f));
+	// the last lane of each column was worked out from w and is not wanted
+	r.m[3] = r.m[7] = r.m[11] = 0.0f;
+	return r;
+}
+
+/* the sum of squares is added up lane by lane in the scalar order, so the
+threshold test sees the same value */
+inline versor normalise_simd (versor& q) {
+	__m128 v = _mm_loadu_ps (q.q);
+	__m128 sq = _mm_mul_ps (v, v);
+	__m128 sum = _mm_add_ss (sq, MATHS_SWIZZLE (sq, 1, 1, 1, 1));
+	sum = _mm_add_ss (sum, MATHS_SWIZZLE (sq, 2, 2, 2, 2));
+	sum = _mm_add_ss (sum, MATHS_SWIZZLE (sq, 3, 3, 3, 3));
+	// NB: floats have min 6 digits of precision
+	const float thresh = 0.0001f;
+	if (fabs (1.0f - _mm_cvtss_f32 (sum)) < thresh) {
+		return q;
+	}
+	versor result;
+	__m128 mag = _mm_sqrt_ss (sum);
+	_mm_storeu_ps (result.q, _mm_div_ps (v, MATHS_SWIZZLE (mag, 0, 0, 0, 0)));
+	return result;
+}
+#endif
+
 #endif
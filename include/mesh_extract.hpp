@@ -0,0 +1,54 @@
+//
+// Bulk extraction of vertex attributes from importer meshes
+// First version 17 Oct 2026
+//
+// The loader copies an imported mesh's attribute arrays into the converter's
+// streams in one pass over its vertices. Which attributes the mesh has is
+// checked once per call, not for every vertex. Input arrays hold 3 floats a
+// vertex, as assimp's aiVector3D does. Positions and normals can be turned
+// from Z-up to Y-up on the way, (x, y, z) becoming (x, z, -y). The SSE2
+// version does 4 vertices at a time and is used unless MATHS_NO_SIMD is
+// defined. extract_streams_scalar () gives the same results. Large meshes are
+// split into chunks on a thread pool.
+//
+
+#ifndef _MESH_EXTRACT_H_
+#define _MESH_EXTRACT_H_
+
+#include "apg_pool.hpp"
+
+// vertices a thread takes at a time. meshes no bigger than this are done on
+// the calling thread
+#define EXTRACT_CHUNK 16384
+
+// an importer mesh's arrays, 3 floats a vertex. any may be NULL. tangents
+// are only used along with bitangents and normals
+struct Extract_Input {
+	const float* vertices;
+	const float* normals;
+	const float* texcoords;
+	const float* tangents;
+	const float* bitangents;
+};
+
+//
+// streams to fill. a stream is skipped if it or its input is NULL
+// vps, vns: 3 floats a vertex. correct_coords turns Z-up into Y-up
+// vts: the first 2 floats of each texture coordinate
+// vtangents: 4 floats a vertex. the tangent made perpendicular to the
+//   normal and normalised, then 1 or -1 for the handedness of tangent,
+//   bitangent and normal. worked out from the normals as imported
+struct Extract_Output {
+	float* vps;
+	float* vns;
+	float* vts;
+	float* vtangents;
+};
+
+// pool may be NULL to use only the calling thread
+void extract_streams (const Extract_Input* in, int count, bool correct_coords,
+	Apg_Pool* pool, Extract_Output* out);
+void extract_streams_scalar (const Extract_Input* in, int count,
+	bool correct_coords, Extract_Output* out);
+
+#endif
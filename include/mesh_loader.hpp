@@ -15,20 +15,18 @@
 #define MESH_VAO_VP_VN_VT_AND_BONES 2
 #define MESH_VAO_VP_VN_VT 3
 #define MESH_VAO_VP_VT 4
-#define MAX_VERTICES 65536
 
 #include "maths_funcs.hpp"
+#include "apg_bin.hpp"
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
-// must correspond to max array size in shader
-#define MAX_BONES 32
-// this doesn't have any real size limit except the total number of bones
-#define MAX_CHILDREN 32
-
-struct Anim_Node;
+// packed bone ids are 8 bits
+#define MAX_BONES 256
 
 // a position or scale key-frame for an Anim_Node
 struct pos_key {
@@ -42,42 +40,81 @@ struct rot_key {
 	versor q;
 };
 
-// an animated joint in the armature. may or may not be weighted to a bone
+//
+// an animated joint in the armature. may or may not be weighted to a bone.
+// nodes are stored depth-first in Mesh::nodes, so id is the node's index and
+// a parent always comes before its children
 struct Anim_Node {
-	Anim_Node ();
-	
-	std::vector<pos_key> pos_keyframes;
-	std::vector<pos_key> scale_keyframes;
-	std::vector<rot_key> rot_keyframes;
 	int id;
-	int num_children;
+	int name; // id in Mesh::names
+	int parent; // -1 for the root
+	int first_child, num_children; // into Mesh::node_children
 	int bone_index;
 	bool has_bone;
-	Anim_Node* children[MAX_CHILDREN];
 };
 
-struct Anim_Node_Name_Map {
-	Anim_Node_Name_Map ();
-	
-	aiString ass_name;
-	Anim_Node* anim_node_ptr;
+// a node's key-frames in one clip, as ranges of the mesh's key pools
+struct Anim_Channel {
+	int pos_first, pos_count; // into Mesh::pos_keyframes
+	int scale_first, scale_count; // into Mesh::scale_keyframes
+	int rot_first, rot_count; // into Mesh::rot_keyframes
+};
+
+// one animation. every clip has a channel for every node, indexed by node id
+struct Anim_Clip {
+	std::string name;
+	double duration; // seconds
+	std::vector<Anim_Channel> channels; // anim_node_count
 };
 
-// a mesh loaded from a file
+//
+// interned names. each distinct name is stored once and gets a compact id, in
+// the order names are first seen. lookups hash into an open-addressed table
+// of ids, so finding a name costs the same however many there are
+struct Name_Table {
+	std::vector<char> chars; // every name, nul-terminated, one after another
+	std::vector<uint32_t> offsets; // into chars, per id
+	std::vector<uint32_t> lengths; // per id
+	std::vector<uint32_t> hashes; // per id
+	std::vector<int> slots; // ids, or -1 if free. size is a power of two
+};
+
+// id of the name, adding it if it is new
+int intern_name (Name_Table* table, const char* str, uint32_t len);
+// id of the name, or -1 if it has not been interned
+int find_name (const Name_Table* table, const char* str, uint32_t len);
+
+// a mesh loaded from a file. every array is sized to the file's contents.
+// can be moved but not copied
 struct Mesh {
 	Mesh ();
+	Mesh (Mesh&&) = default;
+	Mesh& operator= (Mesh&&) = default;
+	Mesh (const Mesh&) = delete;
+	Mesh& operator= (const Mesh&) = delete;
 	
 	std::string file_name;
-	std::vector<Anim_Node_Name_Map> node_name_map;
-	std::vector<aiString> bone_names;
+	// every bone and node name. name_bones and name_nodes are indexed by id
+	Name_Table names;
+	std::vector<int> name_bones; // bone index, or -1 if no bone has the name
+	std::vector<int> name_nodes; // node id, or -1 if no node has the name
 	mat4 root_transform;
-	mat4 bone_offset_mats[MAX_BONES];
-	mat4 current_bone_transforms[MAX_BONES];
-	Anim_Node* root_node;
-	double anim_duration;
+	std::vector<mat4> bone_offset_mats; // bone_count
+	// the node tree. the root is nodes[0], or there are no nodes
+	std::vector<Anim_Node> nodes; // anim_node_count
+	std::vector<int> node_children; // node ids. each node's children together
+	std::vector<Anim_Clip> clips; // anim_count
+	// every clip's key-frames. channels with the same keys can share a range,
+	// even across clips
+	std::vector<pos_key> pos_keyframes, scale_keyframes;
+	std::vector<rot_key> rot_keyframes;
 	
 	std::vector<float> vps, vts, vns, vtangents;
-	int vbone_ids[MAX_VERTICES];
+	// APG_BONE_INFLUENCES per vertex, packed by apg_encode_bone_weights ().
+	// empty if the mesh has no bones
+	std::vector<uint8_t> vbone_ids, vbone_weights;
+	// 3 per triangle, into the vertex arrays above
+	std::vector<unsigned int> indices;
 	
 	unsigned int point_count;
 	unsigned int bone_count;
@@ -88,4 +125,11 @@ struct Mesh {
 // load mesh. generates VBOs but not VAO
 Mesh load_mesh (const char* file_name, bool correct_coords);
 
+//
+// appends copies of every clip of from to mesh, matching nodes by name, so
+// clips exported to separate files with the same skeleton can be stored
+// together. channels of nodes mesh does not have are dropped with a warning.
+// false if none of from's animated nodes are in mesh
+bool merge_clips (Mesh* mesh, const Mesh* from);
+
 #endif
@@ -0,0 +1,67 @@
+//
+// Mesh optimisation passes run by the converter before writing
+// First version 17 Oct 2026
+//
+// All passes work on a set of per-vertex streams plus a triangle index list.
+// Streams are treated as raw bytes, so float and int attributes are handled
+// alike and two vertices only count as the same if every stream is identical.
+//
+
+#ifndef _MESH_OPTIMISE_H_
+#define _MESH_OPTIMISE_H_
+
+// one per-vertex attribute array, e.g. positions. stride is the size in bytes
+// of one vertex' values and must be a multiple of 4
+struct Vertex_Stream {
+	void* data;
+	int stride;
+};
+
+//
+// removes duplicate vertices - those that are identical in every stream -
+// compacting all streams in place so that the first occurrence of each vertex
+// is kept, in order. indices are rewritten to refer to the welded vertices.
+// returns the new vertex count
+int weld_vertices (Vertex_Stream* streams, int stream_count, int vert_count,
+	unsigned int* indices, int index_count);
+
+// size of the LRU cache modelled when reordering triangles
+#define VERTEX_CACHE_SIZE 32
+// size of the FIFO cache simulated when reporting cache statistics
+#define VERTEX_CACHE_SIM_SIZE 32
+
+//
+// reorders triangles to improve post-transform vertex cache reuse, using Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation". deterministic, and
+// linear in the number of triangles. index_count must be a multiple of 3
+void optimise_vertex_cache (unsigned int* indices, int index_count,
+	int vert_count);
+
+//
+// simulates a FIFO post-transform cache of cache_size vertices over the
+// triangle list. acmr is the average cache miss ratio - misses per triangle,
+// 3 at worst and about 0.5 at best. atvr is the average transform to vertex
+// ratio - misses per vertex, 1 at best
+void vertex_cache_stats (const unsigned int* indices, int index_count,
+	int vert_count, int cache_size, float* acmr, float* atvr);
+
+// cache line size and direct-mapped cache size used to measure vertex fetch
+#define VERTEX_FETCH_LINE_SIZE 64
+#define VERTEX_FETCH_CACHE_LINES 256
+
+//
+// reorders vertices in every stream into the order the index list first uses
+// them, so drawing or skinning walks each stream forwards through memory.
+// indices are rewritten to match. vertices no index refers to are dropped.
+// run after the triangle order is final. returns the new vertex count
+int optimise_vertex_fetch (Vertex_Stream* streams, int stream_count,
+	int vert_count, unsigned int* indices, int index_count);
+
+//
+// counts the cache lines loaded when fetching every stream in index order
+// through a direct-mapped cache of VERTEX_FETCH_CACHE_LINES lines. each stream
+// is treated as a separate line-aligned array
+int vertex_fetch_stats (const Vertex_Stream* streams, int stream_count,
+	int vert_count, const unsigned int* indices, int index_count);
+
+#endif
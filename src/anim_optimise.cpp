@@ -0,0 +1,347 @@
+//
+// Animation key-frame passes run by the converter before writing
+// First version 17 Oct 2026
+// see anim_optimise.hpp
+//
+
+#include "anim_optimise.hpp"
+#include <string.h>
+#include <math.h>
+
+static float _distance (const vec3& a, const vec3& b) {
+	float x = a.v[0] - b.v[0], y = a.v[1] - b.v[1], z = a.v[2] - b.v[2];
+
+	return sqrtf (x * x + y * y + z * z);
+}
+
+//
+// angle in radians of the rotation from one versor to another. in double
+// because acos () of a float dot product can't resolve angles under ~0.05 deg
+static float _angle (const versor& a, const versor& b) {
+	double ab = 0.0, aa = 0.0, bb = 0.0, d;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		ab += (double)a.q[i] * b.q[i];
+		aa += (double)a.q[i] * a.q[i];
+		bb += (double)b.q[i] * b.q[i];
+	}
+	d = fabs (ab) / sqrt (aa * bb);
+	return d >= 1.0 ? 0.0f : (float)(2.0 * acos (d));
+}
+
+//
+// exactly unit length. normalise () leaves versors within 1e-4 as they are
+static versor _unit (const versor& q) {
+	double sum = 0.0;
+	versor r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		sum += (double)q.q[i] * q.q[i];
+	}
+	sum = 1.0 / sqrt (sum);
+	for (i = 0; i < 4; i++) {
+		r.q[i] = (float)(q.q[i] * sum);
+	}
+	return r;
+}
+
+// blend factor of time t between times a and b, as the viewer works it out
+static float _factor (double t, double a, double b) {
+	return (float)((t - a) / (b - a));
+}
+
+static vec3 _lerp (const pos_key& a, const pos_key& b, double t) {
+	vec3 va = a.v, vb = b.v; // vec3 operators are not const
+	float f = _factor (t, a.time, b.time);
+
+	return vb * f + va * (1.0f - f);
+}
+
+static versor _slerp (const rot_key& a, const rot_key& b, double t) {
+	versor q = a.q, r = b.q; // slerp () may flip its arguments
+
+	return slerp (q, r, _factor (t, a.time, b.time));
+}
+
+//
+// true if every key strictly between first and last is within tol of the
+// interpolation between those two
+static bool _pos_span_fits (const std::vector<pos_key>& keys, int first,
+	int last, float tol) {
+	int i;
+
+	for (i = first + 1; i < last; i++) {
+		if (_distance (_lerp (keys[first], keys[last], keys[i].time),
+			keys[i].v) > tol) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool _rot_span_fits (const std::vector<rot_key>& keys, int first,
+	int last, float tol) {
+	int i;
+
+	for (i = first + 1; i < last; i++) {
+		if (_angle (_slerp (keys[first], keys[last], keys[i].time),
+			keys[i].q) > tol) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// greedily extends each span from the last kept key for as long as the keys
+// it skips still fit. kept keys are compacted to the front of the vector
+void reduce_pos_keys (std::vector<pos_key>& keys, float tol) {
+	std::vector<pos_key> original;
+	int count = (int)keys.size ();
+	int kept = 1;
+	int anchor = 0;
+	int i;
+
+	if (count < 2) {
+		return;
+	}
+	for (i = 1; i < count; i++) {
+		if (_distance (keys[i].v, keys[0].v) > tol) {
+			break;
+		}
+	}
+	if (i == count) {
+		keys.resize (1);
+		return;
+	}
+	original = keys;
+	for (i = 2; i < count; i++) {
+		if (!_pos_span_fits (original, anchor, i, tol)) {
+			anchor = i - 1;
+			keys[kept++] = original[anchor];
+		}
+	}
+	keys[kept++] = original[count - 1];
+	keys.resize (kept);
+}
+
+void reduce_rot_keys (std::vector<rot_key>& keys, float tol) {
+	std::vector<rot_key> original;
+	int count = (int)keys.size ();
+	int kept = 1;
+	int anchor = 0;
+	int i;
+
+	if (count < 2) {
+		return;
+	}
+	for (i = 1; i < count; i++) {
+		if (_angle (keys[i].q, keys[0].q) > tol) {
+			break;
+		}
+	}
+	if (i == count) {
+		keys.resize (1);
+		return;
+	}
+	original = keys;
+	for (i = 2; i < count; i++) {
+		if (!_rot_span_fits (original, anchor, i, tol)) {
+			anchor = i - 1;
+			keys[kept++] = original[anchor];
+		}
+	}
+	keys[kept++] = original[count - 1];
+	keys.resize (kept);
+}
+
+//
+// number of keys a channel resampled at rate over duration gets. the last key
+// is at the duration itself, so the final interval may be shorter than 1/rate
+static int _resampled_count (double duration, float rate) {
+	int count = (int)ceil (duration * rate - 1e-6) + 1;
+
+	return count < 2 ? 2 : count;
+}
+
+//
+// advances span to the key the viewer would interpolate from at time t. times
+// passed in must not decrease, so the whole channel is walked only once
+template <typename Key>
+static int _advance_span (const std::vector<Key>& keys, int span, double t) {
+	while (span + 1 < (int)keys.size () - 1 && keys[span + 1].time < t) {
+		span++;
+	}
+	return span;
+}
+
+void resample_pos_keys (std::vector<pos_key>& keys, float rate,
+	double duration) {
+	std::vector<pos_key> original;
+	int count, span = 0;
+	int i;
+
+	if (keys.size () < 2) {
+		return;
+	}
+	original = keys;
+	count = _resampled_count (duration, rate);
+	keys.resize (count);
+	for (i = 0; i < count; i++) {
+		double t = (double)i / (double)rate;
+
+		if (t > duration) {
+			t = duration;
+		}
+		span = _advance_span (original, span, t);
+		keys[i].time = t;
+		keys[i].v = _lerp (original[span], original[span + 1], t);
+	}
+}
+
+void resample_rot_keys (std::vector<rot_key>& keys, float rate,
+	double duration) {
+	std::vector<rot_key> original;
+	int count, span = 0;
+	int i;
+
+	if (keys.size () < 2) {
+		return;
+	}
+	original = keys;
+	count = _resampled_count (duration, rate);
+	keys.resize (count);
+	for (i = 0; i < count; i++) {
+		double t = (double)i / (double)rate;
+
+		if (t > duration) {
+			t = duration;
+		}
+		span = _advance_span (original, span, t);
+		keys[i].time = t;
+		keys[i].q = _slerp (original[span], original[span + 1], t);
+		// keep keys unit length, or slerp () between close keys can stall
+		keys[i].q = _unit (keys[i].q);
+	}
+}
+
+//
+// FNV-1a. keys are hashed and compared field by field, as the structs have
+// padding
+static uint32_t _hash_bytes (uint32_t h, const void* data, size_t size) {
+	const uint8_t* b = (const uint8_t*)data;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		h = (h ^ b[i]) * 16777619u;
+	}
+	return h;
+}
+
+static uint32_t _hash_key (uint32_t h, const pos_key& k) {
+	h = _hash_bytes (h, &k.time, sizeof (k.time));
+	return _hash_bytes (h, k.v.v, sizeof (k.v.v));
+}
+
+static uint32_t _hash_key (uint32_t h, const rot_key& k) {
+	h = _hash_bytes (h, &k.time, sizeof (k.time));
+	return _hash_bytes (h, k.q.q, sizeof (k.q.q));
+}
+
+static bool _same_key (const pos_key& a, const pos_key& b) {
+	return memcmp (&a.time, &b.time, sizeof (a.time)) == 0 &&
+		memcmp (a.v.v, b.v.v, sizeof (a.v.v)) == 0;
+}
+
+static bool _same_key (const rot_key& a, const rot_key& b) {
+	return memcmp (&a.time, &b.time, sizeof (a.time)) == 0 &&
+		memcmp (a.q.q, b.q.q, sizeof (a.q.q)) == 0;
+}
+
+//
+// rebuilds one pool with each distinct run of keys once. first and count are
+// the pool's range in a channel. runs are found in an open-addressed hash
+// table of run ids, at least twice the number of channels with keys
+template <typename Key>
+static int _share_pool (Mesh* mesh, std::vector<Key>& pool,
+	int Anim_Channel::* first, int Anim_Channel::* count) {
+	std::vector<Key> shared;
+	std::vector<int> table;
+	// first key in shared, count, and hash of each distinct run
+	std::vector<int> run_firsts, run_counts;
+	std::vector<uint32_t> run_hashes;
+	uint32_t mask = 1;
+	int channels = 0, shared_count = 0;
+	size_t i, j;
+	int k;
+
+	for (i = 0; i < mesh->clips.size (); i++) {
+		for (j = 0; j < mesh->clips[i].channels.size (); j++) {
+			channels += mesh->clips[i].channels[j].*count > 0 ? 1 : 0;
+		}
+	}
+	while (mask < (uint32_t)channels * 2) {
+		mask <<= 1;
+	}
+	table.assign (mask, -1);
+	mask--;
+	shared.reserve (pool.size ());
+
+	for (i = 0; i < mesh->clips.size (); i++) {
+		for (j = 0; j < mesh->clips[i].channels.size (); j++) {
+			Anim_Channel* c = &mesh->clips[i].channels[j];
+			int n = c->*count;
+			const Key* keys = NULL;
+			uint32_t h = 2166136261u;
+			uint32_t slot = 0;
+
+			if (n < 1) {
+				c->*first = 0;
+				continue;
+			}
+			keys = &pool[c->*first];
+			h = _hash_bytes (h, &n, sizeof (n));
+			for (k = 0; k < n; k++) {
+				h = _hash_key (h, keys[k]);
+			}
+			for (slot = h & mask;; slot = (slot + 1) & mask) {
+				int r = table[slot];
+
+				if (r < 0) {
+					table[slot] = (int)run_firsts.size ();
+					run_firsts.push_back ((int)shared.size ());
+					run_counts.push_back (n);
+					run_hashes.push_back (h);
+					c->*first = (int)shared.size ();
+					shared.insert (shared.end (), keys, keys + n);
+					break;
+				}
+				if (run_hashes[r] == h && run_counts[r] == n) {
+					for (k = 0; k < n; k++) {
+						if (!_same_key (shared[run_firsts[r] + k], keys[k])) {
+							break;
+						}
+					}
+					if (k == n) {
+						c->*first = run_firsts[r];
+						shared_count++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	pool.swap (shared);
+	return shared_count;
+}
+
+int share_channels (Mesh* mesh) {
+	return _share_pool (mesh, mesh->pos_keyframes, &Anim_Channel::pos_first,
+		&Anim_Channel::pos_count) +
+		_share_pool (mesh, mesh->scale_keyframes, &Anim_Channel::scale_first,
+		&Anim_Channel::scale_count) +
+		_share_pool (mesh, mesh->rot_keyframes, &Anim_Channel::rot_first,
+		&Anim_Channel::rot_count);
+}
@@ -0,0 +1,485 @@
+//
+// Skeletal animation evaluation, with no graphics dependencies
+// First version 17 Oct 2026
+// see apg_anim.hpp
+//
+
+#include "apg_anim.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+static Apg_Rot_Interp _global_rot_interp = APG_ROT_SLERP;
+
+void apg_set_rot_interp (Apg_Rot_Interp mode) {
+	_global_rot_interp = APG_ROT_DEFAULT == mode ? APG_ROT_SLERP : mode;
+}
+
+Apg_Rot_Interp apg_get_rot_interp () {
+	return _global_rot_interp;
+}
+
+// the mode a clip's rot_interp resolves to
+static inline int _rot_interp (int clip_mode) {
+	return APG_ROT_DEFAULT == clip_mode ? _global_rot_interp : clip_mode;
+}
+
+// slerp () may flip q, so it is given copies
+static inline versor _blend_rot (versor q, versor r, float t, int mode) {
+	if (APG_ROT_NLERP == mode) {
+		return nlerp (q, r, t);
+	}
+	if (APG_ROT_NLERP_CORRECTED == mode) {
+		return nlerp_corrected (q, r, t);
+	}
+	return slerp (q, r, t);
+}
+
+static inline vec3 _lerp (const vec3& a, const vec3& b, float t) {
+	return vec3 (
+		a.v[0] + (b.v[0] - a.v[0]) * t,
+		a.v[1] + (b.v[1] - a.v[1]) * t,
+		a.v[2] + (b.v[2] - a.v[2]) * t
+	);
+}
+
+static inline versor _identity_versor () {
+	versor q;
+
+	q.q[0] = 1.0f;
+	q.q[1] = q.q[2] = q.q[3] = 0.0f;
+	return q;
+}
+
+//
+// normalise () leaves versors within 1e-4 of unit length as they are, which is
+// not close enough for slerp () between neighbouring samples
+static inline versor _unit (const versor& q) {
+	double sum = 0.0;
+	versor r;
+
+	for (int i = 0; i < 4; i++) {
+		sum += (double)q.q[i] * q.q[i];
+	}
+	sum = 1.0 / sqrt (sum);
+	for (int i = 0; i < 4; i++) {
+		r.q[i] = (float)(q.q[i] * sum);
+	}
+	return r;
+}
+
+// key times of a channel, read from the keys or through the loader if packed
+template <typename Key>
+struct Key_Times {
+	const Key* keys;
+	float operator() (int i) const { return keys[i].time; }
+};
+struct Rot_Key_Times {
+	const Animation* anim;
+	int channel;
+	float operator() (int i) const {
+		return apg_rot_key_time (anim, channel, i);
+	}
+};
+
+//
+// finds the key the viewer would interpolate from at time t: the last key
+// before t, but never the final key. count > 1. starts from span, the answer
+// for an earlier time, and steps forwards up to max_steps keys before binary
+// searching the rest. if t is before span it binary searches back to 0.
+// scanning from span 0 with no step limit is what the viewer did
+template <typename Times>
+static inline int _seek_span (Times times, int count, int span, int max_steps,
+	double t) {
+	int lo, hi;
+
+	if (span > count - 2) {
+		span = count - 2;
+	}
+	if (span > 0 && !(times (span) < t)) {
+		lo = 0;
+		hi = span - 1;
+	} else {
+		for (int i = 0; i < max_steps; i++) {
+			if (span + 1 > count - 2 || !(times (span + 1) < t)) {
+				return span;
+			}
+			span++;
+		}
+		lo = span;
+		hi = count - 2;
+	}
+	//
+	// times (lo) is before t, or lo is 0
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (times (mid) < t) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+//
+// evaluates one channel at time t. spans holds the tra, sca and rot spans to
+// search on from, and is updated. see _seek_span (). rot_mode is an
+// Apg_Rot_Interp other than APG_ROT_DEFAULT
+static void _eval_channel (const Animation* anim, int i, double t, int* spans,
+	int max_steps, int rot_mode, vec3* tra, vec3* sca, versor* rot) {
+	const Channel* c = &anim->channels[i];
+	RotAnimKey keys[2];
+	int span;
+	float f;
+
+	if (c->tra_keys_count > 1) {
+		Key_Times<TraAnimKey> times = { c->tra_keys };
+
+		span = spans[0] = _seek_span (times, c->tra_keys_count, spans[0],
+			max_steps, t);
+		f = (float)((t - c->tra_keys[span].time) /
+			(c->tra_keys[span + 1].time - c->tra_keys[span].time));
+		*tra = _lerp (c->tra_keys[span].tra, c->tra_keys[span + 1].tra, f);
+	} else if (1 == c->tra_keys_count) {
+		*tra = c->tra_keys[0].tra;
+	} else {
+		*tra = vec3 (0.0f, 0.0f, 0.0f);
+	}
+
+	if (c->sca_keys_count > 1) {
+		Key_Times<ScaAnimKey> times = { c->sca_keys };
+
+		span = spans[1] = _seek_span (times, c->sca_keys_count, spans[1],
+			max_steps, t);
+		f = (float)((t - c->sca_keys[span].time) /
+			(c->sca_keys[span + 1].time - c->sca_keys[span].time));
+		*sca = _lerp (c->sca_keys[span].sca, c->sca_keys[span + 1].sca, f);
+	} else if (1 == c->sca_keys_count) {
+		*sca = c->sca_keys[0].sca;
+	} else {
+		*sca = vec3 (1.0f, 1.0f, 1.0f);
+	}
+
+	//
+	// rotation keys may be packed, so they are fetched through the loader
+	if (c->rot_keys_count > 1) {
+		Rot_Key_Times times = { anim, i };
+
+		span = spans[2] = _seek_span (times, c->rot_keys_count, spans[2],
+			max_steps, t);
+		apg_get_rot_keys (anim, i, span, 2, keys);
+		f = (float)((t - keys[0].time) / (keys[1].time - keys[0].time));
+		*rot = _blend_rot (keys[0].rot, keys[1].rot, f, rot_mode);
+	} else if (1 == c->rot_keys_count) {
+		apg_get_rot_keys (anim, i, 0, 1, keys);
+		*rot = keys[0].rot;
+	} else {
+		*rot = _identity_versor ();
+	}
+}
+
+void apg_eval_keys (const Animation* anim, double t, vec3* tra, vec3* sca,
+	versor* rot) {
+	int rot_mode = _rot_interp (anim->rot_interp);
+
+	for (int i = 0; i < anim->num_channels; i++) {
+		int spans[3] = { 0, 0, 0 };
+
+		_eval_channel (anim, i, t, spans, INT_MAX, rot_mode, &tra[i], &sca[i],
+			&rot[i]);
+	}
+}
+
+bool apg_init_anim_cursor (const Animation* anim, Apg_Anim_Cursor* cursor) {
+	memset (cursor, 0, sizeof (Apg_Anim_Cursor));
+	cursor->spans = (int*)calloc (anim->num_channels * 3, sizeof (int));
+	if (anim->num_channels > 0 && !cursor->spans) {
+		fprintf (stderr, "ERROR: allocating cursor for anim %s\n", anim->name);
+		return false;
+	}
+	cursor->channel_count = anim->num_channels;
+	return true;
+}
+
+void apg_free_anim_cursor (Apg_Anim_Cursor* cursor) {
+	free (cursor->spans);
+	memset (cursor, 0, sizeof (Apg_Anim_Cursor));
+}
+
+void apg_eval_keys_cursor (const Animation* anim, Apg_Anim_Cursor* cursor,
+	double t, vec3* tra, vec3* sca, versor* rot) {
+	int rot_mode = _rot_interp (anim->rot_interp);
+
+	for (int i = 0; i < anim->num_channels; i++) {
+		_eval_channel (anim, i, t, &cursor->spans[i * 3], APG_CURSOR_MAX_STEPS,
+			rot_mode, &tra[i], &sca[i], &rot[i]);
+	}
+}
+
+bool apg_resample_anim (const Animation* anim, float rate,
+	Apg_Sampled_Anim* sampled) {
+	size_t n;
+
+	memset (sampled, 0, sizeof (Apg_Sampled_Anim));
+	if (!(rate > 0.0f) || anim->duration < 0.0) {
+		fprintf (stderr, "ERROR: can not resample anim %s at %f per second\n",
+			anim->name, rate);
+		return false;
+	}
+	//
+	// enough frames that the last one is at or past the end. it is sampled at
+	// the end itself, so the final interval may be shorter than 1 / rate
+	sampled->frame_count = (int)ceil (anim->duration * rate - 1e-6) + 1;
+	if (sampled->frame_count < 2) {
+		sampled->frame_count = 2;
+	}
+	sampled->node_count = anim->num_channels;
+	sampled->rate = rate;
+	sampled->duration = anim->duration;
+	sampled->rot_interp = anim->rot_interp;
+	n = (size_t)sampled->frame_count * sampled->node_count;
+	sampled->tra = (vec3*)malloc (n * sizeof (vec3));
+	sampled->sca = (vec3*)malloc (n * sizeof (vec3));
+	sampled->rot = (versor*)malloc (n * sizeof (versor));
+	if (!sampled->tra || !sampled->sca || !sampled->rot) {
+		fprintf (stderr, "ERROR: allocating %i resampled frames\n",
+			sampled->frame_count);
+		apg_free_sampled_anim (sampled);
+		return false;
+	}
+	//
+	// a channel at a time, walking forwards through its keys
+	for (int j = 0; j < sampled->node_count; j++) {
+		int spans[3] = { 0, 0, 0 };
+
+		for (int i = 0; i < sampled->frame_count; i++) {
+			double t = (double)i / (double)rate;
+			size_t k = (size_t)i * sampled->node_count + j;
+
+			if (t > anim->duration) {
+				t = anim->duration;
+			}
+			_eval_channel (anim, j, t, spans, INT_MAX, APG_ROT_SLERP,
+				&sampled->tra[k], &sampled->sca[k], &sampled->rot[k]);
+			//
+			// slerp () output can be a little over unit length. neighbouring
+			// samples are so close that their dot product would then reach 1 and
+			// slerp () between them would stop interpolating
+			sampled->rot[k] = _unit (sampled->rot[k]);
+		}
+	}
+	return true;
+}
+
+void apg_free_sampled_anim (Apg_Sampled_Anim* sampled) {
+	free (sampled->tra);
+	free (sampled->sca);
+	free (sampled->rot);
+	memset (sampled, 0, sizeof (Apg_Sampled_Anim));
+}
+
+void apg_sample_anim (const Apg_Sampled_Anim* sampled, double t, vec3* tra,
+	vec3* sca, versor* rot) {
+	const vec3 *tra_a, *tra_b, *sca_a, *sca_b;
+	const versor *rot_a, *rot_b;
+	double frame_t, next_t;
+	float f;
+	int frame, rot_mode = _rot_interp (sampled->rot_interp);
+
+	if (t > sampled->duration) {
+		t = sampled->duration;
+	}
+	if (t < 0.0) {
+		t = 0.0;
+	}
+	frame = (int)floor (t * sampled->rate);
+	if (frame > sampled->frame_count - 2) {
+		frame = sampled->frame_count - 2;
+	}
+	frame_t = (double)frame / (double)sampled->rate;
+	next_t = (double)(frame + 1) / (double)sampled->rate;
+	if (next_t > sampled->duration) {
+		next_t = sampled->duration;
+	}
+	f = next_t > frame_t ? (float)((t - frame_t) / (next_t - frame_t)) : 0.0f;
+
+	tra_a = &sampled->tra[(size_t)frame * sampled->node_count];
+	tra_b = tra_a + sampled->node_count;
+	sca_a = &sampled->sca[(size_t)frame * sampled->node_count];
+	sca_b = sca_a + sampled->node_count;
+	rot_a = &sampled->rot[(size_t)frame * sampled->node_count];
+	rot_b = rot_a + sampled->node_count;
+	for (int i = 0; i < sampled->node_count; i++) {
+		tra[i] = _lerp (tra_a[i], tra_b[i], f);
+		sca[i] = _lerp (sca_a[i], sca_b[i], f);
+		rot[i] = _blend_rot (rot_a[i], rot_b[i], f, rot_mode);
+	}
+}
+
+//
+// fills order with nodes sorted by depth, which puts every parent before its
+// children and keeps siblings in their original order
+static bool _sort_by_depth (const int* node_parents, int node_count,
+	int* order) {
+	int* depths = (int*)malloc (node_count * sizeof (int));
+	int* starts = (int*)calloc (node_count + 1, sizeof (int));
+	int max_depth = 0;
+
+	if (!depths || !starts) {
+		fprintf (stderr, "ERROR: allocating skeleton of %i nodes\n", node_count);
+		free (depths);
+		free (starts);
+		return false;
+	}
+	for (int i = 0; i < node_count; i++) {
+		int depth = 0;
+
+		for (int p = node_parents[i]; p > -1; p = node_parents[p]) {
+			if (++depth >= node_count) {
+				fprintf (stderr, "ERROR: node %i's parents form a loop\n", i);
+				free (depths);
+				free (starts);
+				return false;
+			}
+		}
+		depths[i] = depth;
+		starts[depth + 1]++;
+		if (depth > max_depth) {
+			max_depth = depth;
+		}
+	}
+	for (int d = 1; d <= max_depth; d++) {
+		starts[d] += starts[d - 1];
+	}
+	for (int i = 0; i < node_count; i++) {
+		order[starts[depths[i]]++] = i;
+	}
+	free (depths);
+	free (starts);
+	return true;
+}
+
+bool apg_init_skeleton (const int* node_parents, const int* node_bone_ids,
+	int node_count, int bone_count, Apg_Skeleton* skeleton) {
+	bool sorted = true;
+
+	memset (skeleton, 0, sizeof (Apg_Skeleton));
+	if (node_count < 1) {
+		return true;
+	}
+	for (int i = 0; i < node_count; i++) {
+		if (node_parents[i] < -1 || node_parents[i] >= node_count) {
+			fprintf (stderr, "ERROR: node %i has parent %i. %i nodes\n", i,
+				node_parents[i], node_count);
+			return false;
+		}
+		if (node_parents[i] >= i) {
+			sorted = false;
+		}
+		// a palette has bone_count entries, so a bigger id would write past it
+		if (node_bone_ids && (node_bone_ids[i] < -1 ||
+			node_bone_ids[i] >= bone_count)) {
+			fprintf (stderr, "ERROR: node %i has bone %i. %i bones\n", i,
+				node_bone_ids[i], bone_count);
+			return false;
+		}
+	}
+	skeleton->order = (int*)malloc (node_count * sizeof (int));
+	skeleton->parents = (int*)malloc (node_count * sizeof (int));
+	skeleton->bone_ids = (int*)malloc (node_count * sizeof (int));
+	if (!skeleton->order || !skeleton->parents || !skeleton->bone_ids) {
+		fprintf (stderr, "ERROR: allocating skeleton of %i nodes\n", node_count);
+		apg_free_skeleton (skeleton);
+		return false;
+	}
+	//
+	// files from the converter list nodes depth-first, so parents already come
+	// first and that order is kept
+	if (sorted) {
+		for (int i = 0; i < node_count; i++) {
+			skeleton->order[i] = i;
+		}
+	} else if (!_sort_by_depth (node_parents, node_count, skeleton->order)) {
+		apg_free_skeleton (skeleton);
+		return false;
+	}
+	//
+	// parents[] holds positions of nodes in the order. bone_ids is used as
+	// scratch for each node's position until the parents are worked out
+	for (int i = 0; i < node_count; i++) {
+		skeleton->bone_ids[skeleton->order[i]] = i;
+	}
+	for (int i = 0; i < node_count; i++) {
+		int parent = node_parents[skeleton->order[i]];
+
+		skeleton->parents[i] = parent > -1 ? skeleton->bone_ids[parent] : -1;
+	}
+	for (int i = 0; i < node_count; i++) {
+		skeleton->bone_ids[i] =
+			node_bone_ids ? node_bone_ids[skeleton->order[i]] : -1;
+	}
+	skeleton->node_count = node_count;
+	return true;
+}
+
+void apg_free_skeleton (Apg_Skeleton* skeleton) {
+	free (skeleton->order);
+	free (skeleton->parents);
+	free (skeleton->bone_ids);
+	memset (skeleton, 0, sizeof (Apg_Skeleton));
+}
+
+bool apg_alloc_pose (int node_count, Apg_Pose* pose) {
+	memset (pose, 0, sizeof (Apg_Pose));
+	pose->tra = (vec3*)malloc (node_count * sizeof (vec3));
+	pose->sca = (vec3*)malloc (node_count * sizeof (vec3));
+	pose->rot = (versor*)malloc (node_count * sizeof (versor));
+	pose->globals = (mat3x4*)malloc (node_count * sizeof (mat3x4));
+	if (node_count > 0 && (!pose->tra || !pose->sca || !pose->rot ||
+		!pose->globals)) {
+		fprintf (stderr, "ERROR: allocating pose of %i nodes\n", node_count);
+		apg_free_pose (pose);
+		return false;
+	}
+	pose->node_count = node_count;
+	return true;
+}
+
+void apg_free_pose (Apg_Pose* pose) {
+	free (pose->tra);
+	free (pose->sca);
+	free (pose->rot);
+	free (pose->globals);
+	memset (pose, 0, sizeof (Apg_Pose));
+}
+
+void apg_pose_globals (const Apg_Skeleton* skeleton, Apg_Pose* pose) {
+	for (int i = 0; i < skeleton->node_count; i++) {
+		int node = skeleton->order[i];
+		int parent = skeleton->parents[i];
+		mat3x4 local = trs_mat3x4 (pose->tra[node], pose->rot[node],
+			pose->sca[node]);
+
+		if (parent > -1) {
+			pose->globals[i] = pose->globals[parent] * local;
+		} else {
+			pose->globals[i] = local;
+		}
+	}
+}
+
+void apg_pose_palette (const Apg_Skeleton* skeleton, const Apg_Pose* pose,
+	const mat3x4& root_transform, const mat3x4* offset_mats,
+	mat3x4* palette) {
+	for (int i = 0; i < skeleton->node_count; i++) {
+		int bone = skeleton->bone_ids[i];
+
+		if (bone > -1) {
+			palette[bone] = root_transform * pose->globals[i] * offset_mats[bone];
+		}
+	}
+}
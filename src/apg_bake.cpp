@@ -0,0 +1,367 @@
+//
+// Baked skinning palettes for constant-time playback of fixed loops
+// First version 17 Oct 2026
+// see apg_bake.hpp
+//
+
+#include "apg_bake.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+bool apg_bake_clip (const Animation* anim, const Apg_Skeleton* skeleton,
+	const mat3x4& root_transform, const mat3x4* offset_mats, int bone_count,
+	float rate, Apg_Baked_Clip* baked) {
+	Apg_Anim_Cursor cursor;
+	Apg_Pose pose;
+	mat3x4* table = NULL;
+	size_t n;
+
+	memset ((void*)baked, 0, sizeof (Apg_Baked_Clip));
+	if (!(rate > 0.0f) || anim->duration < 0.0 || bone_count < 1) {
+		fprintf (stderr, "ERROR: can not bake anim %s at %f per second\n",
+			anim->name, rate);
+		return false;
+	}
+	//
+	// as apg_resample_anim (): the last sample is at the end itself
+	baked->sample_count = (int)ceil (anim->duration * rate - 1e-6) + 1;
+	if (baked->sample_count < 2) {
+		baked->sample_count = 2;
+	}
+	baked->rate = rate;
+	baked->duration = anim->duration;
+	baked->bone_count = bone_count;
+	n = (size_t)baked->sample_count * bone_count;
+	table = (mat3x4*)malloc (n * sizeof (mat3x4));
+	if (!table) {
+		fprintf (stderr, "ERROR: allocating %i baked palettes\n",
+			baked->sample_count);
+		return false;
+	}
+	if (!apg_alloc_pose (skeleton->node_count, &pose)) {
+		free (table);
+		return false;
+	}
+	if (!apg_init_anim_cursor (anim, &cursor)) {
+		apg_free_pose (&pose);
+		free (table);
+		return false;
+	}
+	for (int i = 0; i < baked->sample_count; i++) {
+		mat3x4* palette = &table[(size_t)i * bone_count];
+		double t = (double)i / (double)rate;
+
+		if (t > anim->duration) {
+			t = anim->duration;
+		}
+		for (int j = 0; j < bone_count; j++) {
+			palette[j] = identity_mat3x4 ();
+		}
+		apg_eval_keys_cursor (anim, &cursor, t, pose.tra, pose.sca, pose.rot);
+		apg_pose_globals (skeleton, &pose);
+		apg_pose_palette (skeleton, &pose, root_transform, offset_mats, palette);
+	}
+	apg_free_anim_cursor (&cursor);
+	apg_free_pose (&pose);
+	baked->palettes = table;
+	baked->owned = table;
+	return true;
+}
+
+bool apg_quantise_baked_clip (const Apg_Baked_Clip* in, Apg_Baked_Clip* out) {
+	size_t n = (size_t)in->sample_count * in->bone_count;
+	const float* v = (const float*)in->palettes;
+	uint16_t* packed = NULL;
+
+	memcpy ((void*)out, in, sizeof (Apg_Baked_Clip));
+	out->palettes = NULL;
+	out->owned = NULL;
+	if (!in->palettes || 0 == n) {
+		fprintf (stderr, "ERROR: only a float table can be quantised\n");
+		return false;
+	}
+	packed = (uint16_t*)malloc (n * APG_BAKED_COMPS * sizeof (uint16_t));
+	if (!packed) {
+		fprintf (stderr, "ERROR: allocating %i quantised palettes\n",
+			in->sample_count);
+		return false;
+	}
+	for (int c = 0; c < APG_BAKED_COMPS; c++) {
+		out->range[c] = out->range[c + APG_BAKED_COMPS] = v[c];
+	}
+	for (size_t i = 0; i < n * APG_BAKED_COMPS; i++) {
+		int c = (int)(i % APG_BAKED_COMPS);
+
+		out->range[c] = fminf (out->range[c], v[i]);
+		out->range[c + APG_BAKED_COMPS] = fmaxf (out->range[c + APG_BAKED_COMPS],
+			v[i]);
+	}
+	for (size_t i = 0; i < n * APG_BAKED_COMPS; i++) {
+		int c = (int)(i % APG_BAKED_COMPS);
+
+		packed[i] = apg_encode_aabb16 (v[i], out->range[c],
+			out->range[c + APG_BAKED_COMPS]);
+	}
+	out->packed = packed;
+	out->owned = packed;
+	return true;
+}
+
+void apg_free_baked_clip (Apg_Baked_Clip* baked) {
+	free (baked->owned);
+	memset ((void*)baked, 0, sizeof (Apg_Baked_Clip));
+}
+
+bool apg_get_baked_clip (const Apg_Mesh* mesh, int anim,
+	Apg_Baked_Clip* baked) {
+	const void* base = mesh->file.ptr;
+	const Apg_Bin_Section* s = NULL;
+	const Apg_Bin_Section* rate_s = NULL;
+	const Apg_Bin_Section* range_s = NULL;
+
+	memset ((void*)baked, 0, sizeof (Apg_Baked_Clip));
+	if (!mesh->mapped || anim < 0 || anim >= mesh->animation_count ||
+		mesh->bone_count < 1) {
+		return false;
+	}
+	s = apg_bin_find_section (base, APG_SECTION_BAKED_PALETTES, anim);
+	rate_s = apg_bin_find_section (base, APG_SECTION_BAKED_RATE, anim);
+	if (!s || !rate_s) {
+		return false;
+	}
+	if (s->comps != APG_BAKED_COMPS || s->count % mesh->bone_count != 0 ||
+		(int)(s->count / mesh->bone_count) < 2 || rate_s->type != APG_TYPE_F32 ||
+		rate_s->comps * rate_s->count != 1) {
+		fprintf (stderr, "ERROR: baked palettes of anim %i are malformed\n", anim);
+		return false;
+	}
+	if (APG_TYPE_F32 == s->type && APG_ENCODING_NONE == s->encoding) {
+		baked->palettes = (const mat3x4*)apg_bin_section_data (base, s);
+	} else if (APG_TYPE_U16 == s->type && APG_ENCODING_RANGE16 == s->encoding) {
+		range_s = apg_bin_find_section (base, APG_SECTION_BAKED_RANGE, anim);
+		if (!range_s || range_s->type != APG_TYPE_F32 ||
+			range_s->comps * range_s->count != APG_BAKED_COMPS * 2) {
+			fprintf (stderr, "ERROR: baked palettes of anim %i have no range\n",
+				anim);
+			return false;
+		}
+		memcpy (baked->range, apg_bin_section_data (base, range_s),
+			sizeof (baked->range));
+		baked->packed = (const uint16_t*)apg_bin_section_data (base, s);
+	} else {
+		fprintf (stderr, "ERROR: baked palettes of anim %i have bad type\n", anim);
+		return false;
+	}
+	baked->rate = *(const float*)apg_bin_section_data (base, rate_s);
+	baked->duration = mesh->animations[anim].duration;
+	baked->sample_count = (int)(s->count / mesh->bone_count);
+	baked->bone_count = mesh->bone_count;
+	return true;
+}
+
+size_t apg_baked_size (const Apg_Baked_Clip* baked) {
+	size_t n = (size_t)baked->sample_count * baked->bone_count;
+
+	return baked->packed ? n * APG_BAKED_COMPS * sizeof (uint16_t) :
+		n * sizeof (mat3x4);
+}
+
+//
+// first of the two samples around t, and how far t is towards the second. as
+// apg_sample_anim () finds its frames
+static int _baked_frame (const Apg_Baked_Clip* baked, double t, float* f) {
+	double frame_t, next_t;
+	int frame;
+
+	if (t > baked->duration) {
+		t = baked->duration;
+	}
+	if (t < 0.0) {
+		t = 0.0;
+	}
+	frame = (int)floor (t * baked->rate);
+	if (frame > baked->sample_count - 2) {
+		frame = baked->sample_count - 2;
+	}
+	frame_t = (double)frame / (double)baked->rate;
+	next_t = (double)(frame + 1) / (double)baked->rate;
+	if (next_t > baked->duration) {
+		next_t = baked->duration;
+	}
+	*f = next_t > frame_t ? (float)((t - frame_t) / (next_t - frame_t)) : 0.0f;
+	return frame;
+}
+
+void apg_sample_baked_scalar (const Apg_Baked_Clip* baked, double t,
+	mat3x4* palette) {
+	float f;
+	int frame = _baked_frame (baked, t, &f);
+	size_t first = (size_t)frame * baked->bone_count * APG_BAKED_COMPS;
+	size_t n = (size_t)baked->bone_count * APG_BAKED_COMPS;
+	float* out = (float*)palette;
+
+	if (baked->palettes) {
+		const float* a = (const float*)baked->palettes + first;
+		const float* b = a + n;
+
+		for (size_t i = 0; i < n; i++) {
+			out[i] = a[i] + (b[i] - a[i]) * f;
+		}
+		return;
+	}
+	const uint16_t* a = baked->packed + first;
+	const uint16_t* b = a + n;
+	float lo[APG_BAKED_COMPS], step[APG_BAKED_COMPS];
+
+	for (int c = 0; c < APG_BAKED_COMPS; c++) {
+		lo[c] = baked->range[c];
+		step[c] = (baked->range[c + APG_BAKED_COMPS] - baked->range[c]) /
+			65535.0f;
+	}
+	for (size_t i = 0; i < n; i++) {
+		int c = (int)(i % APG_BAKED_COMPS);
+		float qa = (float)a[i];
+		float qb = (float)b[i];
+
+		out[i] = lo[c] + step[c] * (qa + (qb - qa) * f);
+	}
+}
+
+#ifdef MATHS_SIMD
+//
+// a matrix's 12 16-bit values as 3 rows of floats
+static inline void _load_packed (const uint16_t* q, __m128* rows) {
+	const __m128i zero = _mm_setzero_si128 ();
+	__m128i r01 = _mm_loadu_si128 ((const __m128i*)q);
+	__m128i r2 = _mm_loadl_epi64 ((const __m128i*)(q + 8));
+
+	rows[0] = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (r01, zero));
+	rows[1] = _mm_cvtepi32_ps (_mm_unpackhi_epi16 (r01, zero));
+	rows[2] = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (r2, zero));
+}
+
+//
+// a row of each matrix at a time. the same sums in the same order as the
+// scalar version
+void apg_sample_baked (const Apg_Baked_Clip* baked, double t,
+	mat3x4* palette) {
+	float f;
+	int frame = _baked_frame (baked, t, &f);
+	size_t first = (size_t)frame * baked->bone_count;
+	const __m128 vf = _mm_set1_ps (f);
+
+	if (baked->palettes) {
+		const mat3x4* a = baked->palettes + first;
+		const mat3x4* b = a + baked->bone_count;
+
+		for (int i = 0; i < baked->bone_count; i++) {
+			for (int r = 0; r < 3; r++) {
+				__m128 va = _mm_load_ps (&a[i].m[r * 4]);
+				__m128 vb = _mm_load_ps (&b[i].m[r * 4]);
+
+				_mm_store_ps (&palette[i].m[r * 4],
+					_mm_add_ps (va, _mm_mul_ps (_mm_sub_ps (vb, va), vf)));
+			}
+		}
+		return;
+	}
+	const uint16_t* a = baked->packed + first * APG_BAKED_COMPS;
+	const uint16_t* b = a + (size_t)baked->bone_count * APG_BAKED_COMPS;
+	const __m128 inv = _mm_set1_ps (65535.0f);
+	__m128 lo[3], step[3];
+
+	for (int r = 0; r < 3; r++) {
+		lo[r] = _mm_loadu_ps (&baked->range[r * 4]);
+		step[r] = _mm_div_ps (_mm_sub_ps (
+			_mm_loadu_ps (&baked->range[APG_BAKED_COMPS + r * 4]), lo[r]), inv);
+	}
+	for (int i = 0; i < baked->bone_count; i++) {
+		__m128 qa[3], qb[3];
+
+		_load_packed (&a[i * APG_BAKED_COMPS], qa);
+		_load_packed (&b[i * APG_BAKED_COMPS], qb);
+		for (int r = 0; r < 3; r++) {
+			__m128 q = _mm_add_ps (qa[r], _mm_mul_ps (_mm_sub_ps (qb[r], qa[r]), vf));
+
+			_mm_store_ps (&palette[i].m[r * 4],
+				_mm_add_ps (lo[r], _mm_mul_ps (step[r], q)));
+		}
+	}
+}
+#else
+void apg_sample_baked (const Apg_Baked_Clip* baked, double t,
+	mat3x4* palette) {
+	apg_sample_baked_scalar (baked, t, palette);
+}
+#endif
+
+float apg_baked_error (const Apg_Baked_Clip* baked, const Animation* anim,
+	const Apg_Skeleton* skeleton, const mat3x4& root_transform,
+	const mat3x4* offset_mats, float radius, int steps) {
+	Apg_Anim_Cursor cursor;
+	Apg_Pose pose;
+	mat3x4* exact = NULL;
+	mat3x4* sampled = NULL;
+	float max_error = 0.0f;
+	int checks;
+
+	if (steps < 1) {
+		steps = 1;
+	}
+	exact = (mat3x4*)malloc (baked->bone_count * sizeof (mat3x4));
+	sampled = (mat3x4*)malloc (baked->bone_count * sizeof (mat3x4));
+	if (!exact || !sampled || !apg_alloc_pose (skeleton->node_count, &pose)) {
+		fprintf (stderr, "ERROR: allocating palettes to check\n");
+		free (exact);
+		free (sampled);
+		return -1.0f;
+	}
+	if (!apg_init_anim_cursor (anim, &cursor)) {
+		apg_free_pose (&pose);
+		free (exact);
+		free (sampled);
+		return -1.0f;
+	}
+	checks = (baked->sample_count - 1) * steps;
+	for (int k = 0; k <= checks; k++) {
+		double t = (double)k / ((double)baked->rate * steps);
+
+		if (t > baked->duration) {
+			t = baked->duration;
+		}
+		for (int j = 0; j < baked->bone_count; j++) {
+			exact[j] = identity_mat3x4 ();
+		}
+		apg_eval_keys_cursor (anim, &cursor, t, pose.tra, pose.sca, pose.rot);
+		apg_pose_globals (skeleton, &pose);
+		apg_pose_palette (skeleton, &pose, root_transform, offset_mats, exact);
+		apg_sample_baked (baked, t, sampled);
+		//
+		// a point p moves by (S - E) (p, 1), which is at most the 3x3 part's
+		// Frobenius norm times |p| plus the translation's length
+		for (int j = 0; j < baked->bone_count; j++) {
+			double lin = 0.0, tra = 0.0;
+
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 4; c++) {
+					double d = sampled[j].m[r * 4 + c] - exact[j].m[r * 4 + c];
+
+					if (c < 3) {
+						lin += d * d;
+					} else {
+						tra += d * d;
+					}
+				}
+			}
+			max_error = fmaxf (max_error,
+				(float)(sqrt (lin) * radius + sqrt (tra)));
+		}
+	}
+	apg_free_anim_cursor (&cursor);
+	apg_free_pose (&pose);
+	free (exact);
+	free (sampled);
+	return max_error;
+}
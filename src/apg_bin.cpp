@@ -0,0 +1,667 @@
+//
+// Binary .apg container format
+// First version 17 Oct 2026
+// see apg_bin.hpp for the layout
+//
+
+#include "apg_bin.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+size_t apg_bin_type_size (uint32_t type) {
+	switch (type) {
+		case APG_TYPE_U8: return 1;
+		case APG_TYPE_I16: return 2;
+		case APG_TYPE_U16: return 2;
+		case APG_TYPE_I32: return 4;
+		case APG_TYPE_U32: return 4;
+		case APG_TYPE_F32: return 4;
+		case APG_TYPE_F64: return 8;
+		default: return 0;
+	}
+}
+
+#ifdef _WIN32
+bool apg_map_file (const char* file_name, Apg_Mapped_File* mf) {
+	LARGE_INTEGER sz;
+	HANDLE fh, mh;
+
+	memset (mf, 0, sizeof (Apg_Mapped_File));
+	fh = CreateFileA (file_name, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (INVALID_HANDLE_VALUE == fh) {
+		fprintf (stderr, "ERROR: opening file %s for mapping\n", file_name);
+		return false;
+	}
+	if (!GetFileSizeEx (fh, &sz) || 0 == sz.QuadPart) {
+		fprintf (stderr, "ERROR: file %s is empty\n", file_name);
+		CloseHandle (fh);
+		return false;
+	}
+	mh = CreateFileMappingA (fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mh) {
+		fprintf (stderr, "ERROR: mapping file %s\n", file_name);
+		CloseHandle (fh);
+		return false;
+	}
+	mf->ptr = MapViewOfFile (mh, FILE_MAP_READ, 0, 0, 0);
+	if (!mf->ptr) {
+		fprintf (stderr, "ERROR: mapping view of file %s\n", file_name);
+		CloseHandle (mh);
+		CloseHandle (fh);
+		return false;
+	}
+	mf->size = (size_t)sz.QuadPart;
+	mf->file_handle = fh;
+	mf->mapping_handle = mh;
+	return true;
+}
+
+void apg_unmap_file (Apg_Mapped_File* mf) {
+	if (mf->ptr) {
+		UnmapViewOfFile (mf->ptr);
+		CloseHandle ((HANDLE)mf->mapping_handle);
+		CloseHandle ((HANDLE)mf->file_handle);
+	}
+	memset (mf, 0, sizeof (Apg_Mapped_File));
+}
+#else
+bool apg_map_file (const char* file_name, Apg_Mapped_File* mf) {
+	struct stat st;
+
+	memset (mf, 0, sizeof (Apg_Mapped_File));
+	mf->fd = open (file_name, O_RDONLY);
+	if (mf->fd < 0) {
+		fprintf (stderr, "ERROR: opening file %s for mapping\n", file_name);
+		return false;
+	}
+	if (fstat (mf->fd, &st) != 0 || 0 == st.st_size) {
+		fprintf (stderr, "ERROR: file %s is empty\n", file_name);
+		close (mf->fd);
+		return false;
+	}
+	mf->ptr = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, mf->fd, 0);
+	if (MAP_FAILED == mf->ptr) {
+		fprintf (stderr, "ERROR: mapping file %s\n", file_name);
+		mf->ptr = NULL;
+		close (mf->fd);
+		return false;
+	}
+	mf->size = (size_t)st.st_size;
+	return true;
+}
+
+void apg_unmap_file (Apg_Mapped_File* mf) {
+	if (mf->ptr) {
+		munmap (mf->ptr, mf->size);
+		close (mf->fd);
+	}
+	memset (mf, 0, sizeof (Apg_Mapped_File));
+}
+#endif
+
+bool apg_bin_is_bin (const void* ptr, size_t size) {
+	if (!ptr || size < sizeof (Apg_Bin_Header)) {
+		return false;
+	}
+	return memcmp (ptr, APG_BIN_MAGIC, 4) == 0;
+}
+
+bool apg_bin_validate (const void* ptr, size_t size) {
+	const Apg_Bin_Header* hdr = (const Apg_Bin_Header*)ptr;
+	const Apg_Bin_Section* sections = NULL;
+	uint32_t i;
+
+	if (!apg_bin_is_bin (ptr, size)) {
+		fprintf (stderr, "ERROR: not a binary .apg file\n");
+		return false;
+	}
+	if (hdr->version < APG_BIN_MIN_VERSION || hdr->version > APG_BIN_VERSION) {
+		fprintf (stderr, "ERROR: binary .apg version %u. expected %u to %u\n",
+			hdr->version, APG_BIN_MIN_VERSION, APG_BIN_VERSION);
+		return false;
+	}
+	if (hdr->file_size != size || hdr->directory_offset % 8 != 0 ||
+		hdr->directory_offset > size ||
+		(size - hdr->directory_offset) / sizeof (Apg_Bin_Section) <
+		hdr->section_count) {
+		fprintf (stderr, "ERROR: binary .apg directory is truncated\n");
+		return false;
+	}
+	sections = (const Apg_Bin_Section*)((const char*)ptr +
+		hdr->directory_offset);
+	for (i = 0; i < hdr->section_count; i++) {
+		const Apg_Bin_Section* s = &sections[i];
+		uint64_t tsz = apg_bin_type_size (s->type);
+		uint64_t values = 0 == tsz ? 0 : s->size / tsz;
+		bool size_ok = false;
+
+		//
+		// count * comps * tsz can wrap round 64 bits and match a small size, so
+		// size is divided down instead
+		if (0 == s->count || 0 == s->comps) {
+			size_ok = 0 == s->size;
+		} else if (tsz > 0 && s->size % tsz == 0 && values % s->comps == 0) {
+			size_ok = values / s->comps == s->count;
+		}
+		if (0 == tsz || !size_ok) {
+			fprintf (stderr, "ERROR: binary .apg section %u has bad size\n", i);
+			return false;
+		}
+		if (s->offset % APG_BIN_ALIGN != 0 || s->offset > size ||
+			s->size > size - s->offset) {
+			fprintf (stderr, "ERROR: binary .apg section %u out of bounds\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+const Apg_Bin_Section* apg_bin_find_section (const void* ptr, uint32_t id,
+	uint32_t index) {
+	const Apg_Bin_Header* hdr = (const Apg_Bin_Header*)ptr;
+	const Apg_Bin_Section* sections = (const Apg_Bin_Section*)(
+		(const char*)ptr + hdr->directory_offset);
+	uint32_t i;
+
+	for (i = 0; i < hdr->section_count; i++) {
+		if (sections[i].id == id && sections[i].index == index) {
+			return &sections[i];
+		}
+	}
+	return NULL;
+}
+
+const void* apg_bin_section_data (const void* ptr, const Apg_Bin_Section* s) {
+	return (const char*)ptr + s->offset;
+}
+
+uint32_t apg_bin_decoded_comps (const Apg_Bin_Section* s) {
+	switch (s->encoding) {
+		case APG_ENCODING_NONE:
+			return APG_TYPE_F32 == s->type ? s->comps : 0;
+		case APG_ENCODING_AABB16:
+		case APG_ENCODING_UNORM16:
+		case APG_ENCODING_HALF:
+		case APG_ENCODING_RANGE16:
+			return APG_TYPE_U16 == s->type ? s->comps : 0;
+		case APG_ENCODING_OCT16:
+			return APG_TYPE_I16 == s->type && 2 == s->comps ? 3 : 0;
+		case APG_ENCODING_10_10_10_2:
+			return APG_TYPE_U32 == s->type && 1 == s->comps ? 4 : 0;
+		case APG_ENCODING_SMALLEST3:
+			return APG_TYPE_U16 == s->type && 4 == s->comps ? 5 : 0;
+		case APG_ENCODING_UNORM8:
+			return APG_TYPE_U8 == s->type ? s->comps : 0;
+		default:
+			return 0;
+	}
+}
+
+// signed normalised int of the given bit width in the low bits of a uint32
+static inline uint32_t _encode_snorm (float v, int bits) {
+	int max = (1 << (bits - 1)) - 1;
+	float c = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+	int q = (int)(c * max + (c >= 0.0f ? 0.5f : -0.5f));
+
+	return (uint32_t)q & ((1u << bits) - 1);
+}
+
+static inline float _decode_snorm (uint32_t packed, int shift, int bits) {
+	int max = (1 << (bits - 1)) - 1;
+	// move the field to the top then sign-extend it back down
+	int q = (int)(packed << (32 - shift - bits)) >> (32 - bits);
+	float v = (float)q / (float)max;
+
+	return v < -1.0f ? -1.0f : v;
+}
+
+static inline float _sign_not_zero (float v) {
+	return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+static void _decode_oct16 (const int16_t* in, float* n) {
+	float x = in[0] / 32767.0f, y = in[1] / 32767.0f, z, len;
+
+	x = x < -1.0f ? -1.0f : x;
+	y = y < -1.0f ? -1.0f : y;
+	z = 1.0f - fabsf (x) - fabsf (y);
+	if (z < 0.0f) {
+		float tx = x;
+
+		x = (1.0f - fabsf (y)) * _sign_not_zero (tx);
+		y = (1.0f - fabsf (tx)) * _sign_not_zero (y);
+	}
+	len = sqrtf (x * x + y * y + z * z);
+	n[0] = x / len;
+	n[1] = y / len;
+	n[2] = z / len;
+}
+
+bool apg_bin_decode (const void* ptr, const Apg_Bin_Section* s,
+	const float* params, float* out) {
+	const void* data = apg_bin_section_data (ptr, s);
+	const uint8_t* u8 = (const uint8_t*)data;
+	const uint16_t* u16 = (const uint16_t*)data;
+	const int16_t* i16 = (const int16_t*)data;
+	const uint32_t* u32 = (const uint32_t*)data;
+	uint32_t comps = apg_bin_decoded_comps (s);
+	size_t n = (size_t)s->count * s->comps;
+	size_t i;
+
+	if (0 == comps || (APG_ENCODING_AABB16 == s->encoding && !params) ||
+		(APG_ENCODING_SMALLEST3 == s->encoding && !params) ||
+		(APG_ENCODING_RANGE16 == s->encoding && !params)) {
+		fprintf (stderr, "ERROR: binary .apg section %u has bad encoding %u\n",
+			s->id, s->encoding);
+		return false;
+	}
+	switch (s->encoding) {
+		case APG_ENCODING_NONE: {
+			memcpy (out, data, n * sizeof (float));
+		} break;
+		case APG_ENCODING_AABB16: {
+			for (i = 0; i < n; i++) {
+				uint32_t c = i % s->comps;
+				float min = c < 3 ? params[c] : 0.0f;
+				float max = c < 3 ? params[c + 3] : 0.0f;
+
+				out[i] = min + (max - min) * (u16[i] / 65535.0f);
+			}
+		} break;
+		case APG_ENCODING_UNORM16: {
+			for (i = 0; i < n; i++) {
+				out[i] = u16[i] / 65535.0f;
+			}
+		} break;
+		case APG_ENCODING_HALF: {
+			for (i = 0; i < n; i++) {
+				out[i] = apg_decode_half (u16[i]);
+			}
+		} break;
+		case APG_ENCODING_OCT16: {
+			for (i = 0; i < s->count; i++) {
+				_decode_oct16 (&i16[i * 2], &out[i * 3]);
+			}
+		} break;
+		case APG_ENCODING_10_10_10_2: {
+			for (i = 0; i < s->count; i++) {
+				out[i * 4] = _decode_snorm (u32[i], 0, 10);
+				out[i * 4 + 1] = _decode_snorm (u32[i], 10, 10);
+				out[i * 4 + 2] = _decode_snorm (u32[i], 20, 10);
+				out[i * 4 + 3] = _decode_snorm (u32[i], 30, 2);
+			}
+		} break;
+		case APG_ENCODING_SMALLEST3: {
+			for (i = 0; i < s->count; i++) {
+				out[i * 5] = apg_decode_key_time (u16[i * 4], params[0]);
+				apg_decode_smallest3 (&u16[i * 4 + 1], &out[i * 5 + 1]);
+			}
+		} break;
+		case APG_ENCODING_UNORM8: {
+			for (i = 0; i < n; i++) {
+				out[i] = u8[i] / 255.0f;
+			}
+		} break;
+		case APG_ENCODING_RANGE16: {
+			for (i = 0; i < n; i++) {
+				uint32_t c = i % s->comps;
+				float min = params[c];
+				float max = params[c + s->comps];
+
+				out[i] = min + (max - min) * (u16[i] / 65535.0f);
+			}
+		} break;
+	}
+	return true;
+}
+
+uint16_t apg_encode_aabb16 (float v, float min, float max) {
+	float t;
+
+	if (!(max > min)) {
+		return 0;
+	}
+	t = (v - min) / (max - min);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	return (uint16_t)(t * 65535.0f + 0.5f);
+}
+
+uint16_t apg_encode_unorm16 (float v) {
+	float t = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+
+	return (uint16_t)(t * 65535.0f + 0.5f);
+}
+
+uint16_t apg_encode_half (float v) {
+	uint32_t f, sign, rem, h;
+
+	memcpy (&f, &v, 4);
+	sign = (f >> 16) & 0x8000;
+	f &= 0x7FFFFFFF;
+	if (f >= 0x7F800000) { // inf or nan
+		return (uint16_t)(sign | 0x7C00 | (f > 0x7F800000 ? 0x200 : 0));
+	}
+	if (f >= 0x477FF000) { // rounds to 65520 or more, which is inf
+		return (uint16_t)(sign | 0x7C00);
+	}
+	//
+	// round to nearest, ties to even, on the bits shifted out
+	if (f < 0x38800000) { // below the smallest normal half, 2^-14
+		uint32_t shift = 126 - (f >> 23);
+		uint32_t mant = (f & 0x7FFFFF) | 0x800000;
+
+		if (shift > 24) {
+			return (uint16_t)sign;
+		}
+		h = mant >> shift;
+		rem = mant & ((1u << shift) - 1);
+		if (rem > (1u << (shift - 1)) || (rem == (1u << (shift - 1)) && (h & 1))) {
+			h++;
+		}
+		return (uint16_t)(sign | h);
+	}
+	h = (f - (112u << 23)) >> 13;
+	rem = f & 0x1FFF;
+	if (rem > 0x1000 || (0x1000 == rem && (h & 1))) {
+		h++;
+	}
+	return (uint16_t)(sign | h);
+}
+
+float apg_decode_half (uint16_t h) {
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t e = (h >> 10) & 0x1F;
+	uint32_t m = h & 0x3FF;
+	uint32_t f;
+	float v;
+
+	if (0 == e) { // zero or subnormal - exact in a float
+		v = m * (1.0f / 16777216.0f);
+		return sign ? -v : v;
+	}
+	if (31 == e) {
+		f = sign | 0x7F800000 | (m << 13);
+	} else {
+		f = sign | ((e + 112) << 23) | (m << 13);
+	}
+	memcpy (&v, &f, 4);
+	return v;
+}
+
+void apg_encode_oct16 (const float* n, int16_t* out) {
+	float l1 = fabsf (n[0]) + fabsf (n[1]) + fabsf (n[2]);
+	float x, y, fx, fy, best_dot = -2.0f;
+	int i, j;
+
+	out[0] = out[1] = 0;
+	if (!(l1 > 0.0f)) {
+		return;
+	}
+	x = n[0] / l1;
+	y = n[1] / l1;
+	if (n[2] < 0.0f) {
+		float tx = x;
+
+		x = (1.0f - fabsf (y)) * _sign_not_zero (tx);
+		y = (1.0f - fabsf (tx)) * _sign_not_zero (y);
+	}
+	//
+	// plain rounding is not always closest once decoded and normalised, so try
+	// all four grid points around the exact value and keep the best
+	fx = floorf (x * 32767.0f);
+	fy = floorf (y * 32767.0f);
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			int16_t q[2];
+			float d[3], dot;
+			float qx = fx + i, qy = fy + j;
+
+			q[0] = (int16_t)(qx < -32767.0f ? -32767.0f : (qx > 32767.0f ? 32767.0f : qx));
+			q[1] = (int16_t)(qy < -32767.0f ? -32767.0f : (qy > 32767.0f ? 32767.0f : qy));
+			_decode_oct16 (q, d);
+			dot = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+			if (dot > best_dot) {
+				best_dot = dot;
+				out[0] = q[0];
+				out[1] = q[1];
+			}
+		}
+	}
+}
+
+uint32_t apg_encode_10_10_10_2 (const float* v) {
+	return _encode_snorm (v[0], 10) | _encode_snorm (v[1], 10) << 10 |
+		_encode_snorm (v[2], 10) << 20 | _encode_snorm (v[3], 2) << 30;
+}
+
+#define SQRT_HALF 0.70710678f
+
+void apg_encode_smallest3 (const float* q, uint16_t* out) {
+	float len = sqrtf (q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	float scale = 0.0f;
+	int largest = 0;
+	int i, j = 0;
+
+	for (i = 1; i < 4; i++) {
+		if (fabsf (q[i]) > fabsf (q[largest])) {
+			largest = i;
+		}
+	}
+	if (len > 0.0f) {
+		scale = (q[largest] < 0.0f ? -1.0f : 1.0f) / len;
+	}
+	for (i = 0; i < 4; i++) {
+		float t;
+
+		if (i == largest) {
+			continue;
+		}
+		t = (q[i] * scale / SQRT_HALF + 1.0f) * 0.5f;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		out[j++] = (uint16_t)(t * 32767.0f + 0.5f);
+	}
+	out[0] |= (uint16_t)((largest & 1) << 15);
+	out[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+void apg_decode_smallest3 (const uint16_t* in, float* q) {
+	int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+	float a = ((in[0] & 0x7FFF) * (2.0f / 32767.0f) - 1.0f) * SQRT_HALF;
+	float b = ((in[1] & 0x7FFF) * (2.0f / 32767.0f) - 1.0f) * SQRT_HALF;
+	float c = ((in[2] & 0x7FFF) * (2.0f / 32767.0f) - 1.0f) * SQRT_HALF;
+	float d = 1.0f - a * a - b * b - c * c;
+	float* others[3];
+	int i, j = 0;
+
+	d = sqrtf (d > 0.0f ? d : 0.0f);
+	for (i = 0; i < 4; i++) {
+		if (i != largest) {
+			others[j++] = &q[i];
+		}
+	}
+	q[largest] = d;
+	*others[0] = a;
+	*others[1] = b;
+	*others[2] = c;
+}
+
+uint16_t apg_encode_key_time (double t, double duration) {
+	double f = duration > 0.0 ? t / duration : 0.0;
+
+	f = f < 0.0 ? 0.0 : (f > 1.0 ? 1.0 : f);
+	return (uint16_t)(f * 65535.0 + 0.5);
+}
+
+int apg_encode_bone_weights (const int* ids, const float* weights, int count,
+	uint8_t* out_ids, uint8_t* out_weights) {
+	int keep[APG_BONE_INFLUENCES];
+	int kept = 0;
+	float total = 0.0f;
+	int sum = 0;
+	int i, j;
+
+	memset (out_ids, 0, APG_BONE_INFLUENCES);
+	memset (out_weights, 0, APG_BONE_INFLUENCES);
+	//
+	// insertion sort into the largest few. ties keep the earlier influence
+	for (i = 0; i < count; i++) {
+		if (!(weights[i] > 0.0f)) {
+			continue;
+		}
+		if (APG_BONE_INFLUENCES == kept &&
+			weights[i] <= weights[keep[kept - 1]]) {
+			continue;
+		}
+		j = kept < APG_BONE_INFLUENCES ? kept++ : kept - 1;
+		for (; j > 0 && weights[keep[j - 1]] < weights[i]; j--) {
+			keep[j] = keep[j - 1];
+		}
+		keep[j] = i;
+	}
+	//
+	// prune from the smallest until every weight left is worth at least 1/255
+	// of what remains
+	while (kept > 0) {
+		total = 0.0f;
+		for (i = 0; i < kept; i++) {
+			total += weights[keep[i]];
+		}
+		if (weights[keep[kept - 1]] / total * 255.0f >= 0.5f) {
+			break;
+		}
+		kept--;
+	}
+	if (0 == kept) {
+		out_weights[0] = 255;
+		return 0;
+	}
+	for (i = 0; i < kept; i++) {
+		int q = (int)(weights[keep[i]] / total * 255.0f + 0.5f);
+
+		out_ids[i] = (uint8_t)ids[keep[i]];
+		out_weights[i] = (uint8_t)q;
+		sum += q;
+	}
+	//
+	// rounding leaves the sum at most kept / 2 off. the largest take it up,
+	// the last of any equal largest when taking away, so the order holds and
+	// packed weights pack to themselves again
+	for (; sum < 255; sum++) {
+		out_weights[0]++;
+	}
+	for (; sum > 255; sum--) {
+		for (j = 0; j + 1 < kept && out_weights[j + 1] == out_weights[0]; j++) {
+		}
+		out_weights[j]--;
+	}
+	return kept;
+}
+
+void apg_bin_writer_init (Apg_Bin_Writer* w) {
+	memset (w, 0, sizeof (Apg_Bin_Writer));
+	memcpy (w->header.magic, APG_BIN_MAGIC, 4);
+	w->header.version = APG_BIN_VERSION;
+	w->header.header_size = sizeof (Apg_Bin_Header);
+}
+
+bool apg_bin_add_section (Apg_Bin_Writer* w, uint32_t id, uint32_t type,
+	uint32_t comps, uint32_t count, uint32_t index, const void* data) {
+	Apg_Bin_Section* s = NULL;
+
+	if (w->section_count >= APG_BIN_MAX_SECTIONS) {
+		fprintf (stderr, "ERROR: too many sections in binary .apg. max %i\n",
+			APG_BIN_MAX_SECTIONS);
+		return false;
+	}
+	assert (apg_bin_type_size (type) > 0);
+	s = &w->sections[w->section_count];
+	s->id = id;
+	s->type = type;
+	s->comps = comps;
+	s->count = count;
+	s->index = index;
+	s->size = (uint64_t)count * comps * apg_bin_type_size (type);
+	w->data[w->section_count] = data;
+	w->section_count++;
+	return true;
+}
+
+bool apg_bin_add_encoded_section (Apg_Bin_Writer* w, uint32_t id,
+	uint32_t type, uint32_t comps, uint32_t count, uint32_t index,
+	uint32_t encoding, const void* data) {
+	if (!apg_bin_add_section (w, id, type, comps, count, index, data)) {
+		return false;
+	}
+	w->sections[w->section_count - 1].encoding = encoding;
+	assert (apg_bin_decoded_comps (&w->sections[w->section_count - 1]) > 0);
+	return true;
+}
+
+// round up to next multiple of APG_BIN_ALIGN
+static uint64_t _apg_bin_align (uint64_t offset) {
+	return (offset + APG_BIN_ALIGN - 1) & ~(uint64_t)(APG_BIN_ALIGN - 1);
+}
+
+uint64_t apg_bin_layout (Apg_Bin_Writer* w) {
+	uint64_t offset = 0;
+	uint32_t i;
+
+	//
+	// directory goes straight after the header, then the aligned payloads
+	w->header.section_count = w->section_count;
+	w->header.directory_offset = _apg_bin_align (sizeof (Apg_Bin_Header));
+	offset = w->header.directory_offset +
+		w->section_count * sizeof (Apg_Bin_Section);
+	for (i = 0; i < w->section_count; i++) {
+		offset = _apg_bin_align (offset);
+		w->sections[i].offset = offset;
+		offset += w->sections[i].size;
+	}
+	w->header.file_size = offset;
+	return offset;
+}
+
+void apg_bin_assemble (const Apg_Bin_Writer* w, void* dst) {
+	char* out = (char*)dst;
+	uint32_t i;
+
+	//
+	// zero everything first so the alignment padding is deterministic
+	memset (out, 0, w->header.file_size);
+	memcpy (out, &w->header, sizeof (Apg_Bin_Header));
+	memcpy (out + w->header.directory_offset, w->sections,
+		w->section_count * sizeof (Apg_Bin_Section));
+	for (i = 0; i < w->section_count; i++) {
+		if (w->sections[i].size > 0) {
+			memcpy (out + w->sections[i].offset, w->data[i], w->sections[i].size);
+		}
+	}
+}
+
+bool apg_bin_write (Apg_Bin_Writer* w, FILE* f) {
+	uint64_t size = apg_bin_layout (w);
+	void* buffer = NULL;
+	bool ok = false;
+
+	buffer = malloc (size);
+	if (!buffer) {
+		fprintf (stderr, "ERROR: allocating %llu bytes for binary .apg\n",
+			(unsigned long long)size);
+		return false;
+	}
+	apg_bin_assemble (w, buffer);
+	ok = fwrite (buffer, size, 1, f) == 1;
+	free (buffer);
+	return ok;
+}
@@ -0,0 +1,170 @@
+//
+// Many animated instances of one skeleton, evaluated across threads
+// First version 17 Oct 2026
+// see apg_crowd.hpp
+//
+
+#include "apg_crowd.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+bool apg_init_rig (const Apg_Mesh* mesh, Apg_Rig* rig) {
+	memset ((void*)rig, 0, sizeof (Apg_Rig));
+	if (mesh->animation_count < 1 || mesh->anim_node_count < 1) {
+		fprintf (stderr, "ERROR: mesh has no animations to make a rig from\n");
+		return false;
+	}
+	//
+	// offset_mats and every instance's palette have bone_count entries. the
+	// skeleton refuses bone ids outside them, so _update_instances () can't
+	// write past a palette
+	if (!apg_init_skeleton (mesh->node_parents, mesh->node_bone_ids,
+		mesh->anim_node_count, mesh->bone_count, &rig->skeleton)) {
+		return false;
+	}
+	rig->offset_mats = (mat3x4*)malloc (mesh->bone_count * sizeof (mat3x4));
+	if (mesh->bone_count > 0 && !rig->offset_mats) {
+		fprintf (stderr, "ERROR: allocating %i bone matrices\n", mesh->bone_count);
+		apg_free_rig (rig);
+		return false;
+	}
+	for (int i = 0; i < mesh->bone_count; i++) {
+		rig->offset_mats[i] = mat3x4_from_mat4 (mesh->offset_mats[i]);
+	}
+	rig->root_transform = mat3x4_from_mat4 (mesh->root_transform);
+	rig->baked = (Apg_Baked_Clip*)calloc (mesh->animation_count,
+		sizeof (Apg_Baked_Clip));
+	if (!rig->baked) {
+		fprintf (stderr, "ERROR: allocating %i baked clips\n",
+			mesh->animation_count);
+		apg_free_rig (rig);
+		return false;
+	}
+	for (int i = 0; i < mesh->animation_count; i++) {
+		apg_get_baked_clip (mesh, i, &rig->baked[i]);
+	}
+	rig->clips = mesh->animations;
+	rig->clip_count = mesh->animation_count;
+	rig->bone_count = mesh->bone_count;
+	rig->node_count = mesh->anim_node_count;
+	return true;
+}
+
+void apg_free_rig (Apg_Rig* rig) {
+	apg_free_skeleton (&rig->skeleton);
+	free (rig->offset_mats);
+	free (rig->baked);
+	memset ((void*)rig, 0, sizeof (Apg_Rig));
+}
+
+bool apg_init_crowd (const Apg_Rig* rig, int instance_count, int thread_count,
+	Apg_Crowd* crowd) {
+	size_t palette_count = (size_t)instance_count * rig->bone_count;
+
+	memset (crowd, 0, sizeof (Apg_Crowd));
+	crowd->rig = rig;
+	if (!apg_init_pool (thread_count, &crowd->pool)) {
+		return false;
+	}
+	crowd->instances = (Apg_Crowd_Instance*)calloc (instance_count,
+		sizeof (Apg_Crowd_Instance));
+	crowd->palettes = (mat3x4*)malloc (palette_count * sizeof (mat3x4));
+	crowd->poses = (Apg_Pose*)calloc (crowd->pool.thread_count,
+		sizeof (Apg_Pose));
+	if ((instance_count > 0 && !crowd->instances) ||
+		(palette_count > 0 && !crowd->palettes) || !crowd->poses) {
+		fprintf (stderr, "ERROR: allocating crowd of %i\n", instance_count);
+		apg_free_crowd (crowd);
+		return false;
+	}
+	for (int i = 0; i < crowd->pool.thread_count; i++) {
+		if (!apg_alloc_pose (rig->node_count, &crowd->poses[i])) {
+			apg_free_crowd (crowd);
+			return false;
+		}
+	}
+	for (size_t i = 0; i < palette_count; i++) {
+		crowd->palettes[i] = identity_mat3x4 ();
+	}
+	crowd->instance_count = instance_count;
+	for (int i = 0; i < instance_count; i++) {
+		Apg_Crowd_Instance* inst = &crowd->instances[i];
+
+		inst->speed = 1.0f;
+		if (!apg_init_anim_cursor (&rig->clips[0], &inst->cursor)) {
+			apg_free_crowd (crowd);
+			return false;
+		}
+	}
+	return true;
+}
+
+void apg_free_crowd (Apg_Crowd* crowd) {
+	for (int i = 0; i < crowd->instance_count; i++) {
+		apg_free_anim_cursor (&crowd->instances[i].cursor);
+	}
+	if (crowd->poses) {
+		for (int i = 0; i < crowd->pool.thread_count; i++) {
+			apg_free_pose (&crowd->poses[i]);
+		}
+	}
+	apg_free_pool (&crowd->pool);
+	free (crowd->instances);
+	free (crowd->palettes);
+	free (crowd->poses);
+	memset (crowd, 0, sizeof (Apg_Crowd));
+}
+
+mat3x4* apg_crowd_palette (const Apg_Crowd* crowd, int i) {
+	return &crowd->palettes[(size_t)i * crowd->rig->bone_count];
+}
+
+//
+// advances and evaluates instances [first, last) into worker's scratch pose.
+// only ever touches those instances and their palettes
+static void _update_instances (void* user, int first, int last, int worker) {
+	Apg_Crowd* crowd = (Apg_Crowd*)user;
+	const Apg_Rig* rig = crowd->rig;
+	Apg_Pose* pose = &crowd->poses[worker];
+
+	for (int i = first; i < last; i++) {
+		Apg_Crowd_Instance* inst = &crowd->instances[i];
+		const Animation* clip = &rig->clips[inst->clip];
+
+		inst->time += crowd->dt * inst->speed;
+		if (clip->duration > 0.0) {
+			inst->time = fmod (inst->time, clip->duration);
+			if (inst->time < 0.0) {
+				inst->time += clip->duration;
+			}
+		} else {
+			inst->time = 0.0;
+		}
+		if (rig->baked[inst->clip].sample_count > 0) {
+			apg_sample_baked (&rig->baked[inst->clip], inst->time,
+				apg_crowd_palette (crowd, i));
+			continue;
+		}
+		//
+		// all of a rig's clips have the same channels, so a cursor only needs
+		// sending back to the start for a new clip
+		if (inst->cursor_clip != inst->clip) {
+			memset (inst->cursor.spans, 0,
+				inst->cursor.channel_count * 3 * sizeof (int));
+			inst->cursor_clip = inst->clip;
+		}
+		apg_eval_keys_cursor (clip, &inst->cursor, inst->time, pose->tra,
+			pose->sca, pose->rot);
+		apg_pose_globals (&rig->skeleton, pose);
+		apg_pose_palette (&rig->skeleton, pose, rig->root_transform,
+			rig->offset_mats, apg_crowd_palette (crowd, i));
+	}
+}
+
+void apg_update_crowd (Apg_Crowd* crowd, double dt) {
+	crowd->dt = dt;
+	apg_pool_run (&crowd->pool, crowd->instance_count, APG_CROWD_CHUNK_SIZE,
+		_update_instances, crowd);
+}
@@ -0,0 +1,1133 @@
+//
+// .apg file loader - ASCII and binary - with no graphics dependencies
+// First version 17 Oct 2026
+//
+
+#include "apg_loader.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// powers of ten that are exactly representable as doubles
+static const double _pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+	1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool _is_space (char c) {
+	return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+static inline bool _is_digit (char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline const char* _skip_space (const char* p) {
+	while (_is_space (*p)) {
+		p++;
+	}
+	return p;
+}
+
+// skips blanks then one whitespace-delimited word
+static inline const char* _skip_word (const char* p) {
+	p = _skip_space (p);
+	while (*p && !_is_space (*p)) {
+		p++;
+	}
+	return p;
+}
+
+// moves to the start of the next line
+static inline const char* _skip_line (const char* p) {
+	while (*p && '\n' != *p) {
+		p++;
+	}
+	if ('\n' == *p) {
+		p++;
+	}
+	return p;
+}
+
+// copies the next word into str, truncating to max_len - 1 characters
+static const char* _read_word (const char* p, char* str, int max_len) {
+	int n = 0;
+
+	p = _skip_space (p);
+	while (*p && !_is_space (*p)) {
+		if (n < max_len - 1) {
+			str[n++] = *p;
+		}
+		p++;
+	}
+	str[n] = '\0';
+	return p;
+}
+
+// case-insensitive match of a lower-case word
+static bool _match_lower (const char* p, const char* word) {
+	for (; *word; p++, word++) {
+		if ((*p | 0x20) != *word) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// powers of ten that are exactly representable as floats
+static const float _pow10f[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+// a decimal number split into parts by _scan_number ()
+struct Apg_Num {
+	uint64_t mant;
+	int exp10;
+	bool neg;
+	int special; // 0 for a number. 1 for nan. 2 for infinity
+};
+
+//
+// mantissa of a number with more than 19 digits, which would overflow a
+// uint64. keeps the first 19 significant digits and adjusts the exponent
+static const char* _scan_long_mantissa (const char* s, Apg_Num* n) {
+	int digits = 0;
+
+	n->mant = 0;
+	n->exp10 = 0;
+	while (_is_digit (*s)) {
+		if (digits < 19) {
+			n->mant = n->mant * 10 + (*s - '0');
+			if (n->mant > 0) {
+				digits++;
+			}
+		} else {
+			n->exp10++;
+		}
+		s++;
+	}
+	if ('.' == *s) {
+		s++;
+		while (_is_digit (*s)) {
+			if (digits < 19) {
+				n->mant = n->mant * 10 + (*s - '0');
+				if (n->mant > 0) {
+					digits++;
+				}
+				n->exp10--;
+			}
+			s++;
+		}
+	}
+	return s;
+}
+
+//
+// splits a number into an integer mantissa and power of ten. returns false and
+// leaves *p at the first non-blank if there is no number
+static inline bool _scan_number (const char** p, Apg_Num* n) {
+	const char* s = _skip_space (*p);
+	const char* digits_start = NULL;
+	uint64_t mant = 0;
+	int int_digits = 0, frac_digits = 0;
+	bool any = false;
+
+	n->neg = false;
+	n->special = 0;
+	if ('-' == *s) {
+		n->neg = true;
+		s++;
+	} else if ('+' == *s) {
+		s++;
+	}
+	//
+	// plain accumulation with no per-digit bookkeeping. numbers too long for
+	// this to be exact are rare, so are scanned again more carefully below
+	digits_start = s;
+	while (_is_digit (*s)) {
+		mant = mant * 10 + (*s - '0');
+		s++;
+	}
+	int_digits = (int)(s - digits_start);
+	if ('.' == *s) {
+		const char* frac_start = ++s;
+
+		while (_is_digit (*s)) {
+			mant = mant * 10 + (*s - '0');
+			s++;
+		}
+		frac_digits = (int)(s - frac_start);
+	}
+	any = int_digits + frac_digits > 0;
+	if (int_digits + frac_digits > 19) {
+		s = _scan_long_mantissa (digits_start, n);
+	} else {
+		n->mant = mant;
+		n->exp10 = -frac_digits;
+	}
+	if (!any) {
+		// printf writes these for bad values
+		if (_match_lower (s, "nan")) {
+			*p = s + 3;
+			n->special = 1;
+			return true;
+		}
+		if (_match_lower (s, "inf")) {
+			*p = s + (_match_lower (s, "infinity") ? 8 : 3);
+			n->special = 2;
+			return true;
+		}
+		*p = _skip_space (*p);
+		return false;
+	}
+	if ('e' == *s || 'E' == *s) {
+		const char* e = s + 1;
+		bool eneg = false;
+		int ev = 0;
+
+		if ('-' == *e) {
+			eneg = true;
+			e++;
+		} else if ('+' == *e) {
+			e++;
+		}
+		if (_is_digit (*e)) {
+			while (_is_digit (*e)) {
+				if (ev < 10000) {
+					ev = ev * 10 + (*e - '0');
+				}
+				e++;
+			}
+			n->exp10 += eneg ? -ev : ev;
+			s = e;
+		}
+	}
+	*p = s;
+	return true;
+}
+
+//
+// scales the mantissa once by an exact power of ten, so values with up to 15
+// significant digits are correctly rounded
+static double _num_to_double (const Apg_Num* n) {
+	double v = (double)n->mant;
+
+	if (1 == n->special) {
+		return n->neg ? -NAN : NAN;
+	}
+	if (2 == n->special) {
+		return n->neg ? -INFINITY : INFINITY;
+	}
+	if (0 == n->mant) {
+		return n->neg ? -0.0 : 0.0;
+	}
+	if (n->exp10 < 0) {
+		if (n->exp10 >= -22) {
+			v /= _pow10[-n->exp10];
+		} else {
+			v *= pow (10.0, n->exp10);
+		}
+	} else if (n->exp10 > 0) {
+		if (n->exp10 <= 22) {
+			v *= _pow10[n->exp10];
+		} else {
+			v *= pow (10.0, n->exp10);
+		}
+	}
+	return n->neg ? -v : v;
+}
+
+//
+// when the mantissa and power of ten are both exact in a float a single float
+// multiply or divide is correctly rounded, which is the case for everything
+// the converter and exporter write. anything else goes through double
+static inline float _num_to_float (const Apg_Num* n) {
+	if (n->mant < (1 << 24) && n->exp10 >= -10 && n->exp10 <= 10 &&
+		0 == n->special) {
+		float v = (float)n->mant;
+
+		if (n->exp10 < 0) {
+			v /= _pow10f[-n->exp10];
+		} else {
+			v *= _pow10f[n->exp10];
+		}
+		return n->neg ? -v : v;
+	}
+	return (float)_num_to_double (n);
+}
+
+static double _parse_double (const char** p) {
+	Apg_Num n;
+
+	if (!_scan_number (p, &n)) {
+		return 0.0;
+	}
+	return _num_to_double (&n);
+}
+
+float apg_parse_float (const char** p) {
+	Apg_Num n;
+
+	if (!_scan_number (p, &n)) {
+		return 0.0f;
+	}
+	return _num_to_float (&n);
+}
+
+int apg_parse_int (const char** p) {
+	const char* s = _skip_space (*p);
+	int v = 0;
+	bool neg = false;
+
+	if ('-' == *s) {
+		neg = true;
+		s++;
+	} else if ('+' == *s) {
+		s++;
+	}
+	if (!_is_digit (*s)) {
+		*p = _skip_space (*p);
+		return 0;
+	}
+	while (_is_digit (*s)) {
+		v = v * 10 + (*s - '0');
+		s++;
+	}
+	*p = s;
+	return neg ? -v : v;
+}
+
+// allocates count floats and fills them from the buffer
+static float* _parse_float_block (const char** p, int count) {
+	float* block = NULL;
+	const char* s = *p;
+	int i;
+
+	if (count <= 0) {
+		return NULL;
+	}
+	block = (float*)malloc (count * sizeof (float));
+	assert (block);
+	for (i = 0; i < count; i++) {
+		const char* t = _skip_space (s);
+		const char* int_start = NULL;
+		const char* frac_start = NULL;
+		uint32_t mant = 0;
+		int digits = 0;
+		bool neg = '-' == *t;
+
+		//
+		// fast path for the plain "-ddd.ddd" that printf writes. up to 7 digits
+		// fit exactly in a float so one divide gives the correctly-rounded value.
+		// anything else, such as exponents or long mantissas, goes the long way
+		t += neg;
+		int_start = t;
+		while (_is_digit (*t)) {
+			mant = mant * 10 + (*t - '0');
+			t++;
+		}
+		digits = (int)(t - int_start);
+		frac_start = t;
+		if ('.' == *t) {
+			frac_start = ++t;
+			while (_is_digit (*t)) {
+				mant = mant * 10 + (*t - '0');
+				t++;
+			}
+			digits += (int)(t - frac_start);
+		}
+		if (digits > 0 && digits <= 7 && (_is_space (*t) || '\0' == *t)) {
+			float v = (float)mant / _pow10f[t - frac_start];
+
+			block[i] = neg ? -v : v;
+			s = t;
+		} else {
+			block[i] = apg_parse_float (&s);
+		}
+	}
+	*p = s;
+	return block;
+}
+
+static void _init_mesh (Apg_Mesh* mesh) {
+	memset ((void*)mesh, 0, sizeof (Apg_Mesh));
+	mesh->vb_type = APG_TYPE_F32;
+	mesh->vw_type = APG_TYPE_F32;
+	mesh->root_transform = identity_mat4 ();
+}
+
+static void _init_channels (Apg_Mesh* mesh) {
+	int i, j;
+
+	for (i = 0; i < mesh->animation_count; i++) {
+		mesh->animations[i].channels = (Channel*)malloc (
+			mesh->anim_node_count * sizeof (Channel));
+		for (j = 0; j < mesh->anim_node_count; j++) {
+			mesh->animations[i].channels[j].tra_keys = NULL;
+			mesh->animations[i].channels[j].tra_keys_count = 0;
+			mesh->animations[i].channels[j].sca_keys = NULL;
+			mesh->animations[i].channels[j].sca_keys_count = 0;
+			mesh->animations[i].channels[j].rot_keys = NULL;
+			mesh->animations[i].channels[j].packed_rot_keys = NULL;
+			mesh->animations[i].channels[j].rot_keys_count = 0;
+		}
+		mesh->animations[i].num_channels = mesh->anim_node_count;
+	}
+}
+
+//
+// parses "node N count N comps N" after a key tag and checks the node against
+// the hierarchy. returns the channel to fill, or NULL on error
+static Channel* _parse_key_tag (const char** p, Apg_Mesh* mesh,
+	int current_anim_index, int* count) {
+	const char* s = *p;
+	int node;
+
+	s = _skip_word (s); // node
+	node = apg_parse_int (&s);
+	s = _skip_word (s); // count
+	*count = apg_parse_int (&s);
+	s = _skip_word (s); // comps
+	apg_parse_int (&s);
+	*p = s;
+	if (current_anim_index < 0 || current_anim_index >= mesh->animation_count) {
+		fprintf (stderr, "ERROR: keys given outside of an animation\n");
+		return NULL;
+	}
+	if (node < 0 || node >= mesh->anim_node_count || *count < 0) {
+		fprintf (stderr, "ERROR: keys for node %i out of range\n", node);
+		return NULL;
+	}
+	return &mesh->animations[current_anim_index].channels[node];
+}
+
+bool apg_parse_mesh (const char* buffer, Apg_Mesh* mesh) {
+	const char* p = buffer;
+	int current_anim_index = -1;
+
+	_init_mesh (mesh);
+	while (*p) {
+		char tag[32];
+
+		p = _skip_space (p);
+		if ('@' != *p) {
+			p = _skip_line (p);
+			continue;
+		}
+		p = _read_word (p + 1, tag, sizeof (tag));
+
+		if (strcmp (tag, "vert_count") == 0) {
+			mesh->vert_count = apg_parse_int (&p);
+		} else if (strcmp (tag, "vp") == 0) {
+			p = _skip_word (p); // comps
+			mesh->vp_comps = apg_parse_int (&p);
+			mesh->vps = _parse_float_block (&p, mesh->vert_count * mesh->vp_comps);
+		} else if (strcmp (tag, "vn") == 0) {
+			p = _skip_word (p);
+			mesh->vn_comps = apg_parse_int (&p);
+			mesh->vns = _parse_float_block (&p, mesh->vert_count * mesh->vn_comps);
+		} else if (strcmp (tag, "vt") == 0) {
+			p = _skip_word (p);
+			mesh->vt_comps = apg_parse_int (&p);
+			mesh->vts = _parse_float_block (&p, mesh->vert_count * mesh->vt_comps);
+		} else if (strcmp (tag, "vtan") == 0) {
+			p = _skip_word (p);
+			mesh->vtan_comps = apg_parse_int (&p);
+			mesh->vtans = _parse_float_block (&p,
+				mesh->vert_count * mesh->vtan_comps);
+		} else if (strcmp (tag, "vb") == 0) {
+			p = _skip_word (p);
+			mesh->vb_comps = apg_parse_int (&p);
+			mesh->vbs = _parse_float_block (&p, mesh->vert_count * mesh->vb_comps);
+			mesh->vb_type = APG_TYPE_F32;
+		} else if (strcmp (tag, "vw") == 0) {
+			p = _skip_word (p);
+			mesh->vw_comps = apg_parse_int (&p);
+			mesh->vws = _parse_float_block (&p, mesh->vert_count * mesh->vw_comps);
+			mesh->vw_type = APG_TYPE_F32;
+		//@indices count 36 bits 16
+		} else if (strcmp (tag, "indices") == 0) {
+			int bits, i;
+
+			p = _skip_word (p);
+			mesh->index_count = apg_parse_int (&p);
+			p = _skip_word (p);
+			bits = apg_parse_int (&p);
+			if ((16 != bits && 32 != bits) || mesh->index_count < 0) {
+				fprintf (stderr, "ERROR: bad @indices tag\n");
+				return false;
+			}
+			mesh->index_type = 16 == bits ? APG_TYPE_U16 : APG_TYPE_U32;
+			mesh->indices = malloc (mesh->index_count * (bits / 8));
+			assert (mesh->indices);
+			for (i = 0; i < mesh->index_count; i++) {
+				int index = apg_parse_int (&p);
+
+				if (index < 0 || index >= mesh->vert_count) {
+					fprintf (stderr, "ERROR: index %i out of range\n", index);
+					return false;
+				}
+				if (16 == bits) {
+					((uint16_t*)mesh->indices)[i] = (uint16_t)index;
+				} else {
+					((uint32_t*)mesh->indices)[i] = (uint32_t)index;
+				}
+			}
+		//@skeleton bones 2 animations 1
+		} else if (strcmp (tag, "skeleton") == 0) {
+			int i;
+
+			p = _skip_word (p);
+			mesh->bone_count = apg_parse_int (&p);
+			p = _skip_word (p);
+			mesh->animation_count = apg_parse_int (&p);
+			if (mesh->bone_count < 0 || mesh->animation_count < 0) {
+				fprintf (stderr, "ERROR: bad @skeleton tag\n");
+				return false;
+			}
+			mesh->animations = (Animation*)malloc (
+				mesh->animation_count * sizeof (Animation));
+			for (i = 0; i < mesh->animation_count; i++) {
+				mesh->animations[i].name[0] = '\0';
+				mesh->animations[i].duration = 0.0;
+				mesh->animations[i].channels = NULL;
+				mesh->animations[i].num_channels = 0;
+				mesh->animations[i].rot_interp = 0;
+			}
+		//@root_transform comps 16
+		} else if (strcmp (tag, "root_transform") == 0) {
+			int comps, j;
+
+			p = _skip_word (p);
+			comps = apg_parse_int (&p);
+			for (j = 0; j < comps; j++) {
+				float f = apg_parse_float (&p);
+				if (j < 16) {
+					mesh->root_transform.m[j] = f;
+				}
+			}
+		//@offset_mat comps 16
+		} else if (strcmp (tag, "offset_mat") == 0) {
+			int comps, i, j;
+
+			p = _skip_word (p);
+			comps = apg_parse_int (&p);
+			mesh->offset_mats = (mat4*)malloc (mesh->bone_count * sizeof (mat4));
+			for (i = 0; i < mesh->bone_count; i++) {
+				mesh->offset_mats[i] = identity_mat4 ();
+				for (j = 0; j < comps; j++) {
+					float f = apg_parse_float (&p);
+					if (j < 16) {
+						mesh->offset_mats[i].m[j] = f;
+					}
+				}
+			}
+		//@hierarchy nodes 5
+		} else if (strcmp (tag, "hierarchy") == 0) {
+			int i;
+
+			p = _skip_word (p);
+			mesh->anim_node_count = apg_parse_int (&p);
+			if (mesh->anim_node_count < 0) {
+				fprintf (stderr, "ERROR: bad @hierarchy tag\n");
+				return false;
+			}
+			mesh->node_parents = (int*)malloc (mesh->anim_node_count * sizeof (int));
+			mesh->node_bone_ids = (int*)malloc (
+				mesh->anim_node_count * sizeof (int));
+			//parent -1 bone_id -1
+			for (i = 0; i < mesh->anim_node_count; i++) {
+				p = _skip_word (p);
+				mesh->node_parents[i] = apg_parse_int (&p);
+				p = _skip_word (p);
+				mesh->node_bone_ids[i] = apg_parse_int (&p);
+				if (mesh->node_bone_ids[i] < -1 ||
+					mesh->node_bone_ids[i] >= mesh->bone_count) {
+					fprintf (stderr, "ERROR: node %i bone %i out of range\n", i,
+						mesh->node_bone_ids[i]);
+					return false;
+				}
+			}
+			_init_channels (mesh);
+		//@animation name TODO duration 0.000000
+		} else if (strcmp (tag, "animation") == 0) {
+			current_anim_index++;
+			if (current_anim_index >= mesh->animation_count) {
+				fprintf (stderr, "ERROR: more animations than the %i in @skeleton\n",
+					mesh->animation_count);
+				return false;
+			}
+			p = _skip_word (p); // name
+			p = _read_word (p, mesh->animations[current_anim_index].name,
+				MAX_ANIM_NAME_LEN);
+			p = _skip_word (p); // duration
+			mesh->animations[current_anim_index].duration = _parse_double (&p);
+		//@tra_keys node 2 count 12 comps 3
+		} else if (strcmp (tag, "tra_keys") == 0) {
+			Channel* ch;
+			int count, i;
+
+			ch = _parse_key_tag (&p, mesh, current_anim_index, &count);
+			if (!ch) {
+				return false;
+			}
+			ch->tra_keys = (TraAnimKey*)malloc (count * sizeof (TraAnimKey));
+			ch->tra_keys_count = count;
+			//t 0.040000 TRA 0.000000 0.000000 0.000000
+			for (i = 0; i < count; i++) {
+				p = _skip_word (p);
+				ch->tra_keys[i].time = apg_parse_float (&p);
+				p = _skip_word (p);
+				ch->tra_keys[i].tra.v[0] = apg_parse_float (&p);
+				ch->tra_keys[i].tra.v[1] = apg_parse_float (&p);
+				ch->tra_keys[i].tra.v[2] = apg_parse_float (&p);
+			}
+		//@sca_keys node 2 count 12 comps 3
+		} else if (strcmp (tag, "sca_keys") == 0) {
+			Channel* ch;
+			int count, i;
+
+			ch = _parse_key_tag (&p, mesh, current_anim_index, &count);
+			if (!ch) {
+				return false;
+			}
+			ch->sca_keys = (ScaAnimKey*)malloc (count * sizeof (ScaAnimKey));
+			ch->sca_keys_count = count;
+			//t 0.040000 SCA 1.000000 1.000000 1.000000
+			for (i = 0; i < count; i++) {
+				p = _skip_word (p);
+				ch->sca_keys[i].time = apg_parse_float (&p);
+				p = _skip_word (p);
+				ch->sca_keys[i].sca.v[0] = apg_parse_float (&p);
+				ch->sca_keys[i].sca.v[1] = apg_parse_float (&p);
+				ch->sca_keys[i].sca.v[2] = apg_parse_float (&p);
+			}
+		//@rot_keys node 2 count 12 comps 4
+		} else if (strcmp (tag, "rot_keys") == 0) {
+			Channel* ch;
+			int count, i;
+
+			// NB: always 4 values per key. some exporters wrote "comps 3" here
+			ch = _parse_key_tag (&p, mesh, current_anim_index, &count);
+			if (!ch) {
+				return false;
+			}
+			ch->rot_keys = (RotAnimKey*)malloc (count * sizeof (RotAnimKey));
+			ch->rot_keys_count = count;
+			//t 0.040000 ROT 0.707107 0.707107 0.000000 0.000000
+			for (i = 0; i < count; i++) {
+				p = _skip_word (p);
+				ch->rot_keys[i].time = apg_parse_float (&p);
+				p = _skip_word (p);
+				ch->rot_keys[i].rot.q[0] = apg_parse_float (&p);
+				ch->rot_keys[i].rot.q[1] = apg_parse_float (&p);
+				ch->rot_keys[i].rot.q[2] = apg_parse_float (&p);
+				ch->rot_keys[i].rot.q[3] = apg_parse_float (&p);
+			}
+		} else if (strcmp (tag, "bounding_radius") == 0) {
+			mesh->bounding_radius = apg_parse_float (&p);
+		}
+		p = _skip_line (p);
+	}
+	return true;
+}
+
+//
+// float vertex streams point into the mapping. quantised ones are decoded into
+// one allocation, mesh->decoded
+static bool _load_bin_vertices (Apg_Mesh* mesh) {
+	const void* base = mesh->file.ptr;
+	const uint32_t ids[4] = {
+		APG_SECTION_VP, APG_SECTION_VN, APG_SECTION_VT, APG_SECTION_VTAN
+	};
+	float** streams[4] = { &mesh->vps, &mesh->vns, &mesh->vts, &mesh->vtans };
+	int* comps[4] = {
+		&mesh->vp_comps, &mesh->vn_comps, &mesh->vt_comps, &mesh->vtan_comps
+	};
+	const Apg_Bin_Section* bounds_s = NULL;
+	const float* bounds = NULL;
+	size_t decoded_floats = 0;
+	float* out = NULL;
+	int i;
+
+	bounds_s = apg_bin_find_section (base, APG_SECTION_VP_BOUNDS, 0);
+	if (bounds_s && APG_TYPE_F32 == bounds_s->type && 6 == bounds_s->comps &&
+		1 == bounds_s->count) {
+		bounds = (const float*)apg_bin_section_data (base, bounds_s);
+	}
+	for (i = 0; i < 4; i++) {
+		const Apg_Bin_Section* s = apg_bin_find_section (base, ids[i], 0);
+
+		if (s && s->encoding != APG_ENCODING_NONE) {
+			decoded_floats += (size_t)s->count * apg_bin_decoded_comps (s);
+		}
+	}
+	if (decoded_floats > 0) {
+		mesh->decoded = (float*)malloc (decoded_floats * sizeof (float));
+		if (!mesh->decoded) {
+			fprintf (stderr, "ERROR: allocating decoded vertex streams\n");
+			return false;
+		}
+	}
+	out = mesh->decoded;
+	for (i = 0; i < 4; i++) {
+		const Apg_Bin_Section* s = apg_bin_find_section (base, ids[i], 0);
+
+		if (!s) {
+			continue;
+		}
+		if ((int)s->count != mesh->vert_count) {
+			fprintf (stderr, "ERROR: binary mesh section %u has %u vertices, "
+				"not %i\n", ids[i], s->count, mesh->vert_count);
+			return false;
+		}
+		if (APG_ENCODING_NONE == s->encoding) {
+			*streams[i] = (float*)apg_bin_section_data (base, s);
+			*comps[i] = s->comps;
+			continue;
+		}
+		if (!apg_bin_decode (base, s, bounds, out)) {
+			return false;
+		}
+		*streams[i] = out;
+		*comps[i] = apg_bin_decoded_comps (s);
+		out += (size_t)s->count * *comps[i];
+	}
+	return true;
+}
+
+//
+// vertex data, offset matrices, hierarchy, and key-frames all point into the
+// mapping. only the small per-animation channel tables, and any quantised
+// vertex streams, are allocated
+static bool _load_bin (Apg_Mesh* mesh) {
+	const void* base = mesh->file.ptr;
+	const Apg_Bin_Header* hdr = NULL;
+	const Apg_Bin_Section* s = NULL;
+	int nodes = 0;
+	int i, j;
+
+	if (!apg_bin_validate (base, mesh->file.size)) {
+		return false;
+	}
+	hdr = (const Apg_Bin_Header*)base;
+	mesh->vert_count = (int)hdr->vert_count;
+	mesh->bounding_radius = hdr->bounding_radius;
+	if (!_load_bin_vertices (mesh)) {
+		return false;
+	}
+	s = apg_bin_find_section (base, APG_SECTION_VB, 0);
+	if (s) {
+		if ((int)s->count != mesh->vert_count) {
+			fprintf (stderr, "ERROR: binary mesh bone ids are not one per vertex\n");
+			return false;
+		}
+		mesh->vbs = (void*)apg_bin_section_data (base, s);
+		mesh->vb_comps = s->comps;
+		mesh->vb_type = s->type;
+		if (s->type != APG_TYPE_I32 && s->type != APG_TYPE_U8) {
+			fprintf (stderr, "ERROR: binary mesh bone ids have bad type\n");
+			return false;
+		}
+	}
+	s = apg_bin_find_section (base, APG_SECTION_VW, 0);
+	if (s) {
+		if ((int)s->count != mesh->vert_count) {
+			fprintf (stderr, "ERROR: binary mesh bone weights are not one per vertex\n");
+			return false;
+		}
+		mesh->vws = (void*)apg_bin_section_data (base, s);
+		mesh->vw_comps = s->comps;
+		mesh->vw_type = s->type;
+		if (!(APG_TYPE_F32 == s->type && APG_ENCODING_NONE == s->encoding) &&
+			!(APG_TYPE_U8 == s->type && APG_ENCODING_UNORM8 == s->encoding)) {
+			fprintf (stderr, "ERROR: binary mesh bone weights have bad type\n");
+			return false;
+		}
+	}
+	s = apg_bin_find_section (base, APG_SECTION_INDICES, 0);
+	if (s) {
+		if (s->type != APG_TYPE_U16 && s->type != APG_TYPE_U32) {
+			fprintf (stderr, "ERROR: binary mesh indices have bad type\n");
+			return false;
+		}
+		mesh->indices = (void*)apg_bin_section_data (base, s);
+		mesh->index_type = s->type;
+		mesh->index_count = (int)(s->count * s->comps);
+		//
+		// as the ASCII reader does, so a bad file can't send a draw call outside
+		// the vertex buffers
+		for (i = 0; i < mesh->index_count; i++) {
+			uint32_t index = 0;
+
+			if (APG_TYPE_U16 == s->type) {
+				index = ((const uint16_t*)mesh->indices)[i];
+			} else {
+				index = ((const uint32_t*)mesh->indices)[i];
+			}
+			if (index >= (uint32_t)mesh->vert_count) {
+				fprintf (stderr, "ERROR: index %u out of range\n", index);
+				return false;
+			}
+		}
+	}
+	if (0 == hdr->bone_count) {
+		return true;
+	}
+
+	//
+	// skeleton
+	mesh->bone_count = (int)hdr->bone_count;
+	nodes = mesh->anim_node_count = (int)hdr->anim_node_count;
+	s = apg_bin_find_section (base, APG_SECTION_ROOT_TRANSFORM, 0);
+	if (!s || s->comps != 16 || s->count != 1) {
+		fprintf (stderr, "ERROR: binary mesh has no root transform\n");
+		return false;
+	}
+	memcpy (mesh->root_transform.m, apg_bin_section_data (base, s),
+		sizeof (mat4));
+	s = apg_bin_find_section (base, APG_SECTION_OFFSET_MATS, 0);
+	if (!s || s->comps != 16 || (int)s->count != mesh->bone_count) {
+		fprintf (stderr, "ERROR: binary mesh has no offset matrices\n");
+		return false;
+	}
+	mesh->offset_mats = (mat4*)apg_bin_section_data (base, s);
+	s = apg_bin_find_section (base, APG_SECTION_NODE_PARENTS, 0);
+	if (!s || (int)s->count != nodes) {
+		fprintf (stderr, "ERROR: binary mesh has no node parents\n");
+		return false;
+	}
+	mesh->node_parents = (int*)apg_bin_section_data (base, s);
+	s = apg_bin_find_section (base, APG_SECTION_NODE_BONE_IDS, 0);
+	if (!s || (int)s->count != nodes) {
+		fprintf (stderr, "ERROR: binary mesh has no node bone ids\n");
+		return false;
+	}
+	mesh->node_bone_ids = (int*)apg_bin_section_data (base, s);
+	//
+	// a bone id indexes the palette and offset matrices, so one past them would
+	// have evaluation write outside the palette
+	for (i = 0; i < nodes; i++) {
+		if (mesh->node_bone_ids[i] < -1 ||
+			mesh->node_bone_ids[i] >= mesh->bone_count) {
+			fprintf (stderr, "ERROR: node %i bone %i out of range\n", i,
+				mesh->node_bone_ids[i]);
+			return false;
+		}
+	}
+
+	//
+	// animations. channels point into the mapped key arrays
+	assert (sizeof (TraAnimKey) == 4 * sizeof (float));
+	assert (sizeof (ScaAnimKey) == 4 * sizeof (float));
+	assert (sizeof (RotAnimKey) == 5 * sizeof (float));
+	assert (sizeof (PackedRotKey) == 4 * sizeof (uint16_t));
+	mesh->animation_count = (int)hdr->animation_count;
+	mesh->animations = (Animation*)calloc (mesh->animation_count,
+		sizeof (Animation));
+	for (i = 0; i < mesh->animation_count; i++) {
+		const Apg_Bin_Section* ch_s;
+		const Apg_Bin_Section* tra_s;
+		const Apg_Bin_Section* sca_s;
+		const Apg_Bin_Section* rot_s;
+		const int* ch;
+		bool packed;
+
+		s = apg_bin_find_section (base, APG_SECTION_ANIM_NAME, i);
+		if (s && s->count > 0) {
+			strncpy (mesh->animations[i].name,
+				(const char*)apg_bin_section_data (base, s), MAX_ANIM_NAME_LEN - 1);
+			mesh->animations[i].name[MAX_ANIM_NAME_LEN - 1] = '\0';
+		}
+		s = apg_bin_find_section (base, APG_SECTION_ANIM_DURATION, i);
+		if (s && s->count > 0) {
+			memcpy (&mesh->animations[i].duration, apg_bin_section_data (base, s),
+				sizeof (double));
+		}
+		ch_s = apg_bin_find_section (base, APG_SECTION_ANIM_CHANNELS, i);
+		tra_s = apg_bin_find_section (base, APG_SECTION_TRA_KEYS, i);
+		sca_s = apg_bin_find_section (base, APG_SECTION_SCA_KEYS, i);
+		rot_s = apg_bin_find_section (base, APG_SECTION_ROT_KEYS, i);
+		//
+		// clips of one file can share the key arrays stored with animation 0
+		if (!tra_s) {
+			tra_s = apg_bin_find_section (base, APG_SECTION_TRA_KEYS, 0);
+		}
+		if (!sca_s) {
+			sca_s = apg_bin_find_section (base, APG_SECTION_SCA_KEYS, 0);
+		}
+		if (!rot_s) {
+			rot_s = apg_bin_find_section (base, APG_SECTION_ROT_KEYS, 0);
+		}
+		if (!ch_s || !tra_s || !sca_s || !rot_s || (int)ch_s->count != nodes ||
+			ch_s->comps != APG_CHANNEL_COMPS || tra_s->comps != 4 ||
+			sca_s->comps != 4 || apg_bin_decoded_comps (rot_s) != 5) {
+			fprintf (stderr, "ERROR: binary mesh animation %i is incomplete\n", i);
+			return false;
+		}
+		packed = APG_ENCODING_SMALLEST3 == rot_s->encoding;
+		ch = (const int*)apg_bin_section_data (base, ch_s);
+		mesh->animations[i].channels = (Channel*)malloc (nodes * sizeof (Channel));
+		mesh->animations[i].num_channels = nodes;
+		for (j = 0; j < nodes; j++) {
+			const int* c = &ch[j * APG_CHANNEL_COMPS];
+			Channel* channel = &mesh->animations[i].channels[j];
+
+			if (c[0] < 0 || c[1] < 0 || c[0] + c[1] > (int)tra_s->count ||
+				c[2] < 0 || c[3] < 0 || c[2] + c[3] > (int)sca_s->count ||
+				c[4] < 0 || c[5] < 0 || c[4] + c[5] > (int)rot_s->count) {
+				fprintf (stderr, "ERROR: binary mesh channel %i out of range\n", j);
+				return false;
+			}
+			channel->tra_keys = (TraAnimKey*)apg_bin_section_data (base, tra_s) +
+				c[0];
+			channel->tra_keys_count = c[1];
+			channel->sca_keys = (ScaAnimKey*)apg_bin_section_data (base, sca_s) +
+				c[2];
+			channel->sca_keys_count = c[3];
+			if (packed) {
+				channel->rot_keys = NULL;
+				channel->packed_rot_keys =
+					(PackedRotKey*)apg_bin_section_data (base, rot_s) + c[4];
+			} else {
+				channel->rot_keys = (RotAnimKey*)apg_bin_section_data (base, rot_s) +
+					c[4];
+				channel->packed_rot_keys = NULL;
+			}
+			channel->rot_keys_count = c[5];
+		}
+	}
+	return true;
+}
+
+bool apg_load_mesh (const char* file_name, Apg_Mesh* mesh) {
+	Apg_Mapped_File mf;
+	FILE* f = NULL;
+	char* buffer = NULL;
+	long size = 0;
+	bool ok = false;
+
+	_init_mesh (mesh);
+	if (!apg_map_file (file_name, &mf)) {
+		return false;
+	}
+	if (apg_bin_is_bin (mf.ptr, mf.size)) {
+		mesh->mapped = true;
+		mesh->file = mf;
+		if (!_load_bin (mesh)) {
+			fprintf (stderr, "ERROR: reading binary mesh %s\n", file_name);
+			apg_free_mesh (mesh);
+			return false;
+		}
+		return true;
+	}
+
+	//
+	// ASCII. parser wants a nul-terminated buffer. read() copies straight from
+	// the page cache, which is cheaper than faulting in every page of the map
+	// and copying that
+	apg_unmap_file (&mf);
+	f = fopen (file_name, "rb");
+	if (!f) {
+		fprintf (stderr, "ERROR: opening file %s\n", file_name);
+		return false;
+	}
+	fseek (f, 0, SEEK_END);
+	size = ftell (f);
+	rewind (f);
+	buffer = (char*)malloc (size + 1);
+	if (!buffer) {
+		fprintf (stderr, "ERROR: out of memory reading %s\n", file_name);
+		fclose (f);
+		return false;
+	}
+	if (fread (buffer, 1, size, f) != (size_t)size) {
+		fprintf (stderr, "ERROR: reading file %s\n", file_name);
+		free (buffer);
+		fclose (f);
+		return false;
+	}
+	fclose (f);
+	buffer[size] = '\0';
+	ok = apg_parse_mesh (buffer, mesh);
+	free (buffer);
+	if (!ok) {
+		fprintf (stderr, "ERROR: parsing mesh %s\n", file_name);
+		apg_free_mesh (mesh);
+	}
+	return ok;
+}
+
+void apg_free_mesh (Apg_Mesh* mesh) {
+	int i, j;
+
+	for (i = 0; i < mesh->animation_count && mesh->animations; i++) {
+		if (!mesh->mapped) {
+			for (j = 0; j < mesh->animations[i].num_channels; j++) {
+				free (mesh->animations[i].channels[j].tra_keys);
+				free (mesh->animations[i].channels[j].sca_keys);
+				free (mesh->animations[i].channels[j].rot_keys);
+			}
+		}
+		free (mesh->animations[i].channels);
+	}
+	free (mesh->animations);
+	free (mesh->decoded);
+	if (mesh->mapped) {
+		apg_unmap_file (&mesh->file);
+	} else {
+		free (mesh->vps);
+		free (mesh->vns);
+		free (mesh->vts);
+		free (mesh->vtans);
+		free (mesh->vbs);
+		free (mesh->vws);
+		free (mesh->indices);
+		free (mesh->offset_mats);
+		free (mesh->node_parents);
+		free (mesh->node_bone_ids);
+	}
+	_init_mesh (mesh);
+}
+
+bool apg_mesh_packed_bones (const Apg_Mesh* mesh, uint8_t* ids,
+	uint8_t* weights) {
+	int comps = mesh->vb_comps;
+	bool has_weights = mesh->vws && mesh->vw_comps == comps && comps > 1;
+	int i, j;
+
+	if (!mesh->vbs || comps < 1 || comps > APG_BONE_INFLUENCES) {
+		fprintf (stderr, "ERROR: mesh has no bone ids to pack\n");
+		return false;
+	}
+	for (i = 0; i < mesh->vert_count; i++) {
+		int vids[APG_BONE_INFLUENCES];
+		float vweights[APG_BONE_INFLUENCES];
+
+		for (j = 0; j < comps; j++) {
+			size_t k = (size_t)i * comps + j;
+
+			if (APG_TYPE_U8 == mesh->vb_type) {
+				vids[j] = ((const uint8_t*)mesh->vbs)[k];
+			} else if (APG_TYPE_I32 == mesh->vb_type) {
+				vids[j] = ((const int*)mesh->vbs)[k];
+			} else {
+				vids[j] = (int)((const float*)mesh->vbs)[k];
+			}
+			if (vids[j] < 0 || vids[j] >= mesh->bone_count || vids[j] > 255) {
+				fprintf (stderr, "ERROR: vertex %i has bone id %i of %i bones\n", i,
+					vids[j], mesh->bone_count);
+				return false;
+			}
+			vweights[j] = 1.0f;
+			if (has_weights && APG_TYPE_U8 == mesh->vw_type) {
+				vweights[j] = ((const uint8_t*)mesh->vws)[k] / 255.0f;
+			} else if (has_weights) {
+				vweights[j] = ((const float*)mesh->vws)[k];
+			}
+		}
+		apg_encode_bone_weights (vids, vweights, comps,
+			&ids[i * APG_BONE_INFLUENCES], &weights[i * APG_BONE_INFLUENCES]);
+	}
+	return true;
+}
+
+#ifdef __SSE2__
+//
+// unpacks 4 keys. the same sums as apg_decode_smallest3 () in the same order,
+// so results are identical to the scalar path
+static void _unpack_rot_keys_x4 (const PackedRotKey* keys, float time_scale,
+	RotAnimKey* out) {
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i low_15 = _mm_set1_epi32 (0x7FFF);
+	const __m128 to_unit = _mm_set1_ps (2.0f / 32767.0f);
+	const __m128 one = _mm_set1_ps (1.0f);
+	const __m128 sqrt_half = _mm_set1_ps (0.70710678f);
+	__m128i k01, k23, lo, hi, tta, bbc;
+	__m128i t, a, b, c, largest;
+	__m128 fa, fb, fc, fd, ft;
+	float ta[4], aa[4], ba[4], ca[4], da[4];
+	int la[4];
+	int i;
+
+	//
+	// transpose 4 keys of 4 u16s into one u32 lane per key for each field
+	k01 = _mm_loadu_si128 ((const __m128i*)&keys[0]);
+	k23 = _mm_loadu_si128 ((const __m128i*)&keys[2]);
+	lo = _mm_unpacklo_epi16 (k01, k23); // t0 t2 a0 a2 b0 b2 c0 c2
+	hi = _mm_unpackhi_epi16 (k01, k23); // t1 t3 a1 a3 b1 b3 c1 c3
+	tta = _mm_unpacklo_epi16 (lo, hi); // t0 t1 t2 t3 a0 a1 a2 a3
+	bbc = _mm_unpackhi_epi16 (lo, hi); // b0 b1 b2 b3 c0 c1 c2 c3
+	t = _mm_unpacklo_epi16 (tta, zero);
+	a = _mm_unpackhi_epi16 (tta, zero);
+	b = _mm_unpacklo_epi16 (bbc, zero);
+	c = _mm_unpackhi_epi16 (bbc, zero);
+	largest = _mm_or_si128 (_mm_srli_epi32 (a, 15),
+		_mm_slli_epi32 (_mm_srli_epi32 (b, 15), 1));
+	fa = _mm_mul_ps (_mm_sub_ps (_mm_mul_ps (_mm_cvtepi32_ps (
+		_mm_and_si128 (a, low_15)), to_unit), one), sqrt_half);
+	fb = _mm_mul_ps (_mm_sub_ps (_mm_mul_ps (_mm_cvtepi32_ps (
+		_mm_and_si128 (b, low_15)), to_unit), one), sqrt_half);
+	fc = _mm_mul_ps (_mm_sub_ps (_mm_mul_ps (_mm_cvtepi32_ps (
+		_mm_and_si128 (c, low_15)), to_unit), one), sqrt_half);
+	fd = _mm_sub_ps (_mm_sub_ps (_mm_sub_ps (one, _mm_mul_ps (fa, fa)),
+		_mm_mul_ps (fb, fb)), _mm_mul_ps (fc, fc));
+	fd = _mm_sqrt_ps (_mm_max_ps (fd, _mm_setzero_ps ()));
+	ft = _mm_mul_ps (_mm_cvtepi32_ps (t), _mm_set1_ps (time_scale));
+	_mm_storeu_ps (ta, ft);
+	_mm_storeu_ps (aa, fa);
+	_mm_storeu_ps (ba, fb);
+	_mm_storeu_ps (ca, fc);
+	_mm_storeu_ps (da, fd);
+	_mm_storeu_si128 ((__m128i*)la, largest);
+	//
+	// the dropped component goes back in its own slot, the others around it
+	for (i = 0; i < 4; i++) {
+		float* q = out[i].rot.q;
+		int l = la[i];
+
+		out[i].time = ta[i];
+		q[l] = da[i];
+		q[l > 0 ? 0 : 1] = aa[i];
+		q[l > 1 ? 1 : 2] = ba[i];
+		q[l > 2 ? 2 : 3] = ca[i];
+	}
+}
+#endif
+
+void apg_get_rot_keys (const Animation* anim, int channel, int first,
+	int count, RotAnimKey* out) {
+	const Channel* c = &anim->channels[channel];
+	const PackedRotKey* keys = NULL;
+	float time_scale = (float)(anim->duration / 65535.0);
+	int i = 0;
+
+	assert (first >= 0 && first + count <= c->rot_keys_count);
+	if (c->rot_keys) {
+		memcpy (out, &c->rot_keys[first], count * sizeof (RotAnimKey));
+		return;
+	}
+	keys = &c->packed_rot_keys[first];
+#ifdef __SSE2__
+	for (; i + 4 <= count; i += 4) {
+		_unpack_rot_keys_x4 (&keys[i], time_scale, &out[i]);
+	}
+#endif
+	for (; i < count; i++) {
+		out[i].time = keys[i].time * time_scale;
+		apg_decode_smallest3 (keys[i].rot, out[i].rot.q);
+	}
+}
+
+float apg_rot_key_time (const Animation* anim, int channel, int key) {
+	const Channel* c = &anim->channels[channel];
+
+	if (c->rot_keys) {
+		return c->rot_keys[key].time;
+	}
+	return apg_decode_key_time (c->packed_rot_keys[key].time, anim->duration);
+}
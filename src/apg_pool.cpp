@@ -0,0 +1,247 @@
+//
+// Work-stealing thread pool
+// First version 17 Oct 2026
+// see apg_pool.hpp
+//
+
+#include "apg_pool.hpp"
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+//
+// a thread's queue: the chunks [begin, end) still to do, packed into one word
+// so the owner taking from the front and thieves taking from the back can
+// both update it with one compare-and-swap. one cache line each
+struct alignas (64) Work_Queue {
+	std::atomic<uint64_t> range;
+};
+
+struct Apg_Pool_Internal {
+	std::thread* threads; // thread_count - 1. the caller is worker 0
+	Work_Queue* queues; // thread_count
+	int thread_count;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned int generation; // bumped to start each run
+	int busy_threads; // pool threads yet to finish this run
+	bool quit;
+	// the current run
+	Apg_Pool_Func func;
+	void* user;
+	int count;
+	int chunk_size;
+};
+
+static inline uint64_t _pack (uint32_t begin, uint32_t end) {
+	return (uint64_t)end << 32 | begin;
+}
+
+// takes the chunk at the front of a queue. false if it is empty
+static bool _pop (Work_Queue* q, int* chunk) {
+	uint64_t r = q->range.load ();
+
+	for (;;) {
+		uint32_t begin = (uint32_t)r, end = (uint32_t)(r >> 32);
+
+		if (begin >= end) {
+			return false;
+		}
+		if (q->range.compare_exchange_weak (r, _pack (begin + 1, end))) {
+			*chunk = (int)begin;
+			return true;
+		}
+	}
+}
+
+//
+// takes the back half of victim's chunks. the first is returned to run now and
+// the rest become the thief's queue, which must be empty. false if there was
+// nothing to take
+static bool _steal (Work_Queue* victim, Work_Queue* thief, int* chunk) {
+	uint64_t r = victim->range.load ();
+
+	for (;;) {
+		uint32_t begin = (uint32_t)r, end = (uint32_t)(r >> 32);
+		uint32_t take;
+
+		if (begin >= end) {
+			return false;
+		}
+		take = (end - begin + 1) / 2;
+		if (victim->range.compare_exchange_weak (r, _pack (begin, end - take))) {
+			*chunk = (int)(end - take);
+			//
+			// an empty queue is never changed by other thieves, so a plain store
+			// is safe. a thief that read it as empty fails its swap
+			thief->range.store (_pack (end - take + 1, end));
+			return true;
+		}
+	}
+}
+
+static void _run_chunk (Apg_Pool_Internal* p, int chunk, int worker) {
+	int first = chunk * p->chunk_size;
+	int last = first + p->chunk_size;
+
+	if (last > p->count) {
+		last = p->count;
+	}
+	p->func (p->user, first, last, worker);
+}
+
+//
+// works through this thread's own queue then steals until no queue has
+// anything left. chunks are never added during a run, so once every queue
+// has been seen empty there is nothing more this thread can do
+static void _work (Apg_Pool_Internal* p, int worker) {
+	Work_Queue* own = &p->queues[worker];
+	int chunk;
+
+	for (;;) {
+		bool stolen = false;
+
+		while (_pop (own, &chunk)) {
+			_run_chunk (p, chunk, worker);
+		}
+		for (int i = 1; i < p->thread_count && !stolen; i++) {
+			int victim = (worker + i) % p->thread_count;
+
+			stolen = _steal (&p->queues[victim], own, &chunk);
+		}
+		if (!stolen) {
+			return;
+		}
+		_run_chunk (p, chunk, worker);
+	}
+}
+
+static void _thread_main (Apg_Pool_Internal* p, int worker) {
+	unsigned int seen = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock (p->mutex);
+			p->wake.wait (lock, [&] { return p->quit || p->generation != seen; });
+			if (p->quit) {
+				return;
+			}
+			seen = p->generation;
+		}
+		_work (p, worker);
+		{
+			std::lock_guard<std::mutex> lock (p->mutex);
+			if (0 == --p->busy_threads) {
+				p->done.notify_one ();
+			}
+		}
+	}
+}
+
+bool apg_init_pool (int thread_count, Apg_Pool* pool) {
+	Apg_Pool_Internal* p;
+
+	pool->internal = NULL;
+	pool->thread_count = 0;
+	if (thread_count < 1) {
+		thread_count = (int)std::thread::hardware_concurrency ();
+		if (thread_count < 1) {
+			thread_count = 1;
+		}
+	}
+	p = new (std::nothrow) Apg_Pool_Internal ();
+	if (!p) {
+		fprintf (stderr, "ERROR: allocating thread pool\n");
+		return false;
+	}
+	p->queues = new (std::nothrow) Work_Queue[thread_count];
+	p->threads = new (std::nothrow) std::thread[thread_count - 1];
+	if (!p->queues || !p->threads) {
+		fprintf (stderr, "ERROR: allocating thread pool of %i\n", thread_count);
+		delete[] p->queues;
+		delete[] p->threads;
+		delete p;
+		return false;
+	}
+	for (int i = 0; i < thread_count; i++) {
+		p->queues[i].range.store (0);
+	}
+	p->thread_count = thread_count;
+	p->generation = 0;
+	p->busy_threads = 0;
+	p->quit = false;
+	for (int i = 1; i < thread_count; i++) {
+		p->threads[i - 1] = std::thread (_thread_main, p, i);
+	}
+	pool->internal = p;
+	pool->thread_count = thread_count;
+	return true;
+}
+
+void apg_free_pool (Apg_Pool* pool) {
+	Apg_Pool_Internal* p = pool->internal;
+
+	if (!p) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock (p->mutex);
+		p->quit = true;
+	}
+	p->wake.notify_all ();
+	for (int i = 0; i < p->thread_count - 1; i++) {
+		p->threads[i].join ();
+	}
+	delete[] p->threads;
+	delete[] p->queues;
+	delete p;
+	pool->internal = NULL;
+	pool->thread_count = 0;
+}
+
+void apg_pool_run (Apg_Pool* pool, int count, int chunk_size,
+	Apg_Pool_Func func, void* user) {
+	Apg_Pool_Internal* p = pool->internal;
+	int chunks;
+
+	if (count < 1) {
+		return;
+	}
+	if (chunk_size < 1) {
+		chunk_size = 1;
+	}
+	chunks = (count - 1) / chunk_size + 1;
+	if (1 == p->thread_count || 1 == chunks) {
+		func (user, 0, count, 0);
+		return;
+	}
+	p->func = func;
+	p->user = user;
+	p->count = count;
+	p->chunk_size = chunk_size;
+	//
+	// contiguous even shares, so neighbouring items stay on one thread unless
+	// they are stolen
+	for (int i = 0; i < p->thread_count; i++) {
+		uint32_t begin = (uint32_t)((int64_t)chunks * i / p->thread_count);
+		uint32_t end = (uint32_t)((int64_t)chunks * (i + 1) / p->thread_count);
+
+		p->queues[i].range.store (_pack (begin, end));
+	}
+	{
+		std::lock_guard<std::mutex> lock (p->mutex);
+		p->busy_threads = p->thread_count - 1;
+		p->generation++;
+	}
+	p->wake.notify_all ();
+	_work (p, 0);
+	{
+		std::unique_lock<std::mutex> lock (p->mutex);
+		p->done.wait (lock, [&] { return 0 == p->busy_threads; });
+	}
+}
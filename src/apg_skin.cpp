@@ -0,0 +1,372 @@
+//
+// Linear blend skinning on the CPU
+// First version 17 Oct 2026
+// see apg_skin.hpp
+//
+
+#include "apg_skin.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// palettes up to this size are rearranged on the stack
+#define STACK_BONES 128
+
+static bool _check_input (const Apg_Skin_Input* in, int bone_count) {
+	if (in->influences < 1 || in->influences > APG_SKIN_MAX_INFLUENCES) {
+		fprintf (stderr, "ERROR: skinning with %i influences. max %i\n",
+			in->influences, APG_SKIN_MAX_INFLUENCES);
+		return false;
+	}
+	if (in->vtans && in->vtan_comps != 3 && in->vtan_comps != 4) {
+		fprintf (stderr, "ERROR: skinning tangents of %i comps\n",
+			in->vtan_comps);
+		return false;
+	}
+	if (in->vert_count > 0 && (!in->vps || !in->bone_ids || bone_count < 1)) {
+		fprintf (stderr, "ERROR: skinning needs points, bone ids and bones\n");
+		return false;
+	}
+	return true;
+}
+
+//
+// the matrix of vertex v: its first bone's times its weight, plus each other
+// bone's times its weight, in that order
+static inline void _blend_scalar (const Apg_Skin_Input* in,
+	const mat3x4* palette, int v, float* m) {
+	const int* ids = &in->bone_ids[(size_t)v * in->influences];
+	const float* w;
+
+	if (!in->weights) {
+		memcpy (m, palette[ids[0]].m, 12 * sizeof (float));
+		return;
+	}
+	w = &in->weights[(size_t)v * in->influences];
+	for (int e = 0; e < 12; e++) {
+		m[e] = palette[ids[0]].m[e] * w[0];
+	}
+	for (int k = 1; k < in->influences; k++) {
+		for (int e = 0; e < 12; e++) {
+			m[e] += palette[ids[k]].m[e] * w[k];
+		}
+	}
+}
+
+static inline void _direction_scalar (const float* m, const float* d,
+	float* out) {
+	float r[3], len2;
+
+	for (int i = 0; i < 3; i++) {
+		r[i] = m[i * 4] * d[0] + m[i * 4 + 1] * d[1] + m[i * 4 + 2] * d[2];
+	}
+	len2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+	if (len2 > 0.0f) {
+		float inv = 1.0f / sqrtf (len2);
+
+		for (int i = 0; i < 3; i++) {
+			r[i] *= inv;
+		}
+	}
+	memcpy (out, r, 3 * sizeof (float));
+}
+
+bool apg_skin_scalar (const Apg_Skin_Input* in, const mat3x4* palette,
+	int bone_count, Apg_Skin_Output* out) {
+	if (!_check_input (in, bone_count)) {
+		return false;
+	}
+	for (int v = 0; v < in->vert_count; v++) {
+		float m[12];
+
+		_blend_scalar (in, palette, v, m);
+		if (out->vps) {
+			const float* p = &in->vps[(size_t)v * 3];
+			float r[3];
+
+			for (int i = 0; i < 3; i++) {
+				r[i] = m[i * 4] * p[0] + m[i * 4 + 1] * p[1] + m[i * 4 + 2] * p[2] +
+					m[i * 4 + 3];
+			}
+			memcpy (&out->vps[(size_t)v * 3], r, 3 * sizeof (float));
+		}
+		if (in->vns && out->vns) {
+			_direction_scalar (m, &in->vns[(size_t)v * 3],
+				&out->vns[(size_t)v * 3]);
+		}
+		if (in->vtans && out->vtans) {
+			const float* t = &in->vtans[(size_t)v * in->vtan_comps];
+			float* o = &out->vtans[(size_t)v * in->vtan_comps];
+			float w = t[3 % in->vtan_comps];
+
+			_direction_scalar (m, t, o);
+			if (4 == in->vtan_comps) {
+				o[3] = w;
+			}
+		}
+	}
+	return true;
+}
+
+#ifdef MATHS_SIMD
+//
+// the SIMD path works with each bone's matrix as 4 columns, lane i of column
+// j being row i's element j, and lane 3 zero. a point is then
+// col0 * x + col1 * y + col2 * z + col3, all four lanes at once
+static void _palette_columns (const mat3x4* palette, int bone_count,
+	__m128* cols) {
+	for (int b = 0; b < bone_count; b++) {
+		const float* m = palette[b].m;
+
+		for (int j = 0; j < 4; j++) {
+			cols[b * 4 + j] = _mm_setr_ps (m[j], m[4 + j], m[8 + j], 0.0f);
+		}
+	}
+}
+
+static inline void _blend_sse (const Apg_Skin_Input* in, const __m128* cols,
+	int v, __m128* c) {
+	const int* ids = &in->bone_ids[(size_t)v * in->influences];
+	const __m128* p = &cols[ids[0] * 4];
+	const float* w;
+	__m128 wk;
+
+	if (!in->weights) {
+		for (int j = 0; j < 4; j++) {
+			c[j] = p[j];
+		}
+		return;
+	}
+	w = &in->weights[(size_t)v * in->influences];
+	wk = _mm_set1_ps (w[0]);
+	for (int j = 0; j < 4; j++) {
+		c[j] = _mm_mul_ps (p[j], wk);
+	}
+	for (int k = 1; k < in->influences; k++) {
+		p = &cols[ids[k] * 4];
+		wk = _mm_set1_ps (w[k]);
+		for (int j = 0; j < 4; j++) {
+			c[j] = _mm_add_ps (c[j], _mm_mul_ps (p[j], wk));
+		}
+	}
+}
+
+// writes lanes 0 to 2 only, so neighbouring vertices are not touched
+static inline void _store3 (float* out, __m128 v) {
+	_mm_storel_pi ((__m64*)out, v);
+	_mm_store_ss (out + 2, _mm_movehl_ps (v, v));
+}
+
+static inline __m128 _transform_sse (const __m128* c, const float* d) {
+	__m128 r = _mm_mul_ps (c[0], _mm_set1_ps (d[0]));
+	r = _mm_add_ps (r, _mm_mul_ps (c[1], _mm_set1_ps (d[1])));
+	return _mm_add_ps (r, _mm_mul_ps (c[2], _mm_set1_ps (d[2])));
+}
+
+// unit length, adding up the squares in the same order as the reference
+static inline __m128 _unit_sse (__m128 r) {
+	__m128 sq = _mm_mul_ps (r, r);
+	__m128 len2 = _mm_add_ss (_mm_add_ss (sq, _mm_shuffle_ps (sq, sq, 1)),
+		_mm_movehl_ps (sq, sq));
+
+	if (_mm_cvtss_f32 (len2) > 0.0f) {
+		__m128 inv = _mm_div_ss (_mm_set_ss (1.0f), _mm_sqrt_ss (len2));
+		r = _mm_mul_ps (r, _mm_shuffle_ps (inv, inv, 0));
+	}
+	return r;
+}
+
+static inline void _skin_vertex_sse (const Apg_Skin_Input* in,
+	const __m128* cols, int v, Apg_Skin_Output* out) {
+	__m128 c[4];
+
+	_blend_sse (in, cols, v, c);
+	if (out->vps) {
+		const float* p = &in->vps[(size_t)v * 3];
+
+		_store3 (&out->vps[(size_t)v * 3], _mm_add_ps (_transform_sse (c, p),
+			c[3]));
+	}
+	if (in->vns && out->vns) {
+		_store3 (&out->vns[(size_t)v * 3],
+			_unit_sse (_transform_sse (c, &in->vns[(size_t)v * 3])));
+	}
+	if (in->vtans && out->vtans) {
+		const float* t = &in->vtans[(size_t)v * in->vtan_comps];
+		float* o = &out->vtans[(size_t)v * in->vtan_comps];
+		float w = t[3 % in->vtan_comps];
+
+		_store3 (o, _unit_sse (_transform_sse (c, t)));
+		if (4 == in->vtan_comps) {
+			o[3] = w;
+		}
+	}
+}
+
+#ifdef __AVX__
+//
+// two vertices at once: the first in the low 128 bits, the second in the high
+static inline __m256 _pair (__m128 lo, __m128 hi) {
+	return _mm256_insertf128_ps (_mm256_castps128_ps256 (lo), hi, 1);
+}
+
+static inline __m256 _pair_set1 (float lo, float hi) {
+	return _pair (_mm_set1_ps (lo), _mm_set1_ps (hi));
+}
+
+static inline void _blend_avx (const Apg_Skin_Input* in, const __m128* cols,
+	int v, __m256* c) {
+	const int* ids = &in->bone_ids[(size_t)v * in->influences];
+	const int* ids_b = ids + in->influences;
+	const float *w, *w_b;
+	__m256 wk;
+
+	if (!in->weights) {
+		for (int j = 0; j < 4; j++) {
+			c[j] = _pair (cols[ids[0] * 4 + j], cols[ids_b[0] * 4 + j]);
+		}
+		return;
+	}
+	w = &in->weights[(size_t)v * in->influences];
+	w_b = w + in->influences;
+	wk = _pair_set1 (w[0], w_b[0]);
+	for (int j = 0; j < 4; j++) {
+		c[j] = _mm256_mul_ps (_pair (cols[ids[0] * 4 + j], cols[ids_b[0] * 4 + j]),
+			wk);
+	}
+	for (int k = 1; k < in->influences; k++) {
+		wk = _pair_set1 (w[k], w_b[k]);
+		for (int j = 0; j < 4; j++) {
+			__m256 p = _pair (cols[ids[k] * 4 + j], cols[ids_b[k] * 4 + j]);
+
+			c[j] = _mm256_add_ps (c[j], _mm256_mul_ps (p, wk));
+		}
+	}
+}
+
+// d and d_b are the two vertices' points or directions
+static inline __m256 _transform_avx (const __m256* c, const float* d,
+	const float* d_b) {
+	__m256 r = _mm256_mul_ps (c[0], _pair_set1 (d[0], d_b[0]));
+	r = _mm256_add_ps (r, _mm256_mul_ps (c[1], _pair_set1 (d[1], d_b[1])));
+	return _mm256_add_ps (r, _mm256_mul_ps (c[2], _pair_set1 (d[2], d_b[2])));
+}
+
+static inline void _store3_pair (float* out, float* out_b, __m256 r) {
+	_store3 (out, _mm256_castps256_ps128 (r));
+	_store3 (out_b, _mm256_extractf128_ps (r, 1));
+}
+
+static inline void _skin_pair_avx (const Apg_Skin_Input* in,
+	const __m128* cols, int v, Apg_Skin_Output* out) {
+	__m256 c[4];
+
+	_blend_avx (in, cols, v, c);
+	if (out->vps) {
+		const float* p = &in->vps[(size_t)v * 3];
+		__m256 r = _mm256_add_ps (_transform_avx (c, p, p + 3), c[3]);
+
+		_store3_pair (&out->vps[(size_t)v * 3], &out->vps[(size_t)v * 3 + 3], r);
+	}
+	if (in->vns && out->vns) {
+		const float* n = &in->vns[(size_t)v * 3];
+		__m256 r = _transform_avx (c, n, n + 3);
+
+		_store3 (&out->vns[(size_t)v * 3], _unit_sse (_mm256_castps256_ps128 (r)));
+		_store3 (&out->vns[(size_t)v * 3 + 3],
+			_unit_sse (_mm256_extractf128_ps (r, 1)));
+	}
+	if (in->vtans && out->vtans) {
+		int comps = in->vtan_comps;
+		const float* t = &in->vtans[(size_t)v * comps];
+		float* o = &out->vtans[(size_t)v * comps];
+		float w = t[3 % comps], w_b = t[comps + 3 % comps];
+		__m256 r = _transform_avx (c, t, t + comps);
+
+		_store3 (o, _unit_sse (_mm256_castps256_ps128 (r)));
+		_store3 (o + comps, _unit_sse (_mm256_extractf128_ps (r, 1)));
+		if (4 == comps) {
+			o[3] = w;
+			o[7] = w_b;
+		}
+	}
+}
+#endif
+
+bool apg_skin (const Apg_Skin_Input* in, const mat3x4* palette, int bone_count,
+	Apg_Skin_Output* out) {
+	__m128 stack_cols[STACK_BONES * 4];
+	__m128* cols = stack_cols;
+	int v = 0;
+
+	if (!_check_input (in, bone_count)) {
+		return false;
+	}
+	if (bone_count > STACK_BONES) {
+		cols = (__m128*)_mm_malloc (bone_count * 4 * sizeof (__m128), 16);
+		if (!cols) {
+			fprintf (stderr, "ERROR: allocating palette of %i bones\n", bone_count);
+			return false;
+		}
+	}
+	_palette_columns (palette, bone_count, cols);
+#ifdef __AVX__
+	for (; v + 1 < in->vert_count; v += 2) {
+		_skin_pair_avx (in, cols, v, out);
+	}
+#endif
+	for (; v < in->vert_count; v++) {
+		_skin_vertex_sse (in, cols, v, out);
+	}
+	if (cols != stack_cols) {
+		_mm_free (cols);
+	}
+	return true;
+}
+#else
+bool apg_skin (const Apg_Skin_Input* in, const mat3x4* palette, int bone_count,
+	Apg_Skin_Output* out) {
+	return apg_skin_scalar (in, palette, bone_count, out);
+}
+#endif
+
+bool apg_mesh_bone_ids (const Apg_Mesh* mesh, int* bone_ids) {
+	size_t n = (size_t)mesh->vert_count * mesh->vb_comps;
+
+	for (size_t i = 0; i < n; i++) {
+		int id;
+
+		if (APG_TYPE_U8 == mesh->vb_type) {
+			id = ((const uint8_t*)mesh->vbs)[i];
+		} else if (APG_TYPE_I32 == mesh->vb_type) {
+			id = ((const int*)mesh->vbs)[i];
+		} else {
+			id = (int)((const float*)mesh->vbs)[i];
+		}
+		if (id < 0 || id >= mesh->bone_count) {
+			fprintf (stderr, "ERROR: vertex %i has bone id %i of %i bones\n",
+				(int)(i / mesh->vb_comps), id, mesh->bone_count);
+			return false;
+		}
+		bone_ids[i] = id;
+	}
+	return true;
+}
+
+bool apg_mesh_bone_weights (const Apg_Mesh* mesh, float* weights) {
+	size_t n = (size_t)mesh->vert_count * mesh->vw_comps;
+
+	if (!mesh->vws || mesh->vw_comps != mesh->vb_comps) {
+		fprintf (stderr, "ERROR: mesh has no weight for each bone id\n");
+		return false;
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (APG_TYPE_U8 == mesh->vw_type) {
+			weights[i] = ((const uint8_t*)mesh->vws)[i] / 255.0f;
+		} else {
+			weights[i] = ((const float*)mesh->vws)[i];
+		}
+	}
+	return true;
+}
@@ -0,0 +1,276 @@
+//
+// Buffered ASCII .apg writer
+// First version 17 Oct 2026
+// see apg_text.hpp
+//
+
+#include "apg_text.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <math.h>
+
+// powers of ten that are exactly representable as doubles
+static const double _pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+	1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_POW10 22
+
+bool apg_text_open (Apg_Text_Writer* w, FILE* f) {
+	memset (w, 0, sizeof (Apg_Text_Writer));
+	w->buffer = (char*)malloc (APG_TEXT_BUFFER_SIZE);
+	if (!w->buffer) {
+		fprintf (stderr, "ERROR: allocating text write buffer\n");
+		return false;
+	}
+	w->f = f;
+	w->ok = true;
+	return true;
+}
+
+bool apg_text_flush (Apg_Text_Writer* w) {
+	if (w->used > 0 && fwrite (w->buffer, 1, w->used, w->f) != w->used) {
+		w->ok = false;
+	}
+	w->used = 0;
+	return w->ok;
+}
+
+bool apg_text_close (Apg_Text_Writer* w) {
+	bool ok = apg_text_flush (w);
+
+	free (w->buffer);
+	w->buffer = NULL;
+	return ok;
+}
+
+// makes sure there are at least n free bytes in the buffer
+static inline void _reserve (Apg_Text_Writer* w, size_t n) {
+	if (w->used + n > APG_TEXT_BUFFER_SIZE) {
+		apg_text_flush (w);
+	}
+}
+
+void apg_text_char (Apg_Text_Writer* w, char c) {
+	_reserve (w, 1);
+	w->buffer[w->used++] = c;
+}
+
+void apg_text_str (Apg_Text_Writer* w, const char* str) {
+	size_t len = strlen (str);
+
+	if (len > APG_TEXT_BUFFER_SIZE) {
+		apg_text_flush (w);
+		if (fwrite (str, 1, len, w->f) != len) {
+			w->ok = false;
+		}
+		return;
+	}
+	_reserve (w, len);
+	memcpy (&w->buffer[w->used], str, len);
+	w->used += len;
+}
+
+void apg_text_printf (Apg_Text_Writer* w, const char* fmt, ...) {
+	va_list args, args_copy;
+	size_t space;
+	int n;
+
+	_reserve (w, APG_TEXT_MAX_NUMBER_LEN);
+	space = APG_TEXT_BUFFER_SIZE - w->used;
+	va_start (args, fmt);
+	va_copy (args_copy, args);
+	n = vsnprintf (&w->buffer[w->used], space, fmt, args);
+	if (n < 0) {
+		w->ok = false;
+	} else if ((size_t)n < space) {
+		w->used += n;
+	} else {
+		//
+		// too long to buffer - write it directly
+		apg_text_flush (w);
+		if (vfprintf (w->f, fmt, args_copy) < 0) {
+			w->ok = false;
+		}
+	}
+	va_end (args_copy);
+	va_end (args);
+}
+
+//
+// snprintf() the value for anything the fast formatters don't cover
+static void _fallback (Apg_Text_Writer* w, const char* fmt, int prec,
+	double v) {
+	apg_text_printf (w, fmt, prec, v);
+}
+
+// writes the digits of n. returns number of chars written. buffer needs 20
+static inline int _write_uint (char* out, uint64_t n) {
+	char tmp[20];
+	int len = 0, i;
+
+	do {
+		tmp[len++] = (char)('0' + n % 10);
+		n /= 10;
+	} while (n > 0);
+	for (i = 0; i < len; i++) {
+		out[i] = tmp[len - 1 - i];
+	}
+	return len;
+}
+
+void apg_text_int (Apg_Text_Writer* w, int v) {
+	uint64_t n = v < 0 ? (uint64_t)(-(int64_t)v) : (uint64_t)v;
+
+	_reserve (w, 24);
+	if (v < 0) {
+		w->buffer[w->used++] = '-';
+	}
+	w->used += _write_uint (&w->buffer[w->used], n);
+}
+
+//
+// rounds a * 10^k to the nearest integer, ties to even, exactly as printf
+// rounds the exact binary value. the product is usually inexact, but fma()
+// gives its rounding error exactly, which is only needed to break apparent
+// ties. returns false if the result would not be exact in a double. a >= 0
+static inline bool _round_scaled (double a, int k, uint64_t* n) {
+	double scale = _pow10[k];
+	double p = a * scale;
+	double err, r, d;
+
+	if (!(p < 4503599627370496.0)) { // 2^52
+		return false;
+	}
+	//
+	// a float has 24 significant bits and 10^6 has 14, so for the float
+	// values the converter writes the product is exact and fma() can be skipped
+	err = (k <= 6 && (double)(float)a == a) ? 0.0 : fma (a, scale, -p);
+	r = nearbyint (p);
+	d = p - r;
+	//
+	// below 2^52 any fraction other than exactly 0.5 is at least one ulp away
+	// from a tie, and err is under half an ulp, so only exact halves can move
+	if (0.5 == d && err > 0.0) {
+		r += 1.0;
+	} else if (-0.5 == d && err < 0.0) {
+		r -= 1.0;
+	}
+	*n = (uint64_t)r;
+	return true;
+}
+
+//
+// writes n as a decimal with the given number of digits after the point.
+// when trim is set trailing zeros, and a bare point, are removed as in "%g"
+static inline void _write_decimal (Apg_Text_Writer* w, bool neg, uint64_t n,
+	int decimals, bool trim) {
+	char tmp[MAX_POW10 + 24];
+	char* out = &w->buffer[w->used];
+	int len = 0, i, int_len;
+
+	do {
+		tmp[len++] = (char)('0' + n % 10);
+		n /= 10;
+	} while (n > 0);
+	while (len < decimals + 1) {
+		tmp[len++] = '0';
+	}
+	int_len = len - decimals;
+	if (trim) {
+		while (decimals > 0 && '0' == tmp[0]) {
+			memmove (tmp, tmp + 1, --len);
+			decimals--;
+		}
+	}
+	if (neg) {
+		*out++ = '-';
+	}
+	for (i = 0; i < int_len; i++) {
+		*out++ = tmp[len - 1 - i];
+	}
+	if (decimals > 0) {
+		*out++ = '.';
+		for (i = int_len; i < len; i++) {
+			*out++ = tmp[len - 1 - i];
+		}
+	}
+	w->used = out - w->buffer;
+}
+
+//
+// true if a >= 10^x, exactly, for x in [-MAX_POW10, MAX_POW10]
+static inline bool _at_least_pow10 (double a, int x) {
+	double p, err;
+
+	if (x >= 0) {
+		return a >= _pow10[x];
+	}
+	p = a * _pow10[-x];
+	err = (x >= -6 && (double)(float)a == a) ? 0.0 : fma (a, _pow10[-x], -p);
+	return p > 1.0 || (1.0 == p && err >= 0.0);
+}
+
+void apg_text_fixed (Apg_Text_Writer* w, double v, int decimals) {
+	uint64_t n;
+
+	_reserve (w, APG_TEXT_MAX_NUMBER_LEN);
+	if (!isfinite (v) || decimals < 0 || decimals > MAX_POW10 ||
+		!_round_scaled (fabs (v), decimals, &n)) {
+		_fallback (w, "%.*f", decimals, v);
+		return;
+	}
+	//
+	// printf keeps the sign of negative values that round to zero, e.g. "-0.00"
+	_write_decimal (w, signbit (v) != 0, n, decimals, false);
+}
+
+void apg_text_sig (Apg_Text_Writer* w, double v, int sig_figs) {
+	uint64_t n = 0, hi;
+	double a = fabs (v);
+	int x = 0;
+
+	_reserve (w, APG_TEXT_MAX_NUMBER_LEN);
+	if (0 == sig_figs) {
+		sig_figs = 1;
+	}
+	if (!isfinite (v) || sig_figs < 0 || sig_figs > 15) {
+		_fallback (w, "%.*g", sig_figs, v);
+		return;
+	}
+	if (0.0 == a) {
+		apg_text_str (w, signbit (v) ? "-0" : "0");
+		return;
+	}
+	//
+	// %g uses fixed notation when the decimal exponent x of the value, after
+	// rounding to sig_figs digits, is in [-4, sig_figs). start from the exact
+	// floor (log10 (a)) then allow for rounding carrying into the next digit,
+	// e.g. 9.9996e-05 -> "0.0001"
+	hi = (uint64_t)_pow10[sig_figs];
+	if (a >= 1.0) {
+		while (x < sig_figs && _at_least_pow10 (a, x + 1)) {
+			x++;
+		}
+	} else {
+		x = -1;
+		while (x > -6 && !_at_least_pow10 (a, x)) {
+			x--;
+		}
+	}
+	if (x > sig_figs - 1 || x < -5 || !_round_scaled (a, sig_figs - 1 - x, &n)) {
+		_fallback (w, "%.*g", sig_figs, v);
+		return;
+	}
+	if (n >= hi) {
+		x++;
+		n /= 10;
+	}
+	if (x > sig_figs - 1 || x < -4) {
+		_fallback (w, "%.*g", sig_figs, v);
+		return;
+	}
+	_write_decimal (w, signbit (v) != 0, n, sig_figs - 1 - x, true);
+}
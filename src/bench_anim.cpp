@@ -0,0 +1,412 @@
+//
+// benchmark for animation evaluation
+// First version 17 Oct 2026
+//
+// times finding every node's pose by scanning each channel's keys, as the
+// viewer does, against sampling a copy resampled to a fixed rate, on a
+// synthetic skeleton with a long clip. also reports how far apart the two
+// poses are. times a cursor kept between calls for playback at 60 frames a
+// second and for random seeks, checking it matches the scan, and times slerp
+// against nlerp for the rotation keys. then times building global transforms
+// by recursing through the hierarchy, as the viewer did, against the flat
+// parent-first loop
+//
+// usage: ./bench_anim [-bones N] [-seconds N] [-rate N] [-evals N] [-reps N]
+//
+
+#include "apg_anim.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static float _distance (const vec3& a, const vec3& b) {
+	float x = a.v[0] - b.v[0], y = a.v[1] - b.v[1], z = a.v[2] - b.v[2];
+
+	return sqrtf (x * x + y * y + z * z);
+}
+
+//
+// angle in degrees between two versors. they are normalised first, as slerp ()
+// output is a few ulps off unit length, which acos () would read as an angle
+static float _angle (const versor& a, const versor& b) {
+	double ab = 0.0, aa = 0.0, bb = 0.0, d;
+
+	for (int i = 0; i < 4; i++) {
+		ab += (double)a.q[i] * b.q[i];
+		aa += (double)a.q[i] * a.q[i];
+		bb += (double)b.q[i] * b.q[i];
+	}
+	d = fabs (ab) / sqrt (aa * bb);
+	return d >= 1.0 ? 0.0f : (float)(2.0 * acos (d) * ONE_RAD_IN_DEG);
+}
+
+//
+// plays the clip through twice at 60 frames a second, looping, then seeks to
+// random times, with one cursor. results must match the scan bit for bit
+static void _bench_cursor (const Animation* anim, int reps) {
+	Apg_Anim_Cursor cursor;
+	vec3 *tra_a, *sca_a, *tra_b, *sca_b;
+	versor *rot_a, *rot_b;
+	double play_ms = 1e30, seek_ms = 1e30;
+	int n = anim->num_channels;
+	int frames = (int)(anim->duration * 60.0);
+	int seeks = 10000;
+	int diffs = 0;
+
+	if (frames < 1 || !apg_init_anim_cursor (anim, &cursor)) {
+		return;
+	}
+	tra_a = (vec3*)malloc (n * sizeof (vec3));
+	sca_a = (vec3*)malloc (n * sizeof (vec3));
+	rot_a = (versor*)malloc (n * sizeof (versor));
+	tra_b = (vec3*)malloc (n * sizeof (vec3));
+	sca_b = (vec3*)malloc (n * sizeof (vec3));
+	rot_b = (versor*)malloc (n * sizeof (versor));
+
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < frames * 2; i++) {
+			apg_eval_keys_cursor (anim, &cursor, (i % frames) / 60.0, tra_b, sca_b,
+				rot_b);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < play_ms) {
+			play_ms = t2 - t1;
+		}
+	}
+	for (int r = 0; r < reps; r++) {
+		double t1;
+
+		srand (2);
+		t1 = bench_time_ms ();
+		for (int i = 0; i < seeks; i++) {
+			apg_eval_keys_cursor (anim, &cursor,
+				bench_rand_range (0.0f, (float)anim->duration), tra_b, sca_b,
+				rot_b);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < seek_ms) {
+			seek_ms = t2 - t1;
+		}
+	}
+	//
+	// check a spread of playback frames, seeks and loops against the scan
+	for (int i = 0; i < frames * 2; i += 7) {
+		double t = (i % 97 == 0) ?
+			bench_rand_range (0.0f, (float)anim->duration) : (i % frames) / 60.0;
+
+		apg_eval_keys (anim, t, tra_a, sca_a, rot_a);
+		apg_eval_keys_cursor (anim, &cursor, t, tra_b, sca_b, rot_b);
+		if (memcmp (tra_a, tra_b, n * sizeof (vec3)) != 0 ||
+			memcmp (sca_a, sca_b, n * sizeof (vec3)) != 0 ||
+			memcmp (rot_a, rot_b, n * sizeof (versor)) != 0) {
+			diffs++;
+		}
+	}
+	printf ("cursor per pose: playing %7.3f us  seeking %7.3f us  %i poses "
+		"differ from scan\n", play_ms * 1000.0 / (frames * 2),
+		seek_ms * 1000.0 / seeks, diffs);
+
+	free (tra_a);
+	free (sca_a);
+	free (rot_a);
+	free (tra_b);
+	free (sca_b);
+	free (rot_b);
+	apg_free_anim_cursor (&cursor);
+}
+
+//
+// plays the clip through with each way of blending rotation keys, timing it
+// and finding how far nlerp strays from slerp on these 30 a second keys
+static void _bench_rot_interp (const Animation* anim, int reps) {
+	Apg_Anim_Cursor cursor;
+	vec3 *tra, *sca;
+	versor *rot_ref, *rot;
+	const char* names[3] = { "slerp", "nlerp", "corrected" };
+	Apg_Rot_Interp modes[3] = {
+		APG_ROT_SLERP, APG_ROT_NLERP, APG_ROT_NLERP_CORRECTED
+	};
+	Apg_Rot_Interp old_mode = apg_get_rot_interp ();
+	double ms[3] = { 1e30, 1e30, 1e30 };
+	float max_rot[3] = { 0.0f, 0.0f, 0.0f };
+	int n = anim->num_channels;
+	int frames = (int)(anim->duration * 60.0);
+
+	if (frames < 1 || !apg_init_anim_cursor (anim, &cursor)) {
+		return;
+	}
+	tra = (vec3*)malloc (n * sizeof (vec3));
+	sca = (vec3*)malloc (n * sizeof (vec3));
+	rot_ref = (versor*)malloc (n * sizeof (versor));
+	rot = (versor*)malloc (n * sizeof (versor));
+	for (int m = 0; m < 3; m++) {
+		apg_set_rot_interp (modes[m]);
+		for (int r = 0; r < reps; r++) {
+			double t1 = bench_time_ms ();
+			for (int i = 0; i < frames; i++) {
+				apg_eval_keys_cursor (anim, &cursor, i / 60.0, tra, sca, rot);
+			}
+			double t2 = bench_time_ms ();
+			if (t2 - t1 < ms[m]) {
+				ms[m] = t2 - t1;
+			}
+		}
+		for (int i = 0; i < frames; i++) {
+			apg_set_rot_interp (APG_ROT_SLERP);
+			apg_eval_keys_cursor (anim, &cursor, i / 60.0, tra, sca, rot_ref);
+			apg_set_rot_interp (modes[m]);
+			apg_eval_keys_cursor (anim, &cursor, i / 60.0, tra, sca, rot);
+			for (int j = 0; j < n; j++) {
+				max_rot[m] = fmaxf (max_rot[m], _angle (rot_ref[j], rot[j]));
+			}
+		}
+	}
+	apg_set_rot_interp (old_mode);
+	printf ("rotation blend per pose:");
+	for (int m = 0; m < 3; m++) {
+		printf ("  %s %7.3f us", names[m], ms[m] * 1000.0 / frames);
+	}
+	printf ("\nmax difference from slerp: nlerp %g corrected %g degrees\n",
+		max_rot[1], max_rot[2]);
+
+	free (tra);
+	free (sca);
+	free (rot_ref);
+	free (rot);
+	apg_free_anim_cursor (&cursor);
+}
+
+//
+// the viewer's previous evaluation: recursing through child lists, building a
+// translate, rotate and scale matrix per node and multiplying them
+struct Ref_Tree {
+	int** children;
+	int* num_children;
+};
+
+static void _ref_recurse (const Ref_Tree* tree, const Apg_Pose* pose,
+	int node, mat4 parent_mat, mat4* globals) {
+	mat4 trans_mat, sca_mat, rot_mat, node_mat, global_mat;
+
+	trans_mat = translate (identity_mat4 (), pose->tra[node]);
+	sca_mat = scale (identity_mat4 (), pose->sca[node]);
+	rot_mat = quat_to_mat4 (pose->rot[node]);
+	node_mat = trans_mat * rot_mat * sca_mat;
+	global_mat = parent_mat * node_mat;
+	globals[node] = global_mat;
+	for (int i = 0; i < tree->num_children[node]; i++) {
+		_ref_recurse (tree, pose, tree->children[node][i], global_mat, globals);
+	}
+}
+
+//
+// a bushy tree: node i hangs off node (i - 1) / 3, so a 128-node skeleton is
+// 5 levels deep
+static void _bench_hierarchy (int bones, int reps) {
+	Apg_Skeleton skeleton;
+	Apg_Pose pose;
+	Ref_Tree tree;
+	mat4* ref_globals;
+	int* parents;
+	double ref_ms = 1e30, flat_ms = 1e30;
+	float max_diff = 0.0f;
+	int evals = 10000;
+
+	parents = (int*)malloc (bones * sizeof (int));
+	tree.children = (int**)malloc (bones * sizeof (int*));
+	tree.num_children = (int*)calloc (bones, sizeof (int));
+	ref_globals = (mat4*)malloc (bones * sizeof (mat4));
+	for (int i = 0; i < bones; i++) {
+		parents[i] = (i - 1) / 3;
+		tree.children[i] = (int*)malloc (3 * sizeof (int));
+	}
+	parents[0] = -1;
+	for (int i = 1; i < bones; i++) {
+		tree.children[parents[i]][tree.num_children[parents[i]]++] = i;
+	}
+	if (!apg_init_skeleton (parents, NULL, bones, 0, &skeleton) ||
+		!apg_alloc_pose (bones, &pose)) {
+		return;
+	}
+	for (int i = 0; i < bones; i++) {
+		versor q;
+
+		pose.tra[i] = vec3 (bench_rand_range (-1.0f, 1.0f),
+			bench_rand_range (0.0f, 1.0f), bench_rand_range (-1.0f, 1.0f));
+		pose.sca[i] = vec3 (1.0f, bench_rand_range (0.9f, 1.1f), 1.0f);
+		q.q[0] = 1.0f;
+		q.q[1] = bench_rand_range (-0.3f, 0.3f);
+		q.q[2] = bench_rand_range (-0.3f, 0.3f);
+		q.q[3] = bench_rand_range (-0.3f, 0.3f);
+		pose.rot[i] = normalise (q);
+	}
+
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < evals; i++) {
+			_ref_recurse (&tree, &pose, 0, identity_mat4 (), ref_globals);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < ref_ms) {
+			ref_ms = t2 - t1;
+		}
+	}
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < evals; i++) {
+			apg_pose_globals (&skeleton, &pose);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < flat_ms) {
+			flat_ms = t2 - t1;
+		}
+	}
+	for (int i = 0; i < bones; i++) {
+		mat4 flat = mat4_from_mat3x4 (pose.globals[i]);
+		const mat4* ref = &ref_globals[skeleton.order[i]];
+
+		for (int j = 0; j < 16; j++) {
+			max_diff = fmaxf (max_diff, fabsf (flat.m[j] - ref->m[j]));
+		}
+	}
+	printf ("globals: recursive %7.3f us  flat %7.3f us  x%.1f  max difference "
+		"%g\n", ref_ms * 1000.0 / evals, flat_ms * 1000.0 / evals,
+		ref_ms / flat_ms, max_diff);
+
+	for (int i = 0; i < bones; i++) {
+		free (tree.children[i]);
+	}
+	free (tree.children);
+	free (tree.num_children);
+	free (ref_globals);
+	free (parents);
+	apg_free_pose (&pose);
+	apg_free_skeleton (&skeleton);
+}
+
+int main (int argc, char** argv) {
+	Animation anim;
+	Apg_Sampled_Anim sampled;
+	vec3 *tra_a, *sca_a, *tra_b, *sca_b;
+	versor *rot_a, *rot_b;
+	double* times;
+	double scan_ms = 1e30, sample_ms = 1e30, resample_ms;
+	double seconds = 90.0;
+	float rate = 30.0f;
+	float max_tra = 0.0f, max_sca = 0.0f, max_rot = 0.0f;
+	int bones = 128;
+	int evals = 1000;
+	int reps = 5;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-bones");
+	if (a > -1 && a + 1 < argc) {
+		bones = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-seconds");
+	if (a > -1 && a + 1 < argc) {
+		seconds = atof (argv[a + 1]);
+	}
+	a = check_arg ("-rate");
+	if (a > -1 && a + 1 < argc) {
+		rate = (float)atof (argv[a + 1]);
+	}
+	a = check_arg ("-evals");
+	if (a > -1 && a + 1 < argc) {
+		evals = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	if (bones < 1 || seconds <= 0.0 || evals < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+	srand (1);
+	if (!bench_make_clip (bones, seconds, 0, 1.0f,
+		BENCH_CLIP_JITTER | BENCH_CLIP_SCALE, &anim)) {
+		return 1;
+	}
+	double t0 = bench_time_ms ();
+	if (!apg_resample_anim (&anim, rate, &sampled)) {
+		bench_free_clip (&anim);
+		return 1;
+	}
+	resample_ms = bench_time_ms () - t0;
+
+	tra_a = (vec3*)malloc (bones * sizeof (vec3));
+	sca_a = (vec3*)malloc (bones * sizeof (vec3));
+	rot_a = (versor*)malloc (bones * sizeof (versor));
+	tra_b = (vec3*)malloc (bones * sizeof (vec3));
+	sca_b = (vec3*)malloc (bones * sizeof (vec3));
+	rot_b = (versor*)malloc (bones * sizeof (versor));
+	times = (double*)malloc (evals * sizeof (double));
+	//
+	// evenly spread over the clip so the scan is timed at every depth
+	for (int i = 0; i < evals; i++) {
+		times[i] = seconds * (i + 0.5) / evals;
+	}
+
+	//
+	// best of n for each to reduce noise
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < evals; i++) {
+			apg_eval_keys (&anim, times[i], tra_a, sca_a, rot_a);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < scan_ms) {
+			scan_ms = t2 - t1;
+		}
+	}
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < evals; i++) {
+			apg_sample_anim (&sampled, times[i], tra_b, sca_b, rot_b);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < sample_ms) {
+			sample_ms = t2 - t1;
+		}
+	}
+	for (int i = 0; i < evals; i++) {
+		apg_eval_keys (&anim, times[i], tra_a, sca_a, rot_a);
+		apg_sample_anim (&sampled, times[i], tra_b, sca_b, rot_b);
+		for (int j = 0; j < bones; j++) {
+			max_tra = fmaxf (max_tra, _distance (tra_a[j], tra_b[j]));
+			max_sca = fmaxf (max_sca, _distance (sca_a[j], sca_b[j]));
+			max_rot = fmaxf (max_rot, _angle (rot_a[j], rot_b[j]));
+		}
+	}
+
+	printf ("%i bones, %g s clip, %i keys per channel, resampled at %g/s to "
+		"%i frames in %.1f ms (%.1f MB)\n", bones, seconds,
+		anim.channels[0].tra_keys_count, rate, sampled.frame_count, resample_ms,
+		(double)sampled.frame_count * bones *
+		(2 * sizeof (vec3) + sizeof (versor)) / (1024.0 * 1024.0));
+	printf ("per pose: scan %9.3f us  sampled %7.3f us  x%.1f\n",
+		scan_ms * 1000.0 / evals, sample_ms * 1000.0 / evals,
+		scan_ms / sample_ms);
+	printf ("max difference: tra %g sca %g rot %g degrees\n", max_tra, max_sca,
+		max_rot);
+	_bench_cursor (&anim, reps);
+	_bench_rot_interp (&anim, reps);
+	_bench_hierarchy (bones, reps);
+
+	free (times);
+	free (tra_a);
+	free (sca_a);
+	free (rot_a);
+	free (tra_b);
+	free (sca_b);
+	free (rot_b);
+	apg_free_sampled_anim (&sampled);
+	bench_free_clip (&anim);
+	return 0;
+}
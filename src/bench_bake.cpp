@@ -0,0 +1,221 @@
+//
+// benchmark for baked skinning palettes
+// First version 17 Oct 2026
+//
+// builds a synthetic skeleton and clip, as bench_crowd does, and bakes it at a
+// range of rates. for each rate reports the table's size as floats and 16-bit,
+// the furthest a point within -radius of the origin is skinned from where the
+// keys put it, and the time to produce a palette by evaluating keys against
+// fetching it from each table. checks the float table is exact at its samples
+// and that the SSE2 sampler matches the scalar one bit for bit
+//
+// usage: ./bench_bake [-bones N] [-seconds N] [-radius N] [-palettes N]
+//   [-reps N]
+//
+
+#include "apg_bake.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// keeps the optimiser from dropping palettes nothing reads
+volatile float sink;
+
+//
+// a palette every step seconds, looping, like one instance playing at 60/s.
+// returns the best time per palette in nanoseconds
+static double _time_baked (const Apg_Baked_Clip* baked, int palettes, int reps,
+	mat3x4* palette) {
+	double best_ms = 1e30;
+
+	for (int r = 0; r < reps; r++) {
+		double t = 0.0;
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < palettes; i++) {
+			apg_sample_baked (baked, t, palette);
+			sink = palette[baked->bone_count - 1].m[3];
+			t = fmod (t + 1.0 / 60.0, baked->duration);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < best_ms) {
+			best_ms = t2 - t1;
+		}
+	}
+	return best_ms * 1e6 / palettes;
+}
+
+static double _time_eval (const Animation* anim, const Apg_Skeleton* skeleton,
+	const mat3x4& root, const mat3x4* offsets, int palettes, int reps,
+	Apg_Pose* pose, mat3x4* palette) {
+	Apg_Anim_Cursor cursor;
+	double best_ms = 1e30;
+
+	if (!apg_init_anim_cursor (anim, &cursor)) {
+		return 0.0;
+	}
+	for (int r = 0; r < reps; r++) {
+		double t = 0.0;
+		double t1 = bench_time_ms ();
+		for (int i = 0; i < palettes; i++) {
+			apg_eval_keys_cursor (anim, &cursor, t, pose->tra, pose->sca,
+				pose->rot);
+			apg_pose_globals (skeleton, pose);
+			apg_pose_palette (skeleton, pose, root, offsets, palette);
+			sink = palette[skeleton->node_count - 1].m[3];
+			t = fmod (t + 1.0 / 60.0, anim->duration);
+		}
+		double t2 = bench_time_ms ();
+		if (t2 - t1 < best_ms) {
+			best_ms = t2 - t1;
+		}
+	}
+	apg_free_anim_cursor (&cursor);
+	return best_ms * 1e6 / palettes;
+}
+
+//
+// number of times between 0 and the end where the two samplers disagree
+static int _compare_samplers (const Apg_Baked_Clip* baked, mat3x4* a,
+	mat3x4* b) {
+	int diffs = 0;
+
+	for (int i = 0; i <= 1000; i++) {
+		double t = baked->duration * i / 1000.0;
+
+		apg_sample_baked (baked, t, a);
+		apg_sample_baked_scalar (baked, t, b);
+		if (memcmp (a, b, baked->bone_count * sizeof (mat3x4)) != 0) {
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+int main (int argc, char** argv) {
+	const float rates[] = { 10.0f, 15.0f, 30.0f, 60.0f, 120.0f };
+	Animation anim;
+	Apg_Skeleton skeleton;
+	Apg_Pose pose;
+	mat3x4 root = identity_mat3x4 ();
+	mat3x4* offsets = NULL;
+	mat3x4* palette = NULL;
+	mat3x4* check = NULL;
+	int* parents = NULL;
+	int* bone_ids = NULL;
+	double eval_ns = 0.0;
+	double seconds = 5.0;
+	float radius = 1.0f;
+	int bones = 64;
+	int palettes = 20000;
+	int reps = 3;
+	int failed = 0;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-bones");
+	if (a > -1 && a + 1 < argc) {
+		bones = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-seconds");
+	if (a > -1 && a + 1 < argc) {
+		seconds = atof (argv[a + 1]);
+	}
+	a = check_arg ("-radius");
+	if (a > -1 && a + 1 < argc) {
+		radius = (float)atof (argv[a + 1]);
+	}
+	a = check_arg ("-palettes");
+	if (a > -1 && a + 1 < argc) {
+		palettes = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	if (bones < 1 || !(seconds > 0.0) || palettes < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+
+	//
+	// a bushy skeleton, node i hanging off node (i - 1) / 3, with a bone per
+	// node
+	parents = (int*)malloc (bones * sizeof (int));
+	bone_ids = (int*)malloc (bones * sizeof (int));
+	offsets = (mat3x4*)malloc (bones * sizeof (mat3x4));
+	palette = (mat3x4*)malloc (bones * sizeof (mat3x4));
+	check = (mat3x4*)malloc (bones * sizeof (mat3x4));
+	if (!parents || !bone_ids || !offsets || !palette || !check) {
+		fprintf (stderr, "ERROR: allocating %i bones\n", bones);
+		return 1;
+	}
+	for (int i = 0; i < bones; i++) {
+		parents[i] = (i - 1) / 3;
+		bone_ids[i] = i;
+		offsets[i] = mat3x4_from_mat4 (translate (identity_mat4 (),
+			vec3 (0.0f, -0.1f * i, 0.0f)));
+	}
+	parents[0] = -1;
+	if (!bench_make_clip (bones, seconds, 0, 0.1f, 0, &anim) ||
+		!apg_init_skeleton (parents, bone_ids, bones, bones, &skeleton) ||
+		!apg_alloc_pose (bones, &pose)) {
+		return 1;
+	}
+	eval_ns = _time_eval (&anim, &skeleton, root, offsets, palettes, reps,
+		&pose, palette);
+	printf ("%i bones, %g s clip keyed at 30/s, radius %g\n", bones, seconds,
+		radius);
+	printf ("evaluating keys: %.0f ns per palette\n", eval_ns);
+	printf ("rate  samples  f32 KB    error   ns  x     q16 KB    error   ns  x\n");
+
+	for (size_t r = 0; r < sizeof (rates) / sizeof (rates[0]); r++) {
+		Apg_Baked_Clip table, packed;
+		float exact_error, error, packed_error;
+		double ns, packed_ns;
+		int diffs;
+
+		if (!apg_bake_clip (&anim, &skeleton, root, offsets, bones, rates[r],
+			&table) || !apg_quantise_baked_clip (&table, &packed)) {
+			return 1;
+		}
+		exact_error = apg_baked_error (&table, &anim, &skeleton, root, offsets,
+			radius, 1);
+		error = apg_baked_error (&table, &anim, &skeleton, root, offsets, radius,
+			8);
+		packed_error = apg_baked_error (&packed, &anim, &skeleton, root, offsets,
+			radius, 8);
+		ns = _time_baked (&table, palettes, reps, palette);
+		packed_ns = _time_baked (&packed, palettes, reps, palette);
+		diffs = _compare_samplers (&table, palette, check) +
+			_compare_samplers (&packed, palette, check);
+		printf ("%4g %8i %7.1f %8.2e %4.0f %4.1f %7.1f %8.2e %4.0f %4.1f\n",
+			rates[r], table.sample_count, apg_baked_size (&table) / 1024.0, error,
+			ns, eval_ns / ns, apg_baked_size (&packed) / 1024.0, packed_error,
+			packed_ns, eval_ns / packed_ns);
+		//
+		// blending at a sample can only be a rounding error away from it
+		if (!(exact_error < 1e-4f * radius)) {
+			printf ("  FAILED: float table is %g out at its samples\n", exact_error);
+			failed = 1;
+		}
+		if (diffs > 0) {
+			printf ("  FAILED: SSE2 and scalar samplers differ at %i times\n", diffs);
+			failed = 1;
+		}
+		apg_free_baked_clip (&table);
+		apg_free_baked_clip (&packed);
+	}
+
+	apg_free_pose (&pose);
+	apg_free_skeleton (&skeleton);
+	bench_free_clip (&anim);
+	free (parents);
+	free (bone_ids);
+	free (offsets);
+	free (palette);
+	free (check);
+	return failed;
+}
@@ -0,0 +1,191 @@
+//
+// benchmark for evaluating crowds of animated instances
+// First version 17 Oct 2026
+//
+// builds a synthetic rig with a few clips and a crowd of instances, each on a
+// random clip at a random time and speed, then times updating the whole crowd
+// at 60 frames a second with 1, 2, 4... threads up to the number of hardware
+// threads. reports instances per millisecond and the speed-up over one thread,
+// and checks every thread count gives the same palettes as one thread. -bake
+// plays the clips from tables baked at RATE samples per second instead
+//
+// usage: ./bench_crowd [-instances N] [-bones N] [-clips N] [-frames N]
+//   [-threads N] [-reps N] [-bake RATE]
+//
+
+#include "apg_crowd.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+
+// the same random clip, time and speed for each instance every time
+static void _reset_instances (Apg_Crowd* crowd) {
+	srand (2);
+	for (int i = 0; i < crowd->instance_count; i++) {
+		Apg_Crowd_Instance* inst = &crowd->instances[i];
+
+		inst->clip = rand () % crowd->rig->clip_count;
+		inst->time = bench_rand_range (0.0f,
+			(float)crowd->rig->clips[inst->clip].duration);
+		inst->speed = bench_rand_range (0.8f, 1.2f);
+	}
+}
+
+int main (int argc, char** argv) {
+	Apg_Mesh mesh;
+	Apg_Rig rig;
+	mat3x4* ref_palettes = NULL;
+	double one_thread_ms = 0.0;
+	int instances = 10000;
+	int bones = 64;
+	int clips = 4;
+	int frames = 60;
+	int max_threads = (int)std::thread::hardware_concurrency ();
+	int reps = 3;
+	float bake_rate = 0.0f;
+	int failed = 0;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-instances");
+	if (a > -1 && a + 1 < argc) {
+		instances = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-bones");
+	if (a > -1 && a + 1 < argc) {
+		bones = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-clips");
+	if (a > -1 && a + 1 < argc) {
+		clips = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-frames");
+	if (a > -1 && a + 1 < argc) {
+		frames = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-threads");
+	if (a > -1 && a + 1 < argc) {
+		max_threads = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-bake");
+	if (a > -1 && a + 1 < argc) {
+		bake_rate = (float)atof (argv[a + 1]);
+	}
+	if (max_threads < 1) {
+		max_threads = 1;
+	}
+	if (instances < 1 || bones < 1 || clips < 1 || frames < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+
+	//
+	// a bushy skeleton, node i hanging off node (i - 1) / 3, with a bone per
+	// node
+	memset ((void*)&mesh, 0, sizeof (Apg_Mesh));
+	mesh.node_parents = (int*)malloc (bones * sizeof (int));
+	mesh.node_bone_ids = (int*)malloc (bones * sizeof (int));
+	mesh.offset_mats = (mat4*)malloc (bones * sizeof (mat4));
+	mesh.animations = (Animation*)calloc (clips, sizeof (Animation));
+	mesh.root_transform = identity_mat4 ();
+	mesh.bone_count = bones;
+	mesh.anim_node_count = bones;
+	mesh.animation_count = clips;
+	for (int i = 0; i < bones; i++) {
+		mesh.node_parents[i] = (i - 1) / 3;
+		mesh.node_bone_ids[i] = i;
+		mesh.offset_mats[i] = translate (identity_mat4 (),
+			vec3 (0.0f, -0.1f * i, 0.0f));
+	}
+	mesh.node_parents[0] = -1;
+	for (int i = 0; i < clips; i++) {
+		if (!bench_make_clip (bones, 5.0 + i, i, 1.0f, 0,
+			&mesh.animations[i])) {
+			return 1;
+		}
+	}
+	if (!apg_init_rig (&mesh, &rig)) {
+		return 1;
+	}
+	for (int i = 0; bake_rate > 0.0f && i < clips; i++) {
+		if (!apg_bake_clip (&rig.clips[i], &rig.skeleton, rig.root_transform,
+			rig.offset_mats, bones, bake_rate, &rig.baked[i])) {
+			return 1;
+		}
+	}
+	printf ("%i instances of %i bones, %i clips, %i frames at 60/s, "
+		"%i hardware threads\n", instances, bones, clips, frames,
+		(int)std::thread::hardware_concurrency ());
+	if (bake_rate > 0.0f) {
+		printf ("clips baked at %g per second\n", bake_rate);
+	}
+
+	for (int threads = 1; threads <= max_threads;
+		threads = threads * 2 > max_threads && threads < max_threads ?
+		max_threads : threads * 2) {
+		Apg_Crowd crowd;
+		double best_ms = 1e30;
+		int diffs = 0;
+
+		if (!apg_init_crowd (&rig, instances, threads, &crowd)) {
+			return 1;
+		}
+		for (int r = 0; r < reps; r++) {
+			_reset_instances (&crowd);
+			apg_update_crowd (&crowd, 0.0);
+			double t1 = bench_time_ms ();
+			for (int f = 0; f < frames; f++) {
+				apg_update_crowd (&crowd, 1.0 / 60.0);
+			}
+			double t2 = bench_time_ms ();
+			if (t2 - t1 < best_ms) {
+				best_ms = t2 - t1;
+			}
+		}
+		//
+		// instances are independent, so the palettes must match bit for bit
+		if (!ref_palettes) {
+			size_t size = (size_t)instances * bones * sizeof (mat3x4);
+
+			ref_palettes = (mat3x4*)malloc (size);
+			memcpy (ref_palettes, crowd.palettes, size);
+			one_thread_ms = best_ms;
+		} else {
+			for (int i = 0; i < instances; i++) {
+				if (memcmp (apg_crowd_palette (&crowd, i), &ref_palettes[i * bones],
+					bones * sizeof (mat3x4)) != 0) {
+					diffs++;
+				}
+			}
+		}
+		printf ("%3i threads: %8.3f ms per update  %8.1f instances per ms  "
+			"x%.2f  %i instances differ\n", threads, best_ms / frames,
+			instances * frames / best_ms, one_thread_ms / best_ms, diffs);
+		if (diffs > 0) {
+			failed = 1;
+		}
+		apg_free_crowd (&crowd);
+	}
+
+	free (ref_palettes);
+	for (int i = 0; i < clips; i++) {
+		apg_free_baked_clip (&rig.baked[i]);
+	}
+	apg_free_rig (&rig);
+	for (int i = 0; i < clips; i++) {
+		bench_free_clip (&mesh.animations[i]);
+	}
+	free (mesh.animations);
+	free (mesh.node_parents);
+	free (mesh.node_bone_ids);
+	free (mesh.offset_mats);
+	return failed;
+}
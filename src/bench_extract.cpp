@@ -0,0 +1,319 @@
+//
+// test and benchmark for bulk vertex attribute extraction
+// First version 17 Oct 2026
+//
+// generates an importer-style mesh of positions, normals, texture coordinates,
+// tangents and bitangents, 3 floats a vertex each as assimp stores them, and
+// extracts it into the converter's streams, turning Z-up into Y-up. times the
+// loader's old loop, which checks which attributes the mesh has for every
+// vertex, against extract_streams (), which checks once, with the scalar and
+// SSE2 versions, and with the mesh shared out over 1, 2, 4... threads. checks
+// every way gives the old loop's results bit for bit, also for meshes missing
+// some attributes. returns non-zero if any check fails
+//
+// usage: ./bench_extract [-verts N] [-threads N] [-reps N]
+//
+
+#include "mesh_extract.hpp"
+#include "maths_funcs.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+
+// what the old loop needs of an aiMesh
+struct Import_Mesh {
+	float* vertices;
+	float* normals;
+	float* texcoords;
+	float* tangents;
+	float* bitangents;
+	int vert_count;
+
+	bool has_positions () const { return vertices && vert_count > 0; }
+	bool has_normals () const { return normals && vert_count > 0; }
+	bool has_texcoords () const { return texcoords && vert_count > 0; }
+	bool has_tangents () const {
+		return tangents && bitangents && vert_count > 0;
+	}
+};
+
+struct Streams {
+	float* vps;
+	float* vns;
+	float* vts;
+	float* vtangents;
+};
+
+//
+// the loader's loop before extraction was split into streams
+static void _extract_per_vertex (const Import_Mesh* mesh, bool correct_coords,
+	Streams* out) {
+	for (int v_i = 0; v_i < mesh->vert_count; v_i++) {
+		if (mesh->has_positions ()) {
+			const float* vp = &mesh->vertices[v_i * 3];
+			float* o = &out->vps[v_i * 3];
+
+			o[0] = vp[0];
+			o[1] = correct_coords ? vp[2] : vp[1];
+			o[2] = correct_coords ? -vp[1] : vp[2];
+		}
+		if (mesh->has_normals ()) {
+			const float* vn = &mesh->normals[v_i * 3];
+			float* o = &out->vns[v_i * 3];
+
+			o[0] = vn[0];
+			o[1] = correct_coords ? vn[2] : vn[1];
+			o[2] = correct_coords ? -vn[1] : vn[2];
+		}
+		if (mesh->has_texcoords ()) {
+			const float* vt = &mesh->texcoords[v_i * 3];
+			float* o = &out->vts[v_i * 2];
+
+			o[0] = vt[0];
+			o[1] = vt[1];
+		}
+		if (mesh->has_tangents ()) {
+			const float* tp = &mesh->tangents[v_i * 3];
+			const float* bp = &mesh->bitangents[v_i * 3];
+			const float* np = &mesh->normals[v_i * 3];
+			float* o = &out->vtangents[v_i * 4];
+			vec3 t (tp[0], tp[1], tp[2]);
+			vec3 n (np[0], np[1], np[2]);
+			vec3 b (bp[0], bp[1], bp[2]);
+			vec3 t_i = normalise (t - n * dot (n, t));
+			float det = (dot (cross (n, t), b));
+			if (det < 0.0f) {
+				det = -1.0f;
+			} else {
+				det = 1.0f;
+			}
+			o[0] = t_i.v[0];
+			o[1] = t_i.v[1];
+			o[2] = t_i.v[2];
+			o[3] = det;
+		}
+	}
+}
+
+static void _extract_streams (const Import_Mesh* mesh, bool correct_coords,
+	bool scalar, Apg_Pool* pool, Streams* out) {
+	Extract_Input in;
+	Extract_Output streams;
+
+	in.vertices = mesh->vertices;
+	in.normals = mesh->normals;
+	in.texcoords = mesh->texcoords;
+	in.tangents = mesh->tangents;
+	in.bitangents = mesh->bitangents;
+	streams.vps = out->vps;
+	streams.vns = out->vns;
+	streams.vts = out->vts;
+	streams.vtangents = out->vtangents;
+	if (scalar) {
+		extract_streams_scalar (&in, mesh->vert_count, correct_coords, &streams);
+		return;
+	}
+	extract_streams (&in, mesh->vert_count, correct_coords, pool, &streams);
+}
+
+static bool _alloc_mesh (int n, Import_Mesh* mesh) {
+	memset (mesh, 0, sizeof (Import_Mesh));
+	mesh->vertices = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	mesh->normals = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	mesh->texcoords = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	mesh->tangents = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	mesh->bitangents = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	mesh->vert_count = n;
+	if (!mesh->vertices || !mesh->normals || !mesh->texcoords ||
+		!mesh->tangents || !mesh->bitangents) {
+		fprintf (stderr, "ERROR: allocating %i vertices\n", n);
+		return false;
+	}
+	for (size_t i = 0; i < (size_t)n * 3; i++) {
+		mesh->vertices[i] = bench_rand_range (-10.0f, 10.0f);
+		mesh->normals[i] = bench_rand_range (-1.0f, 1.0f);
+		mesh->texcoords[i] = i % 3 == 2 ? 0.0f : bench_rand_range (0.0f, 1.0f);
+		mesh->tangents[i] = bench_rand_range (-1.0f, 1.0f);
+		mesh->bitangents[i] = bench_rand_range (-1.0f, 1.0f);
+	}
+	return true;
+}
+
+static void _free_mesh (Import_Mesh* mesh) {
+	free (mesh->vertices);
+	free (mesh->normals);
+	free (mesh->texcoords);
+	free (mesh->tangents);
+	free (mesh->bitangents);
+}
+
+static bool _alloc_streams (int n, Streams* s) {
+	s->vps = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	s->vns = (float*)malloc ((size_t)n * 3 * sizeof (float));
+	s->vts = (float*)malloc ((size_t)n * 2 * sizeof (float));
+	s->vtangents = (float*)malloc ((size_t)n * 4 * sizeof (float));
+	if (!s->vps || !s->vns || !s->vts || !s->vtangents) {
+		fprintf (stderr, "ERROR: allocating streams of %i vertices\n", n);
+		return false;
+	}
+	return true;
+}
+
+static void _free_streams (Streams* s) {
+	free (s->vps);
+	free (s->vns);
+	free (s->vts);
+	free (s->vtangents);
+}
+
+// so a stream left unwritten shows up as different
+static void _clear_streams (Streams* s, int n) {
+	memset (s->vps, 0, (size_t)n * 3 * sizeof (float));
+	memset (s->vns, 0, (size_t)n * 3 * sizeof (float));
+	memset (s->vts, 0, (size_t)n * 2 * sizeof (float));
+	memset (s->vtangents, 0, (size_t)n * 4 * sizeof (float));
+}
+
+static bool _same_streams (const Streams* a, const Streams* b, int n) {
+	return memcmp (a->vps, b->vps, (size_t)n * 3 * sizeof (float)) == 0 &&
+		memcmp (a->vns, b->vns, (size_t)n * 3 * sizeof (float)) == 0 &&
+		memcmp (a->vts, b->vts, (size_t)n * 2 * sizeof (float)) == 0 &&
+		memcmp (a->vtangents, b->vtangents, (size_t)n * 4 * sizeof (float)) == 0;
+}
+
+int main (int argc, char** argv) {
+	Import_Mesh mesh;
+	Streams ref, out;
+	double ref_ms = 1e30, ms = 1e30, scalar_ms = 1e30;
+	int verts = 1 << 20;
+	int max_threads = (int)std::thread::hardware_concurrency ();
+	int reps = 5;
+	int failed = 0;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-verts");
+	if (a > -1 && a + 1 < argc) {
+		verts = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-threads");
+	if (a > -1 && a + 1 < argc) {
+		max_threads = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	if (max_threads < 1) {
+		max_threads = 1;
+	}
+	if (verts < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+
+	//
+	// every count of leftover vertices after the groups of 4, both ways round,
+	// with every attribute, without texture coordinates and tangents, and
+	// without normals and tangents
+	srand (1);
+	for (int n = 1; n <= 11; n++) {
+		for (int c = 0; c < 2; c++) {
+			for (int missing = 0; missing < 3; missing++) {
+				Import_Mesh part;
+
+				if (!_alloc_mesh (n, &mesh) || !_alloc_streams (n, &ref) ||
+					!_alloc_streams (n, &out)) {
+					return 1;
+				}
+				part = mesh;
+				if (missing > 0) {
+					part.tangents = part.bitangents = NULL;
+				}
+				if (missing == 1) {
+					part.texcoords = NULL;
+				}
+				if (missing == 2) {
+					part.normals = NULL;
+				}
+				_clear_streams (&ref, n);
+				_extract_per_vertex (&part, c == 1, &ref);
+				for (int scalar = 0; scalar < 2; scalar++) {
+					_clear_streams (&out, n);
+					_extract_streams (&part, c == 1, scalar == 1, NULL, &out);
+					if (!_same_streams (&ref, &out, n)) {
+						printf ("FAILED: %i vertices, correct_coords %i, missing %i, "
+							"scalar %i\n", n, c, missing, scalar);
+						failed = 1;
+					}
+				}
+				_free_mesh (&mesh);
+				_free_streams (&ref);
+				_free_streams (&out);
+			}
+		}
+	}
+
+	if (!_alloc_mesh (verts, &mesh) || !_alloc_streams (verts, &ref) ||
+		!_alloc_streams (verts, &out)) {
+		return 1;
+	}
+#ifdef MATHS_SIMD
+	printf ("%i vertices, Z-up to Y-up, %i hardware threads, SSE2\n", verts,
+		(int)std::thread::hardware_concurrency ());
+#else
+	printf ("%i vertices, Z-up to Y-up, %i hardware threads, no SIMD\n", verts,
+		(int)std::thread::hardware_concurrency ());
+#endif
+	for (int r = 0; r < reps; r++) {
+		double t1 = bench_time_ms ();
+		_extract_per_vertex (&mesh, true, &ref);
+		double t2 = bench_time_ms ();
+		_extract_streams (&mesh, true, true, NULL, &out);
+		double t3 = bench_time_ms ();
+		ref_ms = fmin (ref_ms, t2 - t1);
+		scalar_ms = fmin (scalar_ms, t3 - t2);
+	}
+	if (!_same_streams (&ref, &out, verts)) {
+		printf ("FAILED: scalar streams differ from the per-vertex loop\n");
+		failed = 1;
+	}
+	printf ("per-vertex loop:   %8.2f ms  %8.1f M vertices/s\n", ref_ms,
+		verts / ref_ms / 1000.0);
+	printf ("streams, scalar:   %8.2f ms  %8.1f M vertices/s  x%.2f\n",
+		scalar_ms, verts / scalar_ms / 1000.0, ref_ms / scalar_ms);
+
+	for (int threads = 1; threads <= max_threads;
+		threads = threads * 2 > max_threads && threads < max_threads ?
+		max_threads : threads * 2) {
+		Apg_Pool pool;
+
+		if (!apg_init_pool (threads, &pool)) {
+			return 1;
+		}
+		ms = 1e30;
+		for (int r = 0; r < reps; r++) {
+			_clear_streams (&out, verts);
+			double t1 = bench_time_ms ();
+			_extract_streams (&mesh, true, false, &pool, &out);
+			double t2 = bench_time_ms ();
+			ms = fmin (ms, t2 - t1);
+		}
+		apg_free_pool (&pool);
+		printf ("streams, %2i threads:     %8.2f ms  %8.1f M vertices/s  x%.2f\n",
+			threads, ms, verts / ms / 1000.0, ref_ms / ms);
+		if (!_same_streams (&ref, &out, verts)) {
+			printf ("  FAILED: streams differ from the per-vertex loop\n");
+			failed = 1;
+		}
+	}
+
+	_free_mesh (&mesh);
+	_free_streams (&ref);
+	_free_streams (&out);
+	return failed;
+}
@@ -0,0 +1,391 @@
+//
+// benchmark for the .apg loader
+// First version 17 Oct 2026
+//
+// times apg_load_mesh() against the fgets/fscanf reader that the viewer used
+// before, on the given files and on a synthetic multi-MB file, and checks
+// that both readers produce the same values. the generated file's normals,
+// texture coordinates and tangents are "%.3g", whose varying lengths make it
+// slower per byte than the converter's own output
+//
+// usage: ./bench_loader [FILE.apg ...] [-verts N] [-reps N]
+//
+
+#include "apg_loader.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNTH_FILE_NAME "bench_synthetic.apg"
+
+//
+// the previous fgets/fscanf reader. fills the same struct so results compare
+static bool _ref_load (const char* file_name, Apg_Mesh* mesh) {
+	FILE* f;
+	char line[1024];
+	int current_anim_index = -1;
+
+	memset ((void*)mesh, 0, sizeof (Apg_Mesh));
+	mesh->vb_type = APG_TYPE_F32;
+	mesh->vw_type = APG_TYPE_F32;
+	mesh->root_transform = identity_mat4 ();
+	f = fopen (file_name, "r");
+	if (!f) {
+		fprintf (stderr, "ERROR opening file %s\n", file_name);
+		return false;
+	}
+	while (fgets (line, 1024, f)) {
+		char code_str[32];
+		float** block = NULL;
+		int* comps = NULL;
+
+		if ('@' != line[0]) {
+			continue;
+		}
+		sscanf (line, "@%31s\n", code_str);
+		if (strcmp (code_str, "vert_count") == 0) {
+			sscanf (line, "@vert_count %i\n", &mesh->vert_count);
+		} else if (strcmp (code_str, "vp") == 0) {
+			block = &mesh->vps;
+			comps = &mesh->vp_comps;
+		} else if (strcmp (code_str, "vn") == 0) {
+			block = &mesh->vns;
+			comps = &mesh->vn_comps;
+		} else if (strcmp (code_str, "vt") == 0) {
+			block = &mesh->vts;
+			comps = &mesh->vt_comps;
+		} else if (strcmp (code_str, "vtan") == 0) {
+			block = &mesh->vtans;
+			comps = &mesh->vtan_comps;
+		} else if (strcmp (code_str, "vb") == 0) {
+			block = (float**)&mesh->vbs;
+			comps = &mesh->vb_comps;
+		} else if (strcmp (code_str, "vw") == 0) {
+			block = (float**)&mesh->vws;
+			comps = &mesh->vw_comps;
+		} else if (strcmp (code_str, "skeleton") == 0) {
+			sscanf (line, "@skeleton bones %i animations %i\n", &mesh->bone_count,
+				&mesh->animation_count);
+			mesh->animations = (Animation*)calloc (mesh->animation_count,
+				sizeof (Animation));
+		} else if (strcmp (code_str, "root_transform") == 0) {
+			for (int j = 0; j < 16; j++) {
+				fscanf (f, "%f", &mesh->root_transform.m[j]);
+			}
+			fscanf (f, "\n");
+		} else if (strcmp (code_str, "offset_mat") == 0) {
+			mesh->offset_mats = (mat4*)malloc (mesh->bone_count * sizeof (mat4));
+			for (int i = 0; i < mesh->bone_count; i++) {
+				for (int j = 0; j < 16; j++) {
+					fscanf (f, "%f", &mesh->offset_mats[i].m[j]);
+				}
+				fscanf (f, "\n");
+			}
+		} else if (strcmp (code_str, "hierarchy") == 0) {
+			sscanf (line, "@hierarchy nodes %i\n", &mesh->anim_node_count);
+			mesh->node_parents = (int*)malloc (mesh->anim_node_count * sizeof (int));
+			mesh->node_bone_ids = (int*)malloc (
+				mesh->anim_node_count * sizeof (int));
+			for (int i = 0; i < mesh->anim_node_count; i++) {
+				fscanf (f, "parent %i bone_id %i\n", &mesh->node_parents[i],
+					&mesh->node_bone_ids[i]);
+			}
+			for (int i = 0; i < mesh->animation_count; i++) {
+				mesh->animations[i].channels = (Channel*)calloc (
+					mesh->anim_node_count, sizeof (Channel));
+				mesh->animations[i].num_channels = mesh->anim_node_count;
+			}
+		} else if (strcmp (code_str, "animation") == 0) {
+			current_anim_index++;
+			sscanf (line, "@animation name %63s duration %lf\n",
+				mesh->animations[current_anim_index].name,
+				&mesh->animations[current_anim_index].duration);
+		} else if (strcmp (code_str, "tra_keys") == 0) {
+			int node = 0, count = 0, c = 0;
+			Channel* ch;
+
+			sscanf (line, "@tra_keys node %i count %i comps %i\n", &node, &count, &c);
+			ch = &mesh->animations[current_anim_index].channels[node];
+			ch->tra_keys = (TraAnimKey*)malloc (count * sizeof (TraAnimKey));
+			ch->tra_keys_count = count;
+			for (int i = 0; i < count; i++) {
+				fscanf (f, "t %f TRA %f %f %f\n", &ch->tra_keys[i].time,
+					&ch->tra_keys[i].tra.v[0], &ch->tra_keys[i].tra.v[1],
+					&ch->tra_keys[i].tra.v[2]);
+			}
+		} else if (strcmp (code_str, "sca_keys") == 0) {
+			int node = 0, count = 0, c = 0;
+			Channel* ch;
+
+			sscanf (line, "@sca_keys node %i count %i comps %i\n", &node, &count, &c);
+			ch = &mesh->animations[current_anim_index].channels[node];
+			ch->sca_keys = (ScaAnimKey*)malloc (count * sizeof (ScaAnimKey));
+			ch->sca_keys_count = count;
+			for (int i = 0; i < count; i++) {
+				fscanf (f, "t %f SCA %f %f %f\n", &ch->sca_keys[i].time,
+					&ch->sca_keys[i].sca.v[0], &ch->sca_keys[i].sca.v[1],
+					&ch->sca_keys[i].sca.v[2]);
+			}
+		} else if (strcmp (code_str, "rot_keys") == 0) {
+			int node = 0, count = 0, c = 0;
+			Channel* ch;
+
+			sscanf (line, "@rot_keys node %i count %i comps %i\n", &node, &count, &c);
+			ch = &mesh->animations[current_anim_index].channels[node];
+			ch->rot_keys = (RotAnimKey*)malloc (count * sizeof (RotAnimKey));
+			ch->rot_keys_count = count;
+			for (int i = 0; i < count; i++) {
+				fscanf (f, "t %f ROT %f %f %f %f\n", &ch->rot_keys[i].time,
+					&ch->rot_keys[i].rot.q[0], &ch->rot_keys[i].rot.q[1],
+					&ch->rot_keys[i].rot.q[2], &ch->rot_keys[i].rot.q[3]);
+			}
+		} else if (strcmp (code_str, "bounding_radius") == 0) {
+			sscanf (line, "@bounding_radius %f", &mesh->bounding_radius);
+		}
+		if (block) {
+			sscanf (line, "@%*s comps %i\n", comps);
+			*block = (float*)malloc (mesh->vert_count * *comps * sizeof (float));
+			for (int i = 0; i < mesh->vert_count * *comps; i++) {
+				fscanf (f, "%f", &(*block)[i]);
+			}
+			fscanf (f, "\n");
+		}
+	}
+	fclose (f);
+	return true;
+}
+
+//
+// writes a skinned mesh in the same number formats the converter uses
+static bool _write_synthetic (const char* file_name, int verts) {
+	FILE* f = fopen (file_name, "w");
+	int nodes = 32;
+	int keys = 250;
+	uint8_t* packed_ids = NULL;
+	uint8_t* packed_weights = NULL;
+
+	if (!f) {
+		fprintf (stderr, "ERROR: opening file %s for writing\n", file_name);
+		return false;
+	}
+	srand (1);
+	fprintf (f, "@Anton's custom mesh format v.27DEC2014 synthetic\n");
+	fprintf (f, "@vert_count %i\n", verts);
+	fprintf (f, "@vp comps 3\n");
+	for (int i = 0; i < verts; i++) {
+		fprintf (f, "%.2f %.2f %.2f\n", rand () / (float)RAND_MAX * 4.0f - 2.0f,
+			rand () / (float)RAND_MAX * 4.0f - 2.0f,
+			rand () / (float)RAND_MAX * 4.0f - 2.0f);
+	}
+	fprintf (f, "@vn comps 3\n");
+	for (int i = 0; i < verts; i++) {
+		fprintf (f, "%.3g %.3g %.3g\n", rand () / (float)RAND_MAX * 2.0f - 1.0f,
+			rand () / (float)RAND_MAX * 2.0f - 1.0f,
+			rand () / (float)RAND_MAX * 0.002f - 0.001f);
+	}
+	fprintf (f, "@vt comps 2\n");
+	for (int i = 0; i < verts; i++) {
+		fprintf (f, "%.3g %.3g\n", rand () / (float)RAND_MAX,
+			rand () / (float)RAND_MAX);
+	}
+	fprintf (f, "@vtan comps 4\n");
+	for (int i = 0; i < verts; i++) {
+		fprintf (f, "%.3g %.3g %.3g %.3g\n", rand () / (float)RAND_MAX - 0.5f,
+			rand () / (float)RAND_MAX - 0.5f, rand () / (float)RAND_MAX - 0.5f,
+			rand () % 2 ? 1.0f : -1.0f);
+	}
+	//
+	// packed as the converter writes them
+	packed_ids = (uint8_t*)malloc (verts * APG_BONE_INFLUENCES);
+	packed_weights = (uint8_t*)malloc (verts * APG_BONE_INFLUENCES);
+	for (int i = 0; i < verts; i++) {
+		int ids[APG_BONE_INFLUENCES];
+		float weights[APG_BONE_INFLUENCES];
+
+		for (int j = 0; j < APG_BONE_INFLUENCES; j++) {
+			ids[j] = rand () % nodes;
+			weights[j] = rand () / (float)RAND_MAX;
+		}
+		apg_encode_bone_weights (ids, weights, APG_BONE_INFLUENCES,
+			&packed_ids[i * APG_BONE_INFLUENCES],
+			&packed_weights[i * APG_BONE_INFLUENCES]);
+	}
+	fprintf (f, "@vb comps %i\n", APG_BONE_INFLUENCES);
+	for (int i = 0; i < verts * APG_BONE_INFLUENCES; i++) {
+		fprintf (f, i % APG_BONE_INFLUENCES == APG_BONE_INFLUENCES - 1 ?
+			"%i\n" : "%i ", packed_ids[i]);
+	}
+	fprintf (f, "@vw comps %i\n", APG_BONE_INFLUENCES);
+	for (int i = 0; i < verts * APG_BONE_INFLUENCES; i++) {
+		fprintf (f, i % APG_BONE_INFLUENCES == APG_BONE_INFLUENCES - 1 ?
+			"%f\n" : "%f ", packed_weights[i] / 255.0f);
+	}
+	free (packed_ids);
+	free (packed_weights);
+	fprintf (f, "@skeleton bones %i animations 1\n", nodes);
+	fprintf (f, "@root_transform comps 16\n");
+	fprintf (f, "1.000000 0.000000 0.000000 0.000000 0.000000 1.000000 0.000000 "
+		"0.000000 0.000000 0.000000 1.000000 0.000000 0.000000 0.000000 0.000000 "
+		"1.000000\n");
+	fprintf (f, "@offset_mat comps 16\n");
+	for (int i = 0; i < nodes; i++) {
+		for (int j = 0; j < 16; j++) {
+			fprintf (f, j > 0 ? " %f" : "%f", rand () / (float)RAND_MAX);
+		}
+		fprintf (f, "\n");
+	}
+	fprintf (f, "@hierarchy nodes %i\n", nodes);
+	for (int i = 0; i < nodes; i++) {
+		fprintf (f, "parent %i bone_id %i\n", i - 1, i);
+	}
+	fprintf (f, "@animation name synthetic duration %f\n", keys / 30.0);
+	for (int i = 0; i < nodes; i++) {
+		fprintf (f, "@tra_keys node %i count %i comps 3\n", i, keys);
+		for (int k = 0; k < keys; k++) {
+			fprintf (f, "t %f TRA %f %f %f\n", k / 30.0, rand () / (float)RAND_MAX,
+				rand () / (float)RAND_MAX, rand () / (float)RAND_MAX);
+		}
+		fprintf (f, "@rot_keys node %i count %i comps 4\n", i, keys);
+		for (int k = 0; k < keys; k++) {
+			fprintf (f, "t %f ROT %f %f %f %f\n", k / 30.0, rand () / (float)RAND_MAX,
+				rand () / (float)RAND_MAX, rand () / (float)RAND_MAX,
+				rand () / (float)RAND_MAX);
+		}
+	}
+	fprintf (f, "@bounding_radius 3.46");
+	fclose (f);
+	return true;
+}
+
+// counts values that differ bit-for-bit between two float arrays
+static int _count_diffs (const float* a, const float* b, int n) {
+	int diffs = 0;
+
+	if (!a || !b) {
+		return (a == b) ? 0 : n;
+	}
+	for (int i = 0; i < n; i++) {
+		if (memcmp (&a[i], &b[i], sizeof (float)) != 0) {
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+static int _compare (const Apg_Mesh* a, const Apg_Mesh* b) {
+	int diffs = 0;
+
+	diffs += _count_diffs (a->vps, b->vps, a->vert_count * a->vp_comps);
+	diffs += _count_diffs (a->vns, b->vns, a->vert_count * a->vn_comps);
+	diffs += _count_diffs (a->vts, b->vts, a->vert_count * a->vt_comps);
+	diffs += _count_diffs (a->vtans, b->vtans, a->vert_count * a->vtan_comps);
+	diffs += _count_diffs ((const float*)a->vbs, (const float*)b->vbs,
+		a->vert_count * a->vb_comps);
+	diffs += _count_diffs ((const float*)a->vws, (const float*)b->vws,
+		a->vert_count * a->vw_comps);
+	diffs += _count_diffs (a->root_transform.m, b->root_transform.m, 16);
+	diffs += _count_diffs ((const float*)a->offset_mats,
+		(const float*)b->offset_mats, a->bone_count * 16);
+	for (int i = 0; i < a->animation_count && i < b->animation_count; i++) {
+		for (int j = 0; j < a->animations[i].num_channels; j++) {
+			const Channel* ca = &a->animations[i].channels[j];
+			const Channel* cb = &b->animations[i].channels[j];
+
+			diffs += _count_diffs ((const float*)ca->tra_keys,
+				(const float*)cb->tra_keys, ca->tra_keys_count * 4);
+			diffs += _count_diffs ((const float*)ca->sca_keys,
+				(const float*)cb->sca_keys, ca->sca_keys_count * 4);
+			diffs += _count_diffs ((const float*)ca->rot_keys,
+				(const float*)cb->rot_keys, ca->rot_keys_count * 5);
+		}
+	}
+	return diffs;
+}
+
+static void _bench_file (const char* file_name, int reps) {
+	Apg_Mesh ref, fast;
+	double ref_ms = 1e30, fast_ms = 1e30;
+	long size = 0;
+	FILE* f;
+
+	f = fopen (file_name, "rb");
+	if (!f) {
+		fprintf (stderr, "ERROR: opening file %s\n", file_name);
+		return;
+	}
+	fseek (f, 0, SEEK_END);
+	size = ftell (f);
+	fclose (f);
+
+	//
+	// best of n for each to reduce noise. first pass warms the file cache
+	for (int i = 0; i < reps; i++) {
+		double t0 = bench_time_ms ();
+		if (!_ref_load (file_name, &ref)) {
+			return;
+		}
+		double t1 = bench_time_ms ();
+		if (t1 - t0 < ref_ms) {
+			ref_ms = t1 - t0;
+		}
+		if (i < reps - 1) {
+			apg_free_mesh (&ref);
+		}
+	}
+	for (int i = 0; i < reps; i++) {
+		double t0 = bench_time_ms ();
+		if (!apg_load_mesh (file_name, &fast)) {
+			apg_free_mesh (&ref);
+			return;
+		}
+		double t1 = bench_time_ms ();
+		if (t1 - t0 < fast_ms) {
+			fast_ms = t1 - t0;
+		}
+		if (i < reps - 1) {
+			apg_free_mesh (&fast);
+		}
+	}
+	printf ("%-24s %9.2f MB %6i verts  fscanf %9.3f ms  apg %8.3f ms  "
+		"x%6.1f  %i diffs\n", file_name, size / (1024.0 * 1024.0), fast.vert_count,
+		ref_ms, fast_ms, ref_ms / fast_ms, _compare (&ref, &fast));
+	apg_free_mesh (&ref);
+	apg_free_mesh (&fast);
+}
+
+int main (int argc, char** argv) {
+	int verts = 200000;
+	int reps = 5;
+	int files = 0;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-verts");
+	if (a > -1 && a + 1 < argc) {
+		verts = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	for (int i = 1; i < argc; i++) {
+		if ('-' == argv[i][0]) {
+			i++;
+			continue;
+		}
+		_bench_file (argv[i], reps);
+		files++;
+	}
+	if (0 == files) {
+		_bench_file ("coins.apg", reps);
+		_bench_file ("amphora.apg", reps);
+		_bench_file ("untitled.apg", reps);
+	}
+	if (verts > 0 && _write_synthetic (SYNTH_FILE_NAME, verts)) {
+		_bench_file (SYNTH_FILE_NAME, reps);
+		remove (SYNTH_FILE_NAME);
+	}
+	return 0;
+}
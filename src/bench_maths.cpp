@@ -0,0 +1,402 @@
+//
+// test and benchmark for the SIMD maths functions
+// First version 17 Oct 2026
+//
+// checks the SIMD versions of mat4 multiply, inverse and quat_to_mat4 and of
+// versor normalise against the scalar versions on random inputs,
+// then times each. all but inverse must match exactly. inverse is checked
+// against an inverse worked out in double, allowing for the condition of the
+// matrix. the affine mat3x4 multiply must match mat4 multiply exactly, and
+// inverse_affine is held to the same limit as inverse. nlerp and corrected
+// nlerp are compared with slerp along key pairs a range of angles apart.
+// returns non-zero if any check fails
+//
+// usage: ./bench_maths [-n N] [-reps N]
+//
+
+#include "maths_funcs.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+// largest error allowed in an inverse, in units of float epsilon times the
+// matrix's condition number, which is about how much error inverting in float
+// can't avoid
+#define INVERSE_MAX_ERROR 16.0
+// largest angle in degrees allowed between corrected nlerp and slerp
+#define NLERP_CORRECTED_MAX_ERROR 0.1
+// blend factors tried between each pair of keys
+#define NLERP_STEPS 256
+
+static versor _rand_versor (float len) {
+	return bench_rand_versor () * len;
+}
+
+//
+// mostly translate * rotate * scale, as the animation code builds, with every
+// eighth fully random
+static mat4 _rand_mat4 (int i) {
+	versor q = _rand_versor (1.0f);
+	mat4 m;
+
+	if (0 == i % 8) {
+		for (int j = 0; j < 16; j++) {
+			m.m[j] = bench_rand_range (-2.0f, 2.0f);
+		}
+		return m;
+	}
+	m = quat_to_mat4_scalar (q);
+	for (int j = 0; j < 12; j++) {
+		m.m[j] *= bench_rand_range (0.5f, 2.0f);
+	}
+	m.m[12] = bench_rand_range (-10.0f, 10.0f);
+	m.m[13] = bench_rand_range (-10.0f, 10.0f);
+	m.m[14] = bench_rand_range (-10.0f, 10.0f);
+	return m;
+}
+
+// angle in degrees between the rotations of two versors, worked out in double
+static double _angle_deg (const versor& a, const versor& b) {
+	double ab = 0.0, aa = 0.0, bb = 0.0, d;
+
+	for (int i = 0; i < 4; i++) {
+		ab += (double)a.q[i] * b.q[i];
+		aa += (double)a.q[i] * a.q[i];
+		bb += (double)b.q[i] * b.q[i];
+	}
+	d = fabs (ab) / sqrt (aa * bb);
+	return d >= 1.0 ? 0.0 : 2.0 * acos (d) * ONE_RAD_IN_DEG;
+}
+
+//
+// largest difference of inv from the inverse of m worked out in double by
+// Gauss-Jordan elimination. relative to that inverse's largest element, then
+// divided by FLT_EPSILON and the condition number of m
+static double _inverse_error (const mat4& m, const mat4& inv) {
+	double a[4][8];
+	double big = 0.0, err = 0.0, norm = 0.0, inv_norm = 0.0;
+
+	for (int r = 0; r < 4; r++) {
+		double row = 0.0;
+
+		for (int c = 0; c < 4; c++) {
+			a[r][c] = m.m[c * 4 + r];
+			a[r][c + 4] = r == c ? 1.0 : 0.0;
+			row += fabs (a[r][c]);
+		}
+		norm = fmax (norm, row);
+	}
+	for (int c = 0; c < 4; c++) {
+		int pivot = c;
+
+		for (int r = c + 1; r < 4; r++) {
+			if (fabs (a[r][c]) > fabs (a[pivot][c])) {
+				pivot = r;
+			}
+		}
+		for (int k = 0; k < 8; k++) {
+			double tmp = a[c][k];
+
+			a[c][k] = a[pivot][k];
+			a[pivot][k] = tmp;
+		}
+		for (int r = 0; r < 4; r++) {
+			double f = a[r][c] / a[c][c];
+
+			if (r == c) {
+				continue;
+			}
+			for (int k = 0; k < 8; k++) {
+				a[r][k] -= f * a[c][k];
+			}
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		double row = 0.0;
+
+		for (int c = 0; c < 4; c++) {
+			big = fmax (big, fabs (a[r][c + 4] / a[r][r]));
+			row += fabs (a[r][c + 4] / a[r][r]);
+		}
+		inv_norm = fmax (inv_norm, row);
+	}
+	for (int r = 0; r < 4; r++) {
+		for (int c = 0; c < 4; c++) {
+			err = fmax (err, fabs (a[r][c + 4] / a[r][r] - inv.m[c * 4 + r]));
+		}
+	}
+	return err / big / (FLT_EPSILON * norm * inv_norm);
+}
+
+// counts elements that differ. 0 and -0 count as the same
+static int _count_diffs (const float* a, const float* b, int n) {
+	int diffs = 0;
+
+	for (int i = 0; i < n; i++) {
+		if (!(a[i] == b[i]) && !(a[i] != a[i] && b[i] != b[i])) {
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+// runs 'call' over every input and keeps the best of reps. 'sink' stops the
+// compiler removing the work
+#define TIME_LOOP(best, call) \
+	for (int r = 0; r < reps; r++) { \
+		double t1 = bench_time_ms (); \
+		for (int i = 0; i < n; i++) { \
+			call; \
+		} \
+		double t2 = bench_time_ms (); \
+		if (t2 - t1 < best) { \
+			best = t2 - t1; \
+		} \
+	}
+
+int main (int argc, char** argv) {
+	mat4 *a, *b, *out;
+	mat3x4 *aa, *ab, *aout;
+	versor *qa, *qb, *qout;
+	float* ts;
+	float sink = 0.0f;
+	int n = 100000;
+	int reps = 5;
+	int failed = 0;
+	int arg;
+
+	my_argc = argc;
+	my_argv = argv;
+	arg = check_arg ("-n");
+	if (arg > -1 && arg + 1 < argc) {
+		n = atoi (argv[arg + 1]);
+	}
+	arg = check_arg ("-reps");
+	if (arg > -1 && arg + 1 < argc) {
+		reps = atoi (argv[arg + 1]);
+	}
+	if (n < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+	a = (mat4*)malloc (n * sizeof (mat4));
+	b = (mat4*)malloc (n * sizeof (mat4));
+	out = (mat4*)malloc (n * sizeof (mat4));
+	qa = (versor*)malloc (n * sizeof (versor));
+	qb = (versor*)malloc (n * sizeof (versor));
+	qout = (versor*)malloc (n * sizeof (versor));
+	ts = (float*)malloc (n * sizeof (float));
+	aa = (mat3x4*)malloc (n * sizeof (mat3x4));
+	ab = (mat3x4*)malloc (n * sizeof (mat3x4));
+	aout = (mat3x4*)malloc (n * sizeof (mat3x4));
+	srand (1);
+	for (int i = 0; i < n; i++) {
+		versor near;
+
+		a[i] = _rand_mat4 (i);
+		b[i] = _rand_mat4 (i + 1);
+		//
+		// some versors just off unit length, some far off, some pairs almost
+		// the same or opposite, to reach every branch of normalise and slerp
+		qa[i] = _rand_versor (0 == i % 3 ?
+			bench_rand_range (0.99995f, 1.00005f) : bench_rand_range (0.5f, 1.5f));
+		near = qa[i] + _rand_versor (bench_rand_range (0.0f, 0.3f));
+		qb[i] = 0 == i % 5 ? qa[i] * (i % 2 ? -1.0f : 1.0f) :
+			normalise_scalar (near);
+		qa[i] = normalise_scalar (qa[i]);
+		ts[i] = bench_rand_range (0.0f, 1.0f);
+	}
+	for (int i = 0; i < n; i++) {
+		aa[i] = mat3x4_from_mat4 (_rand_mat4 (2 * i + 1));
+		ab[i] = mat3x4_from_mat4 (_rand_mat4 (2 * i + 3));
+	}
+
+	{
+		int mul_diffs = 0, trs_diffs = 0;
+		double inv_err = 0.0;
+
+		for (int i = 0; i < n; i++) {
+			mat4 s = mat4_mul_scalar (mat4_from_mat3x4 (aa[i]),
+				mat4_from_mat3x4 (ab[i]));
+			mat4 v = mat4_from_mat3x4 (mat3x4_mul_scalar (aa[i], ab[i]));
+			vec3 t (bench_rand_range (-10.0f, 10.0f), 0.0f,
+				bench_rand_range (-1.0f, 1.0f));
+			vec3 sc (bench_rand_range (0.5f, 2.0f), 1.0f,
+				bench_rand_range (0.5f, 2.0f));
+
+			mul_diffs += _count_diffs (s.m, v.m, 16) ? 1 : 0;
+			s = mat4_mul_scalar (mat4_mul_scalar (translate (identity_mat4 (), t),
+				quat_to_mat4_scalar (qa[i])), scale (identity_mat4 (), sc));
+			v = mat4_from_mat3x4 (trs_mat3x4 (t, qa[i], sc));
+			trs_diffs += _count_diffs (s.m, v.m, 16) ? 1 : 0;
+			inv_err = fmax (inv_err, _inverse_error (mat4_from_mat3x4 (aa[i]),
+				mat4_from_mat3x4 (inverse_affine (aa[i]))));
+		}
+		printf ("%i random affine inputs. results differing from mat4:\n", n);
+		printf ("  mat3x4 multiply %i  trs_mat3x4 %i\n", mul_diffs, trs_diffs);
+		printf ("  inverse_affine max error %.2f (limit %g)\n", inv_err,
+			INVERSE_MAX_ERROR);
+		if (mul_diffs || trs_diffs || !(inv_err <= INVERSE_MAX_ERROR)) {
+			fprintf (stderr, "ERROR: affine results differ from mat4\n");
+			failed = 1;
+		}
+	}
+
+	{
+		// keys at 30 a second are rarely more than 15 degrees apart
+		const float key_angles[] = { 1.0f, 5.0f, 15.0f, 30.0f, 60.0f, 90.0f,
+			135.0f, 180.0f };
+		int angle_count = sizeof (key_angles) / sizeof (key_angles[0]);
+		int pairs = n / NLERP_STEPS > 100 ? n / NLERP_STEPS : 100;
+		double worst = 0.0;
+
+		printf ("largest angle from slerp, degrees, over %i key pairs each:\n",
+			pairs);
+		for (int k = 0; k < angle_count; k++) {
+			double nlerp_err = 0.0, corrected_err = 0.0;
+
+			for (int p = 0; p < pairs; p++) {
+				versor q = _rand_versor (1.0f);
+				vec3 axis (bench_rand_range (-1.0f, 1.0f),
+					bench_rand_range (-1.0f, 1.0f), bench_rand_range (-1.0f, 1.0f));
+				versor r;
+
+				axis = normalise (axis);
+				r = q * quat_from_axis_deg (key_angles[k], axis.v[0], axis.v[1],
+					axis.v[2]);
+				r = normalise_scalar (r);
+				// half of the pairs in opposite hemispheres
+				if (p % 2) {
+					r = r * -1.0f;
+				}
+				for (int i = 0; i <= NLERP_STEPS; i++) {
+					float t = (float)i / NLERP_STEPS;
+					versor q0 = q, r0 = r;
+					versor sq = slerp (q0, r0, t);
+
+					nlerp_err = fmax (nlerp_err, _angle_deg (sq, nlerp (q, r, t)));
+					corrected_err = fmax (corrected_err,
+						_angle_deg (sq, nlerp_corrected (q, r, t)));
+				}
+			}
+			printf ("  keys %3.0f apart: nlerp %9.5f  corrected %9.5f\n",
+				key_angles[k], nlerp_err, corrected_err);
+			worst = fmax (worst, corrected_err);
+		}
+		if (!(worst <= NLERP_CORRECTED_MAX_ERROR)) {
+			fprintf (stderr, "ERROR: corrected nlerp is %g degrees from slerp\n",
+				worst);
+			failed = 1;
+		}
+	}
+
+#ifdef MATHS_SIMD
+	{
+		int mul_diffs = 0, q2m_diffs = 0, norm_diffs = 0;
+		int affine_diffs = 0;
+		double scalar_inv_err = 0.0, simd_inv_err = 0.0;
+
+		for (int i = 0; i < n; i++) {
+			mat4 s = mat4_mul_scalar (a[i], b[i]);
+			mat4 v = mat4_mul_simd (a[i], b[i]);
+			mat4 si, vi;
+			versor q1 = qb[i], r1 = qb[i];
+			versor sq, vq;
+
+			mat3x4 sa = mat3x4_mul_scalar (aa[i], ab[i]);
+			mat3x4 va = mat3x4_mul_simd (aa[i], ab[i]);
+
+			mul_diffs += _count_diffs (s.m, v.m, 16) ? 1 : 0;
+			affine_diffs += _count_diffs (sa.m, va.m, 12) ? 1 : 0;
+			s = quat_to_mat4_scalar (qb[i]);
+			v = quat_to_mat4_simd (qb[i]);
+			q2m_diffs += _count_diffs (s.m, v.m, 16) ? 1 : 0;
+			sq = normalise_scalar (q1);
+			vq = normalise_simd (r1);
+			norm_diffs += _count_diffs (sq.q, vq.q, 4) ? 1 : 0;
+			si = inverse_scalar (a[i]);
+			vi = inverse_simd (a[i]);
+			scalar_inv_err = fmax (scalar_inv_err, _inverse_error (a[i], si));
+			simd_inv_err = fmax (simd_inv_err, _inverse_error (a[i], vi));
+		}
+		printf ("%i random inputs. results differing from scalar:\n", n);
+		printf ("  mat4 multiply %i  quat_to_mat4 %i  normalise %i  "
+			"mat3x4 multiply %i\n", mul_diffs, q2m_diffs, norm_diffs, affine_diffs);
+		printf ("  inverse max error: scalar %.2f simd %.2f (limit %g). in "
+			"epsilons x condition\n", scalar_inv_err, simd_inv_err,
+			INVERSE_MAX_ERROR);
+		if (mul_diffs || q2m_diffs || norm_diffs || affine_diffs ||
+			!(simd_inv_err <= INVERSE_MAX_ERROR)) {
+			fprintf (stderr, "ERROR: SIMD results differ from scalar\n");
+			failed = 1;
+		}
+	}
+#else
+	printf ("built with MATHS_NO_SIMD or without SSE2. timing scalar only\n");
+#endif
+
+	{
+		double scalar_ms[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+		double simd_ms[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+		double affine_inv_ms = 1e30, slerp_ms = 1e30, nlerp_ms = 1e30;
+		double corrected_ms = 1e30;
+		const char* names[5] = {
+			"mat4 multiply", "inverse", "quat_to_mat4", "normalise",
+			"mat3x4 multiply"
+		};
+
+		TIME_LOOP (scalar_ms[0], out[i] = mat4_mul_scalar (a[i], b[i]));
+		TIME_LOOP (scalar_ms[1], out[i] = inverse_scalar (a[i]));
+		TIME_LOOP (scalar_ms[2], out[i] = quat_to_mat4_scalar (qa[i]));
+		TIME_LOOP (scalar_ms[3], qout[i] = normalise_scalar (qb[i]));
+		TIME_LOOP (scalar_ms[4], aout[i] = mat3x4_mul_scalar (aa[i], ab[i]));
+		TIME_LOOP (affine_inv_ms, aout[i] = inverse_affine (aa[i]));
+		TIME_LOOP (slerp_ms, versor q0 = qa[i]; versor q1 = qb[i];
+			qout[i] = slerp (q0, q1, ts[i]));
+		TIME_LOOP (nlerp_ms, qout[i] = nlerp (qa[i], qb[i], ts[i]));
+		TIME_LOOP (corrected_ms, qout[i] = nlerp_corrected (qa[i], qb[i], ts[i]));
+#ifdef MATHS_SIMD
+		TIME_LOOP (simd_ms[0], out[i] = mat4_mul_simd (a[i], b[i]));
+		TIME_LOOP (simd_ms[1], out[i] = inverse_simd (a[i]));
+		TIME_LOOP (simd_ms[2], out[i] = quat_to_mat4_simd (qa[i]));
+		TIME_LOOP (simd_ms[3], qout[i] = normalise_simd (qb[i]));
+		TIME_LOOP (simd_ms[4], aout[i] = mat3x4_mul_simd (aa[i], ab[i]));
+#endif
+		for (int i = 0; i < n; i++) {
+			sink += out[i].m[i % 16] + qout[i].q[i % 4] + aout[i].m[i % 12];
+		}
+		for (int i = 0; i < 5; i++) {
+#ifdef MATHS_SIMD
+			printf ("%-15s scalar %7.2f ns  simd %7.2f ns  x%.2f\n", names[i],
+				scalar_ms[i] * 1e6 / n, simd_ms[i] * 1e6 / n,
+				scalar_ms[i] / simd_ms[i]);
+#else
+			printf ("%-15s scalar %7.2f ns\n", names[i], scalar_ms[i] * 1e6 / n);
+			(void)simd_ms;
+#endif
+		}
+		printf ("%-15s scalar %7.2f ns\n", "inverse_affine",
+			affine_inv_ms * 1e6 / n);
+		printf ("%-15s scalar %7.2f ns\n", "slerp", slerp_ms * 1e6 / n);
+		printf ("%-15s scalar %7.2f ns\n", "nlerp", nlerp_ms * 1e6 / n);
+		printf ("%-15s scalar %7.2f ns\n", "nlerp_corrected",
+			corrected_ms * 1e6 / n);
+	}
+	if (sink == 12345.0f) {
+		printf ("\n");
+	}
+
+	free (a);
+	free (b);
+	free (out);
+	free (qa);
+	free (qb);
+	free (qout);
+	free (ts);
+	free (aa);
+	free (ab);
+	free (aout);
+	return failed;
+}
@@ -0,0 +1,283 @@
+//
+// test and benchmark for CPU skinning
+// First version 17 Oct 2026
+//
+// skins a generated mesh of points, normals and tangents by a random palette,
+// with one bone per vertex as the converter writes and with four weighted
+// bones. checks apg_skin_scalar () against the same sums worked out in double,
+// apg_skin () against apg_skin_scalar (), and skinning in place against
+// skinning to new streams. then times both on one thread in millions of
+// vertices a second. returns non-zero if any check fails
+//
+// usage: ./bench_skin [-verts N] [-bones N] [-reps N]
+//
+
+#include "apg_skin.hpp"
+#include "apg_bench.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// largest difference allowed from the double precision sums, relative to the
+// sum of the sizes of the terms added, or 1 if that is smaller. the terms can
+// cancel when random bones are blended, and rounding goes with their size
+#define MAX_ERROR 1e-5
+
+static void _rand_direction (float* d) {
+	float len;
+
+	do {
+		for (int i = 0; i < 3; i++) {
+			d[i] = bench_rand_range (-1.0f, 1.0f);
+		}
+		len = sqrtf (d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	} while (len < 0.1f);
+	for (int i = 0; i < 3; i++) {
+		d[i] /= len;
+	}
+}
+
+static double _rel_error (double ref, float v) {
+	return fabs (ref - v) / fmax (1.0, fabs (ref));
+}
+
+//
+// largest error of the reference's output against the same sums in double,
+// over every stream of every vertex. directions are compared before they are
+// made unit length
+static double _check_reference (const Apg_Skin_Input* in,
+	const mat3x4* palette, const Apg_Skin_Output* out) {
+	double err = 0.0;
+
+	for (int v = 0; v < in->vert_count; v++) {
+		const int* ids = &in->bone_ids[(size_t)v * in->influences];
+		const float* directions[2] = {
+			&in->vns[(size_t)v * 3], &in->vtans[(size_t)v * in->vtan_comps]
+		};
+		const float* outs[2] = {
+			&out->vns[(size_t)v * 3], &out->vtans[(size_t)v * in->vtan_comps]
+		};
+		double m[12] = { 0.0 };
+
+		for (int k = 0; k < in->influences; k++) {
+			double w = in->weights ? in->weights[(size_t)v * in->influences + k] :
+				1.0;
+
+			for (int e = 0; e < 12; e++) {
+				m[e] += palette[ids[k]].m[e] * w;
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			const float* p = &in->vps[(size_t)v * 3];
+			double r = m[i * 4] * p[0] + m[i * 4 + 1] * p[1] + m[i * 4 + 2] * p[2] +
+				m[i * 4 + 3];
+			double size = fabs (m[i * 4] * p[0]) + fabs (m[i * 4 + 1] * p[1]) +
+				fabs (m[i * 4 + 2] * p[2]) + fabs (m[i * 4 + 3]);
+
+			err = fmax (err, fabs (r - out->vps[(size_t)v * 3 + i]) /
+				fmax (1.0, size));
+		}
+		for (int s = 0; s < 2; s++) {
+			const float* d = directions[s];
+			double r[3], len = 0.0, size = 0.0;
+
+			for (int i = 0; i < 3; i++) {
+				r[i] = m[i * 4] * d[0] + m[i * 4 + 1] * d[1] + m[i * 4 + 2] * d[2];
+				len += r[i] * r[i];
+				size = fmax (size, fabs (m[i * 4] * d[0]) +
+					fabs (m[i * 4 + 1] * d[1]) + fabs (m[i * 4 + 2] * d[2]));
+			}
+			len = sqrt (len);
+			for (int i = 0; i < 3; i++) {
+				err = fmax (err, fabs (r[i] - outs[s][i] * len) / fmax (1.0, size));
+			}
+		}
+		if (outs[1][3] != directions[1][3]) {
+			err = fmax (err, 1.0);
+		}
+	}
+	return err;
+}
+
+// counts values that differ and finds the largest difference
+static int _compare (const float* a, const float* b, size_t n, double* err) {
+	int diffs = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (a[i] != b[i]) {
+			diffs++;
+			*err = fmax (*err, _rel_error (a[i], b[i]));
+		}
+	}
+	return diffs;
+}
+
+int main (int argc, char** argv) {
+	Apg_Skin_Input in;
+	Apg_Skin_Output ref, out, in_place;
+	mat3x4* palette;
+	int* single_ids;
+	int* quad_ids;
+	float* quad_weights;
+	int verts = 1000000;
+	int bones = 64;
+	int reps = 5;
+	int failed = 0;
+	int a;
+
+	my_argc = argc;
+	my_argv = argv;
+	a = check_arg ("-verts");
+	if (a > -1 && a + 1 < argc) {
+		verts = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-bones");
+	if (a > -1 && a + 1 < argc) {
+		bones = atoi (argv[a + 1]);
+	}
+	a = check_arg ("-reps");
+	if (a > -1 && a + 1 < argc) {
+		reps = atoi (argv[a + 1]);
+	}
+	if (verts < 1 || bones < 1 || reps < 1) {
+		fprintf (stderr, "ERROR: bad arguments\n");
+		return 1;
+	}
+
+	memset (&in, 0, sizeof (Apg_Skin_Input));
+	in.vps = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	in.vns = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	in.vtans = (float*)malloc ((size_t)verts * 4 * sizeof (float));
+	in.vtan_comps = 4;
+	in.vert_count = verts;
+	single_ids = (int*)malloc ((size_t)verts * sizeof (int));
+	quad_ids = (int*)malloc ((size_t)verts * 4 * sizeof (int));
+	quad_weights = (float*)malloc ((size_t)verts * 4 * sizeof (float));
+	palette = (mat3x4*)malloc (bones * sizeof (mat3x4));
+	ref.vps = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	ref.vns = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	ref.vtans = (float*)malloc ((size_t)verts * 4 * sizeof (float));
+	out.vps = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	out.vns = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	out.vtans = (float*)malloc ((size_t)verts * 4 * sizeof (float));
+	in_place.vps = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	in_place.vns = (float*)malloc ((size_t)verts * 3 * sizeof (float));
+	in_place.vtans = (float*)malloc ((size_t)verts * 4 * sizeof (float));
+
+	srand (1);
+	for (int i = 0; i < bones; i++) {
+		vec3 t (bench_rand_range (-2.0f, 2.0f), bench_rand_range (0.0f, 4.0f),
+			bench_rand_range (-2.0f, 2.0f));
+		vec3 s (bench_rand_range (0.5f, 1.5f), bench_rand_range (0.5f, 1.5f),
+			bench_rand_range (0.5f, 1.5f));
+
+		palette[i] = trs_mat3x4 (t, bench_rand_versor (), s);
+	}
+	for (int v = 0; v < verts; v++) {
+		float* p = (float*)&in.vps[(size_t)v * 3];
+		float* t = (float*)&in.vtans[(size_t)v * 4];
+		float sum = 0.0f;
+
+		for (int i = 0; i < 3; i++) {
+			p[i] = bench_rand_range (-1.0f, 1.0f);
+		}
+		_rand_direction ((float*)&in.vns[(size_t)v * 3]);
+		_rand_direction (t);
+		t[3] = rand () % 2 ? 1.0f : -1.0f;
+		single_ids[v] = rand () % bones;
+		for (int k = 0; k < 4; k++) {
+			quad_ids[v * 4 + k] = rand () % bones;
+			quad_weights[v * 4 + k] = bench_rand_range (0.0f, 1.0f);
+			sum += quad_weights[v * 4 + k];
+		}
+		for (int k = 0; k < 4; k++) {
+			quad_weights[v * 4 + k] /= sum;
+		}
+	}
+	printf ("%i verts, %i bones. points, normals and 4-comp tangents\n", verts,
+		bones);
+
+	for (int influences = 1; influences <= 4; influences += 3) {
+		Apg_Skin_Output points_only;
+		Apg_Skin_Input in_place_in;
+		double scalar_ms = 1e30, simd_ms = 1e30, points_ms = 1e30;
+		double ref_err, simd_err = 0.0, in_place_err = 0.0;
+		int diffs = 0, in_place_diffs = 0;
+
+		in.influences = influences;
+		in.bone_ids = 1 == influences ? single_ids : quad_ids;
+		in.weights = 1 == influences ? NULL : quad_weights;
+		if (!apg_skin_scalar (&in, palette, bones, &ref) ||
+			!apg_skin (&in, palette, bones, &out)) {
+			return 1;
+		}
+		ref_err = _check_reference (&in, palette, &ref);
+		diffs += _compare (ref.vps, out.vps, (size_t)verts * 3, &simd_err);
+		diffs += _compare (ref.vns, out.vns, (size_t)verts * 3, &simd_err);
+		diffs += _compare (ref.vtans, out.vtans, (size_t)verts * 4, &simd_err);
+		//
+		// in place: skin a copy of the input over itself
+		memcpy (in_place.vps, in.vps, (size_t)verts * 3 * sizeof (float));
+		memcpy (in_place.vns, in.vns, (size_t)verts * 3 * sizeof (float));
+		memcpy (in_place.vtans, in.vtans, (size_t)verts * 4 * sizeof (float));
+		in_place_in = in;
+		in_place_in.vps = in_place.vps;
+		in_place_in.vns = in_place.vns;
+		in_place_in.vtans = in_place.vtans;
+		apg_skin (&in_place_in, palette, bones, &in_place);
+		in_place_diffs += _compare (out.vps, in_place.vps, (size_t)verts * 3,
+			&in_place_err);
+		in_place_diffs += _compare (out.vns, in_place.vns, (size_t)verts * 3,
+			&in_place_err);
+		in_place_diffs += _compare (out.vtans, in_place.vtans, (size_t)verts * 4,
+			&in_place_err);
+
+		memset (&points_only, 0, sizeof (Apg_Skin_Output));
+		points_only.vps = out.vps;
+		for (int r = 0; r < reps; r++) {
+			double t1 = bench_time_ms ();
+			apg_skin_scalar (&in, palette, bones, &ref);
+			double t2 = bench_time_ms ();
+			apg_skin (&in, palette, bones, &out);
+			double t3 = bench_time_ms ();
+			apg_skin (&in, palette, bones, &points_only);
+			double t4 = bench_time_ms ();
+			scalar_ms = fmin (scalar_ms, t2 - t1);
+			simd_ms = fmin (simd_ms, t3 - t2);
+			points_ms = fmin (points_ms, t4 - t3);
+		}
+
+		printf ("%i bone%s a vertex:\n", influences, 1 == influences ? "" : "s");
+		printf ("  reference error %.2g (limit %g)  simd values differing %i "
+			"(largest %.2g)  in place differing %i\n", ref_err, MAX_ERROR, diffs,
+			simd_err, in_place_diffs);
+		printf ("  all streams: scalar %7.1f  simd %7.1f M verts/s  x%.2f\n",
+			verts / scalar_ms / 1000.0, verts / simd_ms / 1000.0,
+			scalar_ms / simd_ms);
+		printf ("  points only: simd %7.1f M verts/s\n", verts / points_ms / 1000.0);
+		if (!(ref_err <= MAX_ERROR) || !(simd_err <= MAX_ERROR) ||
+			in_place_diffs > 0) {
+			fprintf (stderr, "ERROR: skinning results are wrong\n");
+			failed = 1;
+		}
+	}
+
+	free ((void*)in.vps);
+	free ((void*)in.vns);
+	free ((void*)in.vtans);
+	free (single_ids);
+	free (quad_ids);
+	free (quad_weights);
+	free (palette);
+	free (ref.vps);
+	free (ref.vns);
+	free (ref.vtans);
+	free (out.vps);
+	free (out.vns);
+	free (out.vtans);
+	free (in_place.vps);
+	free (in_place.vns);
+	free (in_place.vtans);
+	return failed;
+}
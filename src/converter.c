@@ -8,10 +8,17 @@
 //
 
 #include "mesh_loader.hpp"
+#include "apg_bin.hpp"
+#include "apg_text.hpp"
+#include "mesh_optimise.hpp"
+#include "anim_optimise.hpp"
+#include "apg_bake.hpp"
 #include <stdio.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
 #define VERSION "27DEC2014"
 
 /* TODO
@@ -23,18 +30,18 @@ root transform for anim or whole mesh? think anim
 };*/
 
 Mesh mesh;
-//Animation* animations = NULL;
 char** my_argv;
 char output_file_name[2048];
 float bounding_radius;
 int vertex_count;
+int index_count;
 int bone_count;
 int animation_count;
 int vp_comps = 3; // dimensionality. 3 is xyz, 2 is xy
 int vn_comps = 3; // dimensionality. 3 is xyz, 2 is xy
 int vt_comps = 2; // dimensionality. 2 is st
-int vb_comps = 1; // dimensionality. 1 is 1 bone per vertex
-int vw_comps = 1; // dimensionality. 1 is 1 bone per vertex
+int vb_comps = APG_BONE_INFLUENCES; // bones per vertex
+int vw_comps = APG_BONE_INFLUENCES; // a weight for each bone
 int offs_mat_comps = 16; // 4x4
 int vtan_comps = 4; // x y z det
 int my_argc;
@@ -47,194 +54,264 @@ bool has_vtan; // tangents
 bool has_vbitan; // bi-tangents
 bool has_skeleton;
 bool bin_mode; // binary write mode
+bool fetch_order; // reorder vertices into first-use order
+bool quantise; // store vertex streams quantised in binary mode
+bool reduce_keys; // remove key-frames that interpolation reproduces
+// translation and scale in model units, rotation in degrees
+Key_Tolerances key_tolerances = { 0.001f, 0.1f, 0.001f };
+// key-frames per second to resample animations to. 0 leaves keys as they are
+float resample_rate;
+// palettes per second to bake in binary mode. 0 bakes none
+float bake_rate;
+// argv index of the first -clips file, and the number of files after it
+int clips_arg;
+int clips_file_count;
 
-void count_pos_keys (Anim_Node* node, int& keys, double& duration);
-void count_sca_keys (Anim_Node* node, int& keys, double& duration);
-void count_rot_keys (Anim_Node* node, int& keys, double& duration);
-void print_hierarchy (FILE* f, Anim_Node* node, int parent_id);
-void print_tra_keys (FILE* f, Anim_Node* node);
-void print_sca_keys (FILE* f, Anim_Node* node);
-void print_rot_keys (FILE* f, Anim_Node* node);
+void print_hierarchy (Apg_Text_Writer* w);
+void print_tra_keys (Apg_Text_Writer* w, const Anim_Clip* clip);
+void print_sca_keys (Apg_Text_Writer* w, const Anim_Clip* clip);
+void print_rot_keys (Apg_Text_Writer* w, const Anim_Clip* clip);
 
-void count_pos_keys (Anim_Node* node, int& keys, double& duration) {
-	int i;
+//
+// nodes are in id order with every parent first, so this gives the same list
+// as walking the tree depth-first
+void print_hierarchy (Apg_Text_Writer* w) {
+	size_t i;
 	
-	if (node->pos_keyframes.size () > 0) {
-		double longest_t;
-		keys += (int)node->pos_keyframes.size ();
-		longest_t = node->pos_keyframes[
-			node->pos_keyframes.size () - 1].time;
-		if (longest_t > duration) {
-			duration = longest_t;
-		}
-	}
-	for (i = 0; i < node->num_children; i++) {
-		count_pos_keys (node->children[i], keys, duration);
+	for (i = 0; i < mesh.nodes.size (); i++) {
+		apg_text_str (w, "parent ");
+		apg_text_int (w, mesh.nodes[i].parent);
+		apg_text_str (w, " bone_id ");
+		apg_text_int (w, mesh.nodes[i].bone_index);
+		apg_text_char (w, '\n');
 	}
 }
 
-void count_sca_keys (Anim_Node* node, int& keys, double& duration) {
-	int i;
+//
+// writes a pos_key pool's keys channel by channel, under tag with comps 3
+static void _print_pos_keys (Apg_Text_Writer* w, const Anim_Clip* clip,
+	const char* tag, const char* key_name, const std::vector<pos_key>& pool,
+	bool scale) {
+	int comps = 3;
+	size_t n;
+	int i, j;
 	
-	if (node->scale_keyframes.size () > 0) {
-		double longest_t;
-		keys += (int)node->scale_keyframes.size ();
-		longest_t = node->scale_keyframes[
-			node->scale_keyframes.size () - 1].time;
-		if (longest_t > duration) {
-			duration = longest_t;
+	for (n = 0; n < clip->channels.size (); n++) {
+		const Anim_Channel* c = &clip->channels[n];
+		int first = scale ? c->scale_first : c->pos_first;
+		int count = scale ? c->scale_count : c->pos_count;
+		
+		if (count < 1) {
+			continue;
+		}
+		apg_text_printf (w, "@%s node %i count %i comps %i\n", tag, (int)n,
+			count, comps);
+		for (i = first; i < first + count; i++) {
+			apg_text_str (w, "t ");
+			apg_text_fixed (w, pool[i].time, 6);
+			apg_text_str (w, key_name);
+			for (j = 0; j < comps; j++) {
+				apg_text_char (w, ' ');
+				apg_text_fixed (w, pool[i].v.v[j], 6);
+			}
+			apg_text_char (w, '\n');
 		}
-	}
-	for (i = 0; i < node->num_children; i++) {
-		count_sca_keys (node->children[i], keys, duration);
 	}
 }
 
-void count_rot_keys (Anim_Node* node, int& keys, double& duration) {
-	int i;
+void print_tra_keys (Apg_Text_Writer* w, const Anim_Clip* clip) {
+	_print_pos_keys (w, clip, "tra_keys", " TRA", mesh.pos_keyframes, false);
+}
+
+void print_sca_keys (Apg_Text_Writer* w, const Anim_Clip* clip) {
+	_print_pos_keys (w, clip, "sca_keys", " SCA", mesh.scale_keyframes, true);
+}
+
+void print_rot_keys (Apg_Text_Writer* w, const Anim_Clip* clip) {
+	int comps = 4;
+	size_t n;
+	int i, j;
 	
-	if (node->pos_keyframes.size () > 0) {
-		double longest_t;
-		keys += (int)node->pos_keyframes.size ();
-		longest_t = node->pos_keyframes[
-			node->pos_keyframes.size () - 1].time;
-		if (longest_t > duration) {
-			duration = longest_t;
+	for (n = 0; n < clip->channels.size (); n++) {
+		const Anim_Channel* c = &clip->channels[n];
+		
+		if (c->rot_count < 1) {
+			continue;
+		}
+		apg_text_printf (w, "@rot_keys node %i count %i comps %i\n", (int)n,
+			c->rot_count, comps);
+		for (i = c->rot_first; i < c->rot_first + c->rot_count; i++) {
+			apg_text_str (w, "t ");
+			apg_text_fixed (w, mesh.rot_keyframes[i].time, 6);
+			apg_text_str (w, " ROT");
+			for (j = 0; j < comps; j++) {
+				apg_text_char (w, ' ');
+				apg_text_fixed (w, mesh.rot_keyframes[i].q.q[j], 6);
+			}
+			apg_text_char (w, '\n');
 		}
-	}
-	for (i = 0; i < node->num_children; i++) {
-		count_rot_keys (node->children[i], keys, duration);
 	}
 }
 
-void print_hierarchy (FILE* f, Anim_Node* node, int parent_id) {
-	int i;
+//
+// the text format reads a clip's name as one word, so spaces become '_' and
+// long names are cut to fit the loader's buffer
+void clip_word (const std::string& name, char* word) {
+	size_t i;
 	
-	if (bin_mode) {
-		fwrite (&parent_id, sizeof (int), 1, f);
-		fwrite (&node->bone_index, sizeof (int), 1, f);
-	} else {
-		fprintf (f, "parent %i bone_id %i\n", parent_id, node->bone_index);
+	for (i = 0; i < name.size () && i < MAX_ANIM_NAME_LEN - 1; i++) {
+		word[i] = isspace ((unsigned char)name[i]) ? '_' : name[i];
 	}
-	for (i = 0; i < node->num_children; i++) {
-		print_hierarchy (f, node->children[i], node->id);
+	word[i] = '\0';
+	if (0 == i) {
+		strcpy (word, "clip");
 	}
 }
 
-void print_tra_keys (FILE* f, Anim_Node* node) {
-	int comps = 3;
-	int count = 0;
-	int i;
+//
+// indices are written as 16-bit when every vertex can be addressed that way
+int index_bits () {
+	return vertex_count <= 65536 ? 16 : 32;
+}
+
+//
+// true if every per-vertex array holds vertex_count vertices
+bool streams_match () {
+	return !((has_vp && (int)mesh.vps.size () != vertex_count * vp_comps) ||
+		(has_vn && (int)mesh.vns.size () != vertex_count * vn_comps) ||
+		(has_vt && (int)mesh.vts.size () != vertex_count * vt_comps) ||
+		(has_vtan && (int)mesh.vtangents.size () != vertex_count * vtan_comps) ||
+		(has_vb && (int)mesh.vbone_ids.size () != vertex_count * vb_comps) ||
+		(has_vw && (int)mesh.vbone_weights.size () != vertex_count * vw_comps));
+}
+
+//
+// trims every per-vertex array to vertex_count after welding or reordering
+void resize_streams () {
+	mesh.vps.resize (has_vp ? vertex_count * vp_comps : 0);
+	mesh.vns.resize (has_vn ? vertex_count * vn_comps : 0);
+	mesh.vts.resize (has_vt ? vertex_count * vt_comps : 0);
+	mesh.vtangents.resize (has_vtan ? vertex_count * vtan_comps : 0);
+	mesh.vbone_ids.resize (has_vb ? vertex_count * vb_comps : 0);
+	mesh.vbone_weights.resize (has_vw ? vertex_count * vw_comps : 0);
+}
+
+//
+// points streams at each per-vertex array the mesh has. returns how many
+int vertex_streams (Vertex_Stream* streams) {
+	int stream_count = 0;
 	
-	count = (int)node->pos_keyframes.size ();
-	if (count > 0) {
-		if (bin_mode) {
-			char c = 't';
-			fwrite (&c, 1, 1, f);
-			fwrite (&node->id, sizeof (int), 1, f);
-			fwrite (&count, sizeof (int), 1, f);
-		} else {
-			fprintf (f, "@tra_keys node %i count %i comps %i\n", node->id, count, comps);
-		}
-		for (i = 0; i < count; i++) {
-			if (bin_mode) {
-				fwrite (&node->pos_keyframes[i].time, sizeof (float), 1, f);
-				fwrite (node->pos_keyframes[i].v.v, sizeof (float), 3, f);
-			} else {
-				fprintf (
-					f,
-					"t %f TRA %f %f %f\n",
-					node->pos_keyframes[i].time,
-					node->pos_keyframes[i].v.v[0],
-					node->pos_keyframes[i].v.v[1],
-					node->pos_keyframes[i].v.v[2]
-				);
-			}
-		}
+	if (has_vp) {
+		streams[stream_count].data = mesh.vps.data ();
+		streams[stream_count++].stride = vp_comps * sizeof (float);
+	}
+	if (has_vn) {
+		streams[stream_count].data = mesh.vns.data ();
+		streams[stream_count++].stride = vn_comps * sizeof (float);
+	}
+	if (has_vt) {
+		streams[stream_count].data = mesh.vts.data ();
+		streams[stream_count++].stride = vt_comps * sizeof (float);
+	}
+	if (has_vtan) {
+		streams[stream_count].data = mesh.vtangents.data ();
+		streams[stream_count++].stride = vtan_comps * sizeof (float);
+	}
+	if (has_vb) {
+		streams[stream_count].data = mesh.vbone_ids.data ();
+		streams[stream_count++].stride = vb_comps * sizeof (uint8_t);
 	}
-	for (i = 0; i < node->num_children; i++) {
-		print_tra_keys (f, node->children[i]);
+	if (has_vw) {
+		streams[stream_count].data = mesh.vbone_weights.data ();
+		streams[stream_count++].stride = vw_comps * sizeof (uint8_t);
 	}
+	return stream_count;
 }
 
-void print_sca_keys (FILE* f, Anim_Node* node) {
-	int comps = 3;
-	int count = 0;
+//
+// merges vertices that are the same in every stream and builds the index list.
+// the loader flattens faces so most vertices are repeated several times
+void weld_mesh () {
+	Vertex_Stream streams[6];
+	int stream_count = 0;
+	int welded_count = 0;
 	int i;
 	
-	count = (int)node->scale_keyframes.size ();
-	if (count > 0) {
-		if (bin_mode) {
-			char c = 't';
-			fwrite (&c, 1, 1, f);
-			fwrite (&node->id, sizeof (int), 1, f);
-			fwrite (&count, sizeof (int), 1, f);
-		} else {
-			fprintf (f, "@sca_keys node %i count %i comps %i\n", node->id, count, comps);
+	if (mesh.indices.empty ()) {
+		for (i = 0; i < vertex_count; i++) {
+			mesh.indices.push_back (i);
 		}
-		for (i = 0; i < count; i++) {
-			if (bin_mode) {
-				fwrite (&node->scale_keyframes[i].time, sizeof (float), 1, f);
-				fwrite (node->scale_keyframes[i].v.v, sizeof (float), 3, f);
-			} else {
-				fprintf (
-					f,
-					"t %f SCA %f %f %f\n",
-					node->scale_keyframes[i].time,
-					node->scale_keyframes[i].v.v[0],
-					node->scale_keyframes[i].v.v[1],
-					node->scale_keyframes[i].v.v[2]
-				);
-			}
+	}
+	index_count = (int)mesh.indices.size ();
+	if (0 == vertex_count) {
+		return;
+	}
+	//
+	// make sure is not going to keep nan due to assimp error. nans would also
+	// stop otherwise-identical vertices from welding
+	for (i = 0; i < (int)mesh.vtangents.size (); i++) {
+		if (isnan (mesh.vtangents[i])) {
+			mesh.vtangents[i] = 0.0f;
 		}
 	}
-	for (i = 0; i < node->num_children; i++) {
-		print_sca_keys (f, node->children[i]);
+	if (!streams_match ()) {
+		fprintf (stderr, "WARNING: vertex streams differ in length. not welding\n");
+		return;
 	}
+	stream_count = vertex_streams (streams);
+	welded_count = weld_vertices (streams, stream_count, vertex_count,
+		mesh.indices.data (), index_count);
+	printf ("welded %i vertices to %i (%.2fx). %i indices\n", vertex_count,
+		welded_count, (float)vertex_count / (float)welded_count, index_count);
+	vertex_count = welded_count;
+	resize_streams ();
 }
 
-void print_rot_keys (FILE* f, Anim_Node* node) {
-	int comps = 4;
-	int count = 0;
-	int i;
+//
+// reorders triangles for post-transform vertex cache reuse
+void optimise_mesh_cache () {
+	float acmr, atvr;
 	
-	count = (int)node->rot_keyframes.size ();
-	if (count > 0) {
-		if (bin_mode) {
-			char c = 'r';
-			fwrite (&c, 1, 1, f);
-			fwrite (&node->id, sizeof (int), 1, f);
-			fwrite (&count, sizeof (int), 1, f);
-		} else {
-			fprintf (f, "@rot_keys node %i count %i comps %i\n", node->id, count, comps);
-		}
-		for (i = 0; i < count; i++) {
-			if (bin_mode) {
-				fwrite (&node->pos_keyframes[i].time, sizeof (float), 1, f);
-				fwrite (node->rot_keyframes[i].q.q, sizeof (float), 4, f);
-			} else {
-				fprintf (
-					f,
-					"t %f ROT %f %f %f %f\n",
-					node->rot_keyframes[i].time,
-					node->rot_keyframes[i].q.q[0],
-					node->rot_keyframes[i].q.q[1],
-					node->rot_keyframes[i].q.q[2],
-					node->rot_keyframes[i].q.q[3]
-				);
-			}
-		}
+	if (index_count < 3 || index_count % 3 != 0) {
+		return;
 	}
+	vertex_cache_stats (mesh.indices.data (), index_count, vertex_count,
+		VERTEX_CACHE_SIM_SIZE, &acmr, &atvr);
+	printf ("vertex cache (%i) before: ACMR %.3f ATVR %.3f\n",
+		VERTEX_CACHE_SIM_SIZE, acmr, atvr);
+	optimise_vertex_cache (mesh.indices.data (), index_count, vertex_count);
+	vertex_cache_stats (mesh.indices.data (), index_count, vertex_count,
+		VERTEX_CACHE_SIM_SIZE, &acmr, &atvr);
+	printf ("vertex cache (%i) after:  ACMR %.3f ATVR %.3f\n",
+		VERTEX_CACHE_SIM_SIZE, acmr, atvr);
+}
+
+//
+// puts vertices in the order the triangles first use them
+void optimise_mesh_fetch () {
+	Vertex_Stream streams[6];
+	int stream_count = 0;
+	int before = 0, after = 0;
 	
-	for (i = 0; i < node->num_children; i++) {
-		print_rot_keys (f, node->children[i]);
+	if (0 == index_count || !streams_match ()) {
+		return;
 	}
+	stream_count = vertex_streams (streams);
+	before = vertex_fetch_stats (streams, stream_count, vertex_count,
+		mesh.indices.data (), index_count);
+	vertex_count = optimise_vertex_fetch (streams, stream_count, vertex_count,
+		mesh.indices.data (), index_count);
+	after = vertex_fetch_stats (streams, stream_count, vertex_count,
+		mesh.indices.data (), index_count);
+	printf ("vertex fetch: %i cache lines before, %i after\n", before, after);
+	resize_streams ();
 }
 
 bool write_output (const char* file_name) {
+	Apg_Text_Writer w;
 	FILE* f = NULL;
-	Anim_Node* root_node = NULL;
 	int i, j;
+	bool ok = false;
 	
 	printf ("ASCII write mode\n");
 	f = fopen (file_name, "w");
@@ -242,54 +319,60 @@ bool write_output (const char* file_name) {
 		fprintf (stderr, "ERROR: opening file %s for writing\n", file_name);
 		return false;
 	}
+	//
+	// everything is formatted into one big buffer and written in chunks
+	if (!apg_text_open (&w, f)) {
+		fclose (f);
+		return false;
+	}
 	
-	fprintf (f, "@Anton's custom mesh format v.%s http://antongerdelan.net/\n",
-		 VERSION);
-	fprintf (f, "@vert_count %i\n", vertex_count);
+	apg_text_printf (&w,
+		"@Anton's custom mesh format v.%s http://antongerdelan.net/\n", VERSION);
+	apg_text_printf (&w, "@vert_count %i\n", vertex_count);
 	if (has_vp) {
-		fprintf (f, "@vp comps %i\n", vp_comps);
+		apg_text_printf (&w, "@vp comps %i\n", vp_comps);
 		for (i = 0; i < vertex_count * vp_comps; i++) {
 			if (i % vp_comps != 0) {
-				fprintf (f, " ");
+				apg_text_char (&w, ' ');
 			}
 			//
 			// assuming units in meters - prints to the centimeter
-			fprintf (f, "%.2f", mesh.vps[i]);
+			apg_text_fixed (&w, mesh.vps[i], 2);
 			if (i % vp_comps == vp_comps - 1) {
-				fprintf (f, "\n");
+				apg_text_char (&w, '\n');
 			}
 		}
 	}
 	if (has_vn) {
-		fprintf (f, "@vn comps %i\n", vn_comps);
+		apg_text_printf (&w, "@vn comps %i\n", vn_comps);
 		for (i = 0; i < vertex_count * vn_comps; i ++) {
 			if (i % vn_comps != 0) {
-				fprintf (f, " ");
+				apg_text_char (&w, ' ');
 			}
 			//
 			// 3 s.f. - normalised later anyway
-			fprintf (f, "%.3g", mesh.vns[i]);
+			apg_text_sig (&w, mesh.vns[i], 3);
 			if (i % vn_comps == vn_comps - 1) {
-				fprintf (f, "\n");
+				apg_text_char (&w, '\n');
 			}
 		}
 	}
 	if (has_vt) {
-		fprintf (f, "@vt comps %i\n", vt_comps);
+		apg_text_printf (&w, "@vt comps %i\n", vt_comps);
 		for (i = 0; i < vertex_count * vt_comps; i ++) {
 			if (i % vt_comps != 0) {
-				fprintf (f, " ");
+				apg_text_char (&w, ' ');
 			}
 			//
 			// 3 s.f. - normalised later anyway
-			fprintf (f, "%.3g", mesh.vts[i]);
+			apg_text_sig (&w, mesh.vts[i], 3);
 			if (i % vt_comps == vt_comps - 1) {
-				fprintf (f, "\n");
+				apg_text_char (&w, '\n');
 			}
 		}
 	}
 	if (has_vtan) {
-		fprintf (f, "@vtan comps %i\n", vtan_comps);
+		apg_text_printf (&w, "@vtan comps %i\n", vtan_comps);
 		for (i = 0; i < vertex_count * vtan_comps; i ++) {
 			float ttan;
 			
@@ -301,156 +384,758 @@ bool write_output (const char* file_name) {
 			}
 			
 			if (i % vtan_comps != 0) {
-				fprintf (f, " ");
+				apg_text_char (&w, ' ');
 			}
 			//
 			// 3 s.f. - normalised later anyway
-			fprintf (f, "%.3g", ttan);
+			apg_text_sig (&w, ttan, 3);
 			if (i % vtan_comps == vtan_comps - 1) {
-				fprintf (f, "\n");
+				apg_text_char (&w, '\n');
 			}
 		}
 	}
 	if (has_vb) {
-		fprintf (f, "@vb comps %i\n", vb_comps);
-		for (i = 0; i < vertex_count; i++) {
-			fprintf (f, "%i\n", mesh.vbone_ids[i]);
+		apg_text_printf (&w, "@vb comps %i\n", vb_comps);
+		for (i = 0; i < vertex_count * vb_comps; i++) {
+			apg_text_int (&w, mesh.vbone_ids[i]);
+			apg_text_char (&w, i % vb_comps == vb_comps - 1 ? '\n' : ' ');
 		}
 	}
 	if (has_vw) {
-		fprintf (f, "@vw comps %i\n", vw_comps);
-		for (i = 0; i < vertex_count; i++) {
-			float bone_weight = 0.0f;
-			fprintf (f, "%f\n", bone_weight);
+		//
+		// the packed unorm8 weights, so both formats load the same. 6 d.p. is
+		// enough to get each 255th back
+		apg_text_printf (&w, "@vw comps %i\n", vw_comps);
+		for (i = 0; i < vertex_count * vw_comps; i++) {
+			apg_text_fixed (&w, mesh.vbone_weights[i] / 255.0f, 6);
+			apg_text_char (&w, i % vw_comps == vw_comps - 1 ? '\n' : ' ');
+		}
+	}
+	if (index_count > 0) {
+		apg_text_printf (&w, "@indices count %i bits %i\n", index_count,
+			index_bits ());
+		for (i = 0; i < index_count; i++) {
+			apg_text_int (&w, (int)mesh.indices[i]);
+			apg_text_char (&w, i % 3 == 2 || i == index_count - 1 ? '\n' : ' ');
 		}
 	}
 	if (has_skeleton) {
-		fprintf (
-			f, "@skeleton bones %i animations %i\n", bone_count, animation_count);
+		apg_text_printf (
+			&w, "@skeleton bones %i animations %i\n", bone_count, animation_count);
 		
-		fprintf (f, "@root_transform comps %i\n", offs_mat_comps);
+		apg_text_printf (&w, "@root_transform comps %i\n", offs_mat_comps);
 		for (j = 0; j < offs_mat_comps; j++) {
 			if (0 != j) {
-				fprintf (f, " ");
+				apg_text_char (&w, ' ');
 			}
-			fprintf (f, "%f", mesh.root_transform.m[j]);
+			apg_text_fixed (&w, mesh.root_transform.m[j], 6);
 		}
-		fprintf (f, "\n");
-		fprintf (f, "@offset_mat comps %i\n", offs_mat_comps);
+		apg_text_char (&w, '\n');
+		apg_text_printf (&w, "@offset_mat comps %i\n", offs_mat_comps);
 		for (i = 0; i < bone_count; i++) {
 			// column-order
 			for (j = 0; j < offs_mat_comps; j++) {
 				if (0 != j) {
-					fprintf (f, " ");
+					apg_text_char (&w, ' ');
 				}
-				fprintf (f, "%f", mesh.bone_offset_mats[i].m[j]);
+				apg_text_fixed (&w, mesh.bone_offset_mats[i].m[j], 6);
 			}
-			fprintf (f, "\n");
+			apg_text_char (&w, '\n');
 		}
 		
-		fprintf (f, "@hierarchy nodes %i\n", mesh.anim_node_count);
-		root_node = mesh.root_node;
-		print_hierarchy (f, root_node, -1);
+		apg_text_printf (&w, "@hierarchy nodes %i\n", mesh.anim_node_count);
+		print_hierarchy (&w);
 		
 		for (i = 0; i < animation_count; i++) {
-			double duration = 0.0;
-			//int tra_comps = 3;
-			int pos_keys = 0;
-			//int rot_comps = 4;
-			int rot_keys = 0;
-			
-			count_pos_keys (root_node, pos_keys, duration);
-			count_rot_keys (root_node, rot_keys, duration);
+			const Anim_Clip* clip = &mesh.clips[i];
+			char name[MAX_ANIM_NAME_LEN];
 			
-			fprintf (f, "@animation name TODO duration %f\n", duration);
-			print_tra_keys (f, root_node);
-			print_sca_keys (f, root_node);
-			print_rot_keys (f, root_node);
+			clip_word (clip->name, name);
+			apg_text_printf (&w, "@animation name %s duration %f\n", name,
+				clip->duration);
+			print_tra_keys (&w, clip);
+			print_sca_keys (&w, clip);
+			print_rot_keys (&w, clip);
 		}
 	}
 	
-	fprintf (f, "@bounding_radius %.2f", bounding_radius);
+	apg_text_printf (&w, "@bounding_radius %.2f", bounding_radius);
+	
+	ok = apg_text_close (&w);
+	if (fclose (f) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		fprintf (stderr, "ERROR: writing file %s\n", file_name);
+	}
+	return ok;
+}
+
+//
+// hierarchy as parent and bone id arrays, indexed by node id
+void gather_hierarchy (int* parents, int* bone_ids) {
+	size_t i;
+	
+	for (i = 0; i < mesh.nodes.size (); i++) {
+		parents[i] = mesh.nodes[i].parent;
+		bone_ids[i] = mesh.nodes[i].bone_index;
+	}
+}
+
+//
+// a clip's first key and count of tra, sca, and rot keys for each node
+// (APG_CHANNEL_COMPS), as ranges of the key pools
+void gather_channels (const Anim_Clip* clip, int* channels) {
+	size_t i;
+	
+	for (i = 0; i < clip->channels.size (); i++) {
+		const Anim_Channel* c = &clip->channels[i];
+		int* ch = &channels[i * APG_CHANNEL_COMPS];
 		
-	fclose (f);
+		ch[0] = c->pos_first;
+		ch[1] = c->pos_count;
+		ch[2] = c->scale_first;
+		ch[3] = c->scale_count;
+		ch[4] = c->rot_first;
+		ch[5] = c->rot_count;
+	}
+}
+
+//
+// converts the key pools to the binary key arrays, which are sized to match,
+// so every clip's channels index them as they are
+void gather_keys (float* tra, float* sca, float* rot) {
+	size_t i;
+	
+	for (i = 0; i < mesh.pos_keyframes.size (); i++) {
+		tra[i * 4] = (float)mesh.pos_keyframes[i].time;
+		memcpy (&tra[i * 4 + 1], mesh.pos_keyframes[i].v.v, 3 * sizeof (float));
+	}
+	for (i = 0; i < mesh.scale_keyframes.size (); i++) {
+		sca[i * 4] = (float)mesh.scale_keyframes[i].time;
+		memcpy (&sca[i * 4 + 1], mesh.scale_keyframes[i].v.v, 3 * sizeof (float));
+	}
+	for (i = 0; i < mesh.rot_keyframes.size (); i++) {
+		rot[i * 5] = (float)mesh.rot_keyframes[i].time;
+		memcpy (&rot[i * 5 + 1], mesh.rot_keyframes[i].q.q, 4 * sizeof (float));
+	}
+}
+
+//
+// copies the rotation keys one clip uses out of the gathered array, each
+// distinct range once, and points the clip's channels at the copy. packed key
+// times are fractions of the clip's duration so each clip packs its own
+void gather_clip_rot_keys (const float* rot, int* channels,
+	std::vector<float>* clip_rot) {
+	// where each channel's keys were in rot
+	std::vector<int> firsts (mesh.anim_node_count);
+	int i, j;
+	
+	clip_rot->clear ();
+	for (i = 0; i < (int)mesh.anim_node_count; i++) {
+		int* c = &channels[i * APG_CHANNEL_COMPS];
+		
+		firsts[i] = c[4];
+		if (c[5] < 1) {
+			c[4] = 0;
+			continue;
+		}
+		for (j = 0; j < i; j++) {
+			if (firsts[j] == firsts[i] &&
+				channels[j * APG_CHANNEL_COMPS + 5] == c[5]) {
+				break;
+			}
+		}
+		if (j < i) {
+			c[4] = channels[j * APG_CHANNEL_COMPS + 4];
+			continue;
+		}
+		c[4] = (int)clip_rot->size () / 5;
+		clip_rot->insert (clip_rot->end (), &rot[firsts[i] * 5],
+			&rot[(firsts[i] + c[5]) * 5]);
+	}
+}
+
+//
+// writes the sectioned binary container described in apg_bin.hpp
+//
+// quantised copies of the vertex streams. must outlive the binary writer
+struct Quantised_Streams {
+	Quantised_Streams ();
+	
+	std::vector<uint16_t> vps;
+	std::vector<int16_t> vns;
+	std::vector<uint16_t> vts;
+	std::vector<uint32_t> vtangents;
+	float vp_bounds[6]; // min xyz, max xyz
+	bool vp_encoded, vn_encoded, vt_encoded, vtan_encoded;
+};
+
+Quantised_Streams::Quantised_Streams () {
+	memset (vp_bounds, 0, sizeof (vp_bounds));
+	vp_encoded = vn_encoded = vt_encoded = vtan_encoded = false;
+}
+
+//
+// largest difference in any component between the original stream and the
+// section just added to the writer, once decoded the way a reader would
+float quantise_error (const Apg_Bin_Writer* w, const float* original,
+	const float* bounds) {
+	Apg_Bin_Section s = w->sections[w->section_count - 1];
+	std::vector<float> decoded;
+	float max_err = 0.0f;
+	size_t i;
+	
+	decoded.resize ((size_t)s.count * apg_bin_decoded_comps (&s));
+	// the payload is not laid out in a file yet, so decode it where it is
+	s.offset = 0;
+	if (!apg_bin_decode (w->data[w->section_count - 1], &s, bounds,
+		decoded.data ())) {
+		return INFINITY;
+	}
+	for (i = 0; i < decoded.size (); i++) {
+		float err = fabsf (decoded[i] - original[i]);
+		
+		if (err > max_err) {
+			max_err = err;
+		}
+	}
+	return max_err;
+}
+
+//
+// positions as 16-bit in the bounding box, normals octahedral, texcoords as
+// unorm16 if they are all in [0,1] or else half floats, tangents 10-10-10-2
+void add_quantised_sections (Apg_Bin_Writer* w, Quantised_Streams* q) {
+	int i, j;
+	
+	if (has_vp && 3 == vp_comps && vertex_count > 0) {
+		for (j = 0; j < 3; j++) {
+			q->vp_bounds[j] = q->vp_bounds[j + 3] = mesh.vps[j];
+		}
+		for (i = 0; i < vertex_count; i++) {
+			for (j = 0; j < 3; j++) {
+				float v = mesh.vps[i * 3 + j];
+				
+				q->vp_bounds[j] = v < q->vp_bounds[j] ? v : q->vp_bounds[j];
+				q->vp_bounds[j + 3] = v > q->vp_bounds[j + 3] ? v : q->vp_bounds[j + 3];
+			}
+		}
+		q->vps.resize (vertex_count * 3);
+		for (i = 0; i < vertex_count * 3; i++) {
+			q->vps[i] = apg_encode_aabb16 (mesh.vps[i], q->vp_bounds[i % 3],
+				q->vp_bounds[i % 3 + 3]);
+		}
+		apg_bin_add_section (w, APG_SECTION_VP_BOUNDS, APG_TYPE_F32, 6, 1, 0,
+			q->vp_bounds);
+		apg_bin_add_encoded_section (w, APG_SECTION_VP, APG_TYPE_U16, 3,
+			vertex_count, 0, APG_ENCODING_AABB16, q->vps.data ());
+		printf ("vp quantised to 16-bit in bounding box. max error %g\n",
+			quantise_error (w, &mesh.vps[0], q->vp_bounds));
+		q->vp_encoded = true;
+	}
+	if (has_vn && 3 == vn_comps) {
+		q->vns.resize (vertex_count * 2);
+		for (i = 0; i < vertex_count; i++) {
+			apg_encode_oct16 (&mesh.vns[i * 3], &q->vns[i * 2]);
+		}
+		apg_bin_add_encoded_section (w, APG_SECTION_VN, APG_TYPE_I16, 2,
+			vertex_count, 0, APG_ENCODING_OCT16, q->vns.data ());
+		printf ("vn quantised to octahedral snorm16. max error %g\n",
+			quantise_error (w, &mesh.vns[0], NULL));
+		q->vn_encoded = true;
+	}
+	if (has_vt) {
+		bool unit_range = true;
+		
+		q->vts.resize (vertex_count * vt_comps);
+		for (i = 0; i < vertex_count * vt_comps; i++) {
+			if (!(mesh.vts[i] >= 0.0f && mesh.vts[i] <= 1.0f)) {
+				unit_range = false;
+				break;
+			}
+		}
+		for (i = 0; i < vertex_count * vt_comps; i++) {
+			q->vts[i] = unit_range ? apg_encode_unorm16 (mesh.vts[i]) :
+				apg_encode_half (mesh.vts[i]);
+		}
+		apg_bin_add_encoded_section (w, APG_SECTION_VT, APG_TYPE_U16, vt_comps,
+			vertex_count, 0, unit_range ? APG_ENCODING_UNORM16 : APG_ENCODING_HALF,
+			q->vts.data ());
+		printf ("vt quantised to %s. max error %g\n",
+			unit_range ? "unorm16" : "half floats",
+			quantise_error (w, &mesh.vts[0], NULL));
+		q->vt_encoded = true;
+	}
+	if (has_vtan && 4 == vtan_comps) {
+		q->vtangents.resize (vertex_count);
+		for (i = 0; i < vertex_count; i++) {
+			q->vtangents[i] = apg_encode_10_10_10_2 (&mesh.vtangents[i * 4]);
+		}
+		apg_bin_add_encoded_section (w, APG_SECTION_VTAN, APG_TYPE_U32, 1,
+			vertex_count, 0, APG_ENCODING_10_10_10_2, q->vtangents.data ());
+		printf ("vtan quantised to 10-10-10-2. max error %g\n",
+			quantise_error (w, &mesh.vtangents[0], NULL));
+		q->vtan_encoded = true;
+	}
+}
+
+//
+// packs rotation keys, t w x y z each, as APG_ENCODING_SMALLEST3 and prints
+// the largest error. returns false, and leaves the keys to be written as
+// floats, if two keys of a channel would end up with the same time
+bool pack_rot_keys (const float* keys, int count, double duration,
+	const int* channels, std::vector<uint16_t>* packed) {
+	float max_angle = 0.0f, max_dt = 0.0f;
+	int i, j;
+	
+	packed->resize (count * 4);
+	for (i = 0; i < count; i++) {
+		const float* k = &keys[i * 5];
+		uint16_t* p = &(*packed)[i * 4];
+		float q[4], d;
+		double qk = 0.0, qq = 0.0, kk = 0.0, cos_half;
+		
+		p[0] = apg_encode_key_time (k[0], duration);
+		apg_encode_smallest3 (&k[1], &p[1]);
+		apg_decode_smallest3 (&p[1], q);
+		//
+		// in double, normalising both, as acosf () of a float dot product can't
+		// resolve the small angles involved
+		for (j = 0; j < 4; j++) {
+			qk += (double)q[j] * k[j + 1];
+			qq += (double)q[j] * q[j];
+			kk += (double)k[j + 1] * k[j + 1];
+		}
+		cos_half = fabs (qk) / sqrt (qq * kk);
+		if (cos_half < 1.0 && 2.0 * acos (cos_half) > max_angle) {
+			max_angle = (float)(2.0 * acos (cos_half));
+		}
+		d = fabsf (apg_decode_key_time (p[0], duration) - k[0]);
+		max_dt = d > max_dt ? d : max_dt;
+	}
+	for (i = 0; i < (int)mesh.anim_node_count; i++) {
+		const int* c = &channels[i * APG_CHANNEL_COMPS];
+		
+		for (j = c[4] + 1; j < c[4] + c[5]; j++) {
+			if ((*packed)[j * 4] <= (*packed)[(j - 1) * 4]) {
+				fprintf (stderr, "WARNING: rotation keys too close together to pack "
+					"times in 16 bits. writing as floats\n");
+				return false;
+			}
+		}
+	}
+	printf ("rot keys packed to smallest-three. max error %g degrees, %g s\n",
+		max_angle * ONE_RAD_IN_DEG, max_dt);
 	return true;
 }
 
 //
-// TODO
-// probably needs count before vn vp vt etc? in case of 0. or make mandatory
-// obj-like format would prob be better for points?
+// evaluates the gathered keys into a table of skinning palettes, as the viewer
+// would skin with them, and prints what the table costs in memory and accuracy
+// as floats and as 16-bit. baked gets whichever -quant asks for
+bool bake_palettes (const int* node_parents, const int* node_bone_ids,
+	const int* channels, float* tra, float* sca, float* rot, const char* name,
+	double duration, Apg_Baked_Clip* baked) {
+	std::vector<Channel> anim_channels (mesh.anim_node_count);
+	std::vector<mat3x4> offsets (bone_count);
+	Apg_Skeleton skeleton;
+	Apg_Baked_Clip table, packed_table;
+	Animation anim;
+	float error, packed_error;
+	int i;
+	
+	memset ((void*)&anim, 0, sizeof (Animation));
+	strncpy (anim.name, name, MAX_ANIM_NAME_LEN - 1);
+	anim.duration = duration;
+	anim.channels = anim_channels.data ();
+	anim.num_channels = mesh.anim_node_count;
+	for (i = 0; i < (int)mesh.anim_node_count; i++) {
+		const int* c = &channels[i * APG_CHANNEL_COMPS];
+		Channel* ch = &anim_channels[i];
+		
+		memset ((void*)ch, 0, sizeof (Channel));
+		ch->tra_keys = (TraAnimKey*)&tra[c[0] * 4];
+		ch->tra_keys_count = c[1];
+		ch->sca_keys = (ScaAnimKey*)&sca[c[2] * 4];
+		ch->sca_keys_count = c[3];
+		ch->rot_keys = (RotAnimKey*)&rot[c[4] * 5];
+		ch->rot_keys_count = c[5];
+	}
+	for (i = 0; i < bone_count; i++) {
+		offsets[i] = mat3x4_from_mat4 (mesh.bone_offset_mats[i]);
+	}
+	if (!apg_init_skeleton (node_parents, node_bone_ids, mesh.anim_node_count,
+		bone_count, &skeleton)) {
+		return false;
+	}
+	if (!apg_bake_clip (&anim, &skeleton, mat3x4_from_mat4 (mesh.root_transform),
+		offsets.data (), bone_count, bake_rate, &table)) {
+		apg_free_skeleton (&skeleton);
+		return false;
+	}
+	if (!apg_quantise_baked_clip (&table, &packed_table)) {
+		apg_free_baked_clip (&table);
+		apg_free_skeleton (&skeleton);
+		return false;
+	}
+	error = apg_baked_error (&table, &anim, &skeleton,
+		mat3x4_from_mat4 (mesh.root_transform), offsets.data (), bounding_radius,
+		4);
+	packed_error = apg_baked_error (&packed_table, &anim, &skeleton,
+		mat3x4_from_mat4 (mesh.root_transform), offsets.data (), bounding_radius,
+		4);
+	apg_free_skeleton (&skeleton);
+	if (animation_count > 1) {
+		printf ("clip %s: ", name);
+	}
+	printf ("palettes baked at %g per second: %i samples of %i bones\n",
+		bake_rate, table.sample_count, bone_count);
+	printf ("  floats %.1f KB, max error %g\n",
+		apg_baked_size (&table) / 1024.0, error);
+	printf ("  16-bit %.1f KB, max error %g\n",
+		apg_baked_size (&packed_table) / 1024.0, packed_error);
+	if (quantise) {
+		apg_free_baked_clip (&table);
+		*baked = packed_table;
+	} else {
+		apg_free_baked_clip (&packed_table);
+		*baked = table;
+	}
+	return true;
+}
+
+static void _free_baked (std::vector<Apg_Baked_Clip>& baked) {
+	size_t i;
+	
+	for (i = 0; i < baked.size (); i++) {
+		apg_free_baked_clip (&baked[i]);
+	}
+}
+
 bool write_output_bin (const char* file_name) {
+	static Apg_Bin_Writer w;
 	FILE* f = NULL;
-	Anim_Node* root_node = NULL;
-	int i, j;
-	char hdr[32];
+	std::vector<int> node_parents, node_bone_ids;
+	std::vector<float> tra_keys, sca_keys, rot_keys;
+	std::vector<uint16_t> indices_16;
+	// per clip. each section's data must outlive the writer
+	std::vector<std::vector<int> > channels;
+	std::vector<std::vector<float> > clip_rot_keys;
+	std::vector<std::vector<uint16_t> > packed_rot_keys;
+	std::vector<Apg_Baked_Clip> baked;
+	Quantised_Streams quant;
+	bool packed = false;
+	int tra_count = 0, sca_count = 0, rot_count = 0;
+	uint64_t file_size = 0;
+	int i;
 	
 	printf ("binary write mode\n");
-	f = fopen (file_name, "wb");
-	if (!f) {
-		fprintf (stderr, "ERROR: opening file %s for writing\n", file_name);
-		return false;
+	apg_bin_writer_init (&w);
+	w.header.vert_count = vertex_count;
+	w.header.bounding_radius = bounding_radius;
+	if (has_vtan) {
+		//
+		// make sure is not going to store nan due to assimp error
+		for (i = 0; i < vertex_count * vtan_comps; i++) {
+			if (isnan (mesh.vtangents[i])) {
+				mesh.vtangents[i] = 0.0f;
+			}
+		}
 	}
-	
-	//
-	// write header
-	sprintf (hdr, "BINAPGv%s", VERSION);
-	fwrite (hdr, 1, 256, f);
-	fwrite (&vertex_count, sizeof (int), 1, f);
-	for (i = 0; i < vertex_count * vp_comps; i++) {
-		fwrite (&mesh.vps[i], sizeof (float), 1, f);
+	if (quantise) {
+		add_quantised_sections (&w, &quant);
 	}
-	for (i = 0; i < vertex_count * vn_comps; i ++) {
-		fwrite (&mesh.vns[i], sizeof (float), 1, f);
+	if (has_vp && !quant.vp_encoded) {
+		apg_bin_add_section (&w, APG_SECTION_VP, APG_TYPE_F32, vp_comps,
+			vertex_count, 0, &mesh.vps[0]);
 	}
-	for (i = 0; i < vertex_count * vt_comps; i ++) {
-		fwrite (&mesh.vts[i], sizeof (float), 1, f);
+	if (has_vn && !quant.vn_encoded) {
+		apg_bin_add_section (&w, APG_SECTION_VN, APG_TYPE_F32, vn_comps,
+			vertex_count, 0, &mesh.vns[0]);
 	}
-	fwrite (&vtan_comps, sizeof (int), 1, f);
-	for (i = 0; i < vertex_count * vtan_comps; i ++) {
-		fwrite (&mesh.vtangents[i], sizeof (float), 1, f);
+	if (has_vt && !quant.vt_encoded) {
+		apg_bin_add_section (&w, APG_SECTION_VT, APG_TYPE_F32, vt_comps,
+			vertex_count, 0, &mesh.vts[0]);
 	}
-	for (i = 0; i < vertex_count; i++) {
-		fwrite (&mesh.vbone_ids[i], sizeof (int), 1, f);
+	if (has_vtan && !quant.vtan_encoded) {
+		apg_bin_add_section (&w, APG_SECTION_VTAN, APG_TYPE_F32, vtan_comps,
+			vertex_count, 0, &mesh.vtangents[0]);
 	}
-	for (i = 0; i < vertex_count; i++) {
-		float bone_weight = 0.0f;
-		fwrite (&bone_weight, sizeof (float), 1, f);
+	if (has_vb) {
+		apg_bin_add_section (&w, APG_SECTION_VB, APG_TYPE_U8, vb_comps,
+			vertex_count, 0, mesh.vbone_ids.data ());
 	}
-	fwrite (&bone_count, sizeof (int), 1, f);
-	fwrite (&animation_count, sizeof (int), 1, f);
-	fwrite (&offs_mat_comps, sizeof (int), 1, f);
-	for (j = 0; j < offs_mat_comps; j++) {
-		fwrite (&mesh.root_transform.m[j], sizeof (float), 1, f);
+	if (has_vw) {
+		apg_bin_add_encoded_section (&w, APG_SECTION_VW, APG_TYPE_U8, vw_comps,
+			vertex_count, 0, APG_ENCODING_UNORM8, mesh.vbone_weights.data ());
 	}
-	fwrite (&offs_mat_comps, sizeof (int), 1, f);
-	for (i = 0; i < bone_count; i++) {
-		// column-order
-		for (j = 0; j < offs_mat_comps; j++) {
-			fwrite (&mesh.bone_offset_mats[i].m[j], sizeof (float), 1, f);
+	if (index_count > 0) {
+		if (16 == index_bits ()) {
+			indices_16.assign (mesh.indices.begin (), mesh.indices.end ());
+			apg_bin_add_section (&w, APG_SECTION_INDICES, APG_TYPE_U16, 1,
+				index_count, 0, indices_16.data ());
+		} else {
+			apg_bin_add_section (&w, APG_SECTION_INDICES, APG_TYPE_U32, 1,
+				index_count, 0, mesh.indices.data ());
 		}
 	}
-	fwrite (&mesh.anim_node_count, sizeof (int), 1, f);
-	root_node = mesh.root_node;
-	print_hierarchy (f, root_node, -1);
-		
-	for (i = 0; i < animation_count; i++) {
-		double duration = 0.0;
-		//int tra_comps = 3;
-		int pos_keys = 0;
-		//int rot_comps = 4;
-		int rot_keys = 0;
+	if (has_skeleton) {
+		w.header.bone_count = bone_count;
+		w.header.anim_node_count = mesh.anim_node_count;
+		w.header.animation_count = animation_count;
+		apg_bin_add_section (&w, APG_SECTION_ROOT_TRANSFORM, APG_TYPE_F32,
+			offs_mat_comps, 1, 0, mesh.root_transform.m);
+		apg_bin_add_section (&w, APG_SECTION_OFFSET_MATS, APG_TYPE_F32,
+			offs_mat_comps, bone_count, 0, mesh.bone_offset_mats[0].m);
 		
-		count_pos_keys (root_node, pos_keys, duration);
-		count_rot_keys (root_node, rot_keys, duration);
+		node_parents.resize (mesh.anim_node_count);
+		node_bone_ids.resize (mesh.anim_node_count);
+		gather_hierarchy (&node_parents[0], &node_bone_ids[0]);
+		apg_bin_add_section (&w, APG_SECTION_NODE_PARENTS, APG_TYPE_I32, 1,
+			mesh.anim_node_count, 0, &node_parents[0]);
+		apg_bin_add_section (&w, APG_SECTION_NODE_BONE_IDS, APG_TYPE_I32, 1,
+			mesh.anim_node_count, 0, &node_bone_ids[0]);
 		
-		fwrite (&duration, sizeof (float), 1, f);
-		print_tra_keys (f, root_node);
-		print_sca_keys (f, root_node);
-		print_rot_keys (f, root_node);
+		//
+		// one set of key arrays for every clip at index 0. channels that are the
+		// same in several clips share keys
+		tra_count = (int)mesh.pos_keyframes.size ();
+		sca_count = (int)mesh.scale_keyframes.size ();
+		rot_count = (int)mesh.rot_keyframes.size ();
+		tra_keys.resize (tra_count * 4);
+		sca_keys.resize (sca_count * 4);
+		rot_keys.resize (rot_count * 5);
+		gather_keys (tra_keys.data (), sca_keys.data (), rot_keys.data ());
+		channels.resize (animation_count);
+		clip_rot_keys.resize (animation_count);
+		packed_rot_keys.resize (animation_count);
+		baked.resize (animation_count);
+		memset ((void*)baked.data (), 0, baked.size () * sizeof (Apg_Baked_Clip));
+		for (i = 0; i < animation_count; i++) {
+			channels[i].resize (mesh.anim_node_count * APG_CHANNEL_COMPS, 0);
+		}
+		//
+		// packed key times are fractions of a clip's duration, so with -quant each
+		// clip gets its own copy of its rotation keys. if any clip can't pack,
+		// none do
+		packed = quantise && animation_count > 0;
+		for (i = 0; i < animation_count && packed; i++) {
+			gather_channels (&mesh.clips[i], channels[i].data ());
+			gather_clip_rot_keys (rot_keys.data (), channels[i].data (),
+				&clip_rot_keys[i]);
+			packed = pack_rot_keys (clip_rot_keys[i].data (),
+				(int)clip_rot_keys[i].size () / 5, mesh.clips[i].duration,
+				channels[i].data (), &packed_rot_keys[i]);
+		}
+		for (i = 0; i < animation_count && !packed; i++) {
+			gather_channels (&mesh.clips[i], channels[i].data ());
+		}
+		for (i = 0; i < animation_count; i++) {
+			if (bake_rate > 0.0f && bone_count > 0 && !bake_palettes (
+				&node_parents[0], &node_bone_ids[0], channels[i].data (),
+				tra_keys.data (), sca_keys.data (),
+				packed ? clip_rot_keys[i].data () : rot_keys.data (),
+				mesh.clips[i].name.c_str (), mesh.clips[i].duration, &baked[i])) {
+				fprintf (stderr,
+					"WARNING: could not bake palettes. writing keys only\n");
+			}
+		}
+		for (i = 0; i < animation_count; i++) {
+			const Anim_Clip* clip = &mesh.clips[i];
+			
+			apg_bin_add_section (&w, APG_SECTION_ANIM_NAME, APG_TYPE_U8, 1,
+				clip->name.size () + 1, i, clip->name.c_str ());
+			apg_bin_add_section (&w, APG_SECTION_ANIM_DURATION, APG_TYPE_F64, 1, 1,
+				i, &clip->duration);
+			apg_bin_add_section (&w, APG_SECTION_ANIM_CHANNELS, APG_TYPE_I32,
+				APG_CHANNEL_COMPS, mesh.anim_node_count, i, channels[i].data ());
+			//
+			// the other clips use these too
+			if (0 == i) {
+				apg_bin_add_section (&w, APG_SECTION_TRA_KEYS, APG_TYPE_F32, 4,
+					tra_count, i, tra_keys.data ());
+				apg_bin_add_section (&w, APG_SECTION_SCA_KEYS, APG_TYPE_F32, 4,
+					sca_count, i, sca_keys.data ());
+			}
+			if (packed) {
+				apg_bin_add_encoded_section (&w, APG_SECTION_ROT_KEYS, APG_TYPE_U16, 4,
+					(uint32_t)packed_rot_keys[i].size () / 4, i, APG_ENCODING_SMALLEST3,
+					packed_rot_keys[i].data ());
+			} else if (0 == i) {
+				apg_bin_add_section (&w, APG_SECTION_ROT_KEYS, APG_TYPE_F32, 5,
+					rot_count, i, rot_keys.data ());
+			}
+			if (baked[i].palettes) {
+				apg_bin_add_section (&w, APG_SECTION_BAKED_PALETTES, APG_TYPE_F32,
+					APG_BAKED_COMPS, baked[i].sample_count * bone_count, i,
+					baked[i].palettes);
+			} else if (baked[i].packed) {
+				apg_bin_add_encoded_section (&w, APG_SECTION_BAKED_PALETTES,
+					APG_TYPE_U16, APG_BAKED_COMPS, baked[i].sample_count * bone_count, i,
+					APG_ENCODING_RANGE16, baked[i].packed);
+				apg_bin_add_section (&w, APG_SECTION_BAKED_RANGE, APG_TYPE_F32,
+					APG_BAKED_COMPS * 2, 1, i, baked[i].range);
+			}
+			if (baked[i].sample_count > 0) {
+				apg_bin_add_section (&w, APG_SECTION_BAKED_RATE, APG_TYPE_F32, 1, 1, i,
+					&baked[i].rate);
+			}
+		}
 	}
 	
+	//
+	// size is known exactly before anything is written. the file is assembled
+	// in one allocation and written in one go
+	file_size = apg_bin_layout (&w);
+	printf ("%u sections. %llu bytes\n", w.section_count,
+		(unsigned long long)file_size);
+	f = fopen (file_name, "wb");
+	if (!f) {
+		fprintf (stderr, "ERROR: opening file %s for writing\n", file_name);
+		_free_baked (baked);
+		return false;
+	}
+	if (!apg_bin_write (&w, f)) {
+		fprintf (stderr, "ERROR: writing file %s\n", file_name);
+		fclose (f);
+		_free_baked (baked);
+		return false;
+	}
 	fclose (f);
+	_free_baked (baked);
+	return true;
+}
+
+//
+// copies a channel's range of a key pool out for a pass to work on
+template <typename Key>
+static void _take_keys (const std::vector<Key>& pool, int first, int count,
+	std::vector<Key>& keys) {
+	keys.assign (pool.begin () + first, pool.begin () + first + count);
+}
+
+//
+// appends a channel's keys to the pool being rebuilt, returning their first
+// index
+template <typename Key>
+static int _put_keys (const std::vector<Key>& keys, std::vector<Key>& pool) {
+	int first = (int)pool.size ();
+	
+	pool.insert (pool.end (), keys.begin (), keys.end ());
+	return first;
+}
+
+//
+// runs the key pass over each clip's channels in node id order, rebuilding
+// the pools from what it leaves so they stay channel after channel. resample
+// replaces keys with keys at resample_rate over the clip's duration, otherwise
+// redundant keys are removed and each node's counts before and after are
+// printed. totals are added to before/after
+static void _rebuild_key_pools (bool resample, int* before, int* after) {
+	std::vector<pos_key> pos_pool, scale_pool, keys;
+	std::vector<rot_key> rot_pool, rkeys;
+	size_t i, j;
+	
+	pos_pool.reserve (mesh.pos_keyframes.size ());
+	scale_pool.reserve (mesh.scale_keyframes.size ());
+	rot_pool.reserve (mesh.rot_keyframes.size ());
+	for (i = 0; i < mesh.clips.size (); i++) {
+		Anim_Clip* clip = &mesh.clips[i];
+		
+		if (mesh.clips.size () > 1) {
+			printf ("  clip %s, %g seconds\n", clip->name.c_str (), clip->duration);
+		}
+		for (j = 0; j < clip->channels.size (); j++) {
+			Anim_Channel* c = &clip->channels[j];
+			int tra = c->pos_count;
+			int sca = c->scale_count;
+			int rot = c->rot_count;
+			
+			_take_keys (mesh.pos_keyframes, c->pos_first, c->pos_count, keys);
+			if (resample) {
+				resample_pos_keys (keys, resample_rate, clip->duration);
+			} else {
+				reduce_pos_keys (keys, key_tolerances.tra);
+			}
+			c->pos_first = _put_keys (keys, pos_pool);
+			c->pos_count = (int)keys.size ();
+			
+			_take_keys (mesh.scale_keyframes, c->scale_first, c->scale_count, keys);
+			if (resample) {
+				resample_pos_keys (keys, resample_rate, clip->duration);
+			} else {
+				reduce_pos_keys (keys, key_tolerances.sca);
+			}
+			c->scale_first = _put_keys (keys, scale_pool);
+			c->scale_count = (int)keys.size ();
+			
+			_take_keys (mesh.rot_keyframes, c->rot_first, c->rot_count, rkeys);
+			if (resample) {
+				resample_rot_keys (rkeys, resample_rate, clip->duration);
+			} else {
+				reduce_rot_keys (rkeys, key_tolerances.rot * (float)ONE_DEG_IN_RAD);
+			}
+			c->rot_first = _put_keys (rkeys, rot_pool);
+			c->rot_count = (int)rkeys.size ();
+			
+			if (!resample && tra + sca + rot > 0) {
+				printf ("  node %i keys: tra %i->%i sca %i->%i rot %i->%i\n", (int)j,
+					tra, c->pos_count, sca, c->scale_count, rot, c->rot_count);
+			}
+			before[0] += tra;
+			before[1] += sca;
+			before[2] += rot;
+			after[0] += c->pos_count;
+			after[1] += c->scale_count;
+			after[2] += c->rot_count;
+		}
+	}
+	mesh.pos_keyframes.swap (pos_pool);
+	mesh.scale_keyframes.swap (scale_pool);
+	mesh.rot_keyframes.swap (rot_pool);
+}
+
+void reduce_anim_keys () {
+	int before[3] = { 0, 0, 0 };
+	int after[3] = { 0, 0, 0 };
+	
+	printf ("reducing keys. tolerances: tra %g sca %g rot %g degrees\n",
+		key_tolerances.tra, key_tolerances.sca, key_tolerances.rot);
+	_rebuild_key_pools (false, before, after);
+	printf ("keys: tra %i->%i sca %i->%i rot %i->%i\n", before[0], after[0],
+		before[1], after[1], before[2], after[2]);
+}
+
+void resample_anim_keys () {
+	int before[3] = { 0, 0, 0 };
+	int after[3] = { 0, 0, 0 };
+	
+	if (1 == mesh.clips.size ()) {
+		printf ("resampling keys at %g per second over %g seconds\n",
+			resample_rate, mesh.clips[0].duration);
+	} else {
+		printf ("resampling keys at %g per second\n", resample_rate);
+	}
+	_rebuild_key_pools (true, before, after);
+	printf ("keys: tra %i->%i sca %i->%i rot %i->%i\n", before[0], after[0],
+		before[1], after[1], before[2], after[2]);
+}
+
+//
+// adds the clips of each -clips file, which should have the same skeleton
+bool read_clip_files () {
+	int i;
+	
+	for (i = clips_arg; i < clips_arg + clips_file_count; i++) {
+		// only the clips are kept, which don't depend on the coordinate system
+		Mesh from = load_mesh (my_argv[i], true);
+		
+		printf ("%u clips from %s\n", from.anim_count, my_argv[i]);
+		if (!merge_clips (&mesh, &from)) {
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -504,17 +1189,42 @@ bool read_input (const char* file_name) {
 	}
 	if (bone_count > 0) {
 		has_vb = true;
+		has_vw = true;
 		has_skeleton = true;
 	}
-	animation_count = mesh.anim_count;
-	/*animations = (Animation*)malloc (animation_count * sizeof (Animation));
-	for (int i = 0; i < animation_count; i++) {
-		if (i > 0) {
-			fprintf (stderr, "WARNING: assimp loader does not store unique duration "
-				"for each animation\n");
+	if (clips_file_count > 0) {
+		if (!has_skeleton || mesh.nodes.empty ()) {
+			fprintf (stderr, "ERROR: -clips needs %s to have a skeleton\n",
+				file_name);
+			return false;
+		}
+		if (!read_clip_files ()) {
+			return false;
 		}
-		animations[i].duration = mesh.anim_duration;
-	}*/
+	}
+	animation_count = (int)mesh.clips.size ();
+	weld_mesh ();
+	optimise_mesh_cache ();
+	if (fetch_order) {
+		optimise_mesh_fetch ();
+	}
+	if (has_skeleton && !mesh.nodes.empty ()) {
+		int shared = 0;
+		
+		if (resample_rate > 0.0f) {
+			resample_anim_keys ();
+		} else if (reduce_keys) {
+			reduce_anim_keys ();
+		}
+		//
+		// after the key passes, which give every channel its own keys again
+		shared = share_channels (&mesh);
+		if (shared > 0) {
+			printf ("%i channel key ranges shared. keys: tra %i sca %i rot %i\n",
+				shared, (int)mesh.pos_keyframes.size (),
+				(int)mesh.scale_keyframes.size (), (int)mesh.rot_keyframes.size ());
+		}
+	}
 	return true;
 }
 
@@ -538,14 +1248,25 @@ int main (int argc, char** argv) {
 	my_argc = argc;
 	my_argv = argv;
 	if (argc < 2) {
-		printf ("usage: ./conv INPUT_FILE [-o OUTPUT_FILE] [-bin]\n");
+		printf ("usage: ./conv INPUT_FILE [-o OUTPUT_FILE] [-bin] [-fetch] [-quant] [-reduce] [-resample RATE] [-bake RATE] [-clips FILE...]\n");
 		return 0;
 	}
 	if (check_arg ("-help") > -1) {
 		printf (
-			"usage: ./conv INPUT_FILE [-o OUTPUT_FILE] [-bin]\n"
+			"usage: ./conv INPUT_FILE [-o OUTPUT_FILE] [-bin] [-fetch] [-quant] [-reduce] [-resample RATE] [-bake RATE] [-clips FILE...]\n"
 			"  -o specify output file. default changes extension to .apg\n"
 			"  -bin creates binary version of .apg. default is ASCII text-based\n"
+			"  -fetch reorders vertices into the order triangles first use them\n"
+			"  -quant stores vertex streams and rotation keys quantised. binary only\n"
+			"  -reduce removes key-frames that interpolation reproduces\n"
+			"  -reduce_tol TRA ROT SCA sets -reduce tolerances. ROT in degrees\n"
+			"    default 0.001 0.1 0.001\n"
+			"  -resample RATE resamples animations to RATE key-frames per second\n"
+			"    so players can find keys without searching. overrides -reduce\n"
+			"  -bake RATE stores every bone's skinning matrix RATE times per second\n"
+			"    for playback without evaluating keys. 16-bit with -quant. binary only\n"
+			"  -clips FILE... adds the animations of each FILE, matching nodes by name\n"
+			"    so clips exported separately for the same skeleton are stored together\n"
 			"example: ./conv skull.obj -o skull.apg -bin\n"
 		);
 		return 0;
@@ -562,6 +1283,66 @@ int main (int argc, char** argv) {
 	if (check_arg ("-bin") > -1) {
 		bin_mode = true;
 	}
+	if (check_arg ("-fetch") > -1) {
+		fetch_order = true;
+	}
+	if (check_arg ("-quant") > -1) {
+		if (bin_mode) {
+			quantise = true;
+		} else {
+			fprintf (stderr, "WARNING: -quant only applies to binary output\n");
+		}
+	}
+	
+	if (check_arg ("-reduce") > -1) {
+		reduce_keys = true;
+	}
+	a = check_arg ("-reduce_tol");
+	if (a > -1) {
+		assert (argc > a + 3);
+		reduce_keys = true;
+		key_tolerances.tra = (float)atof (my_argv[a + 1]);
+		key_tolerances.rot = (float)atof (my_argv[a + 2]);
+		key_tolerances.sca = (float)atof (my_argv[a + 3]);
+	}
+	a = check_arg ("-resample");
+	if (a > -1) {
+		assert (argc > a + 1);
+		resample_rate = (float)atof (my_argv[a + 1]);
+		if (resample_rate <= 0.0f) {
+			fprintf (stderr, "ERROR: -resample rate must be above 0\n");
+			return 1;
+		}
+		if (reduce_keys) {
+			fprintf (stderr, "WARNING: -resample overrides -reduce\n");
+		}
+	}
+	a = check_arg ("-bake");
+	if (a > -1) {
+		assert (argc > a + 1);
+		bake_rate = (float)atof (my_argv[a + 1]);
+		if (bake_rate <= 0.0f) {
+			fprintf (stderr, "ERROR: -bake rate must be above 0\n");
+			return 1;
+		}
+		if (!bin_mode) {
+			fprintf (stderr, "WARNING: -bake only applies to binary output\n");
+			bake_rate = 0.0f;
+		}
+	}
+	
+	a = check_arg ("-clips");
+	if (a > -1) {
+		clips_arg = a + 1;
+		while (clips_arg + clips_file_count < argc &&
+			'-' != my_argv[clips_arg + clips_file_count][0]) {
+			clips_file_count++;
+		}
+		if (clips_file_count < 1) {
+			fprintf (stderr, "ERROR: -clips needs at least one file\n");
+			return 1;
+		}
+	}
 	
 	printf ("converting %s to %s\n", argv[1], output_file_name);
 	
@@ -571,9 +1352,5 @@ int main (int argc, char** argv) {
 	} else {
 		assert (write_output (output_file_name));
 	}
-	/*if (animations) {
-		free (animations);
-		animations = NULL;
-	}*/
 	return 0;
 }
@@ -0,0 +1,264 @@
+//
+// Bulk extraction of vertex attributes from importer meshes
+// First version 17 Oct 2026
+// see mesh_extract.hpp
+//
+
+#include "mesh_extract.hpp"
+#include "maths_funcs.hpp"
+#include <string.h>
+
+//
+// the arrays to read and write, with an attribute's pointers all set or all
+// NULL so each range checks a pointer and not both
+struct Extract_Job {
+	const float* vertices;
+	const float* normals;
+	const float* texcoords;
+	const float* tangents;
+	const float* bitangents;
+	float* vps;
+	float* vns;
+	float* vts;
+	float* vtangents;
+	bool correct_coords;
+};
+
+static void _init_job (const Extract_Input* in, bool correct_coords,
+	const Extract_Output* out, Extract_Job* job) {
+	memset (job, 0, sizeof (Extract_Job));
+	job->correct_coords = correct_coords;
+	if (in->vertices && out->vps) {
+		job->vertices = in->vertices;
+		job->vps = out->vps;
+	}
+	if (in->texcoords && out->vts) {
+		job->texcoords = in->texcoords;
+		job->vts = out->vts;
+	}
+	if (in->normals && out->vns) {
+		job->vns = out->vns;
+	}
+	if (in->tangents && in->bitangents && in->normals && out->vtangents) {
+		job->tangents = in->tangents;
+		job->bitangents = in->bitangents;
+		job->vtangents = out->vtangents;
+	}
+	if (job->vns || job->vtangents) {
+		job->normals = in->normals;
+	}
+}
+
+static inline void _extract_vec3 (const float* in, bool correct_coords,
+	float* out) {
+	out[0] = in[0];
+	out[1] = correct_coords ? in[2] : in[1];
+	out[2] = correct_coords ? -in[1] : in[2];
+}
+
+static inline void _extract_tangent (const float* tp, const float* bp,
+	const float* np, float* out) {
+	vec3 t (tp[0], tp[1], tp[2]);
+	vec3 b (bp[0], bp[1], bp[2]);
+	vec3 n (np[0], np[1], np[2]);
+
+	// orthogonalise and normalise the tangent so we can use it in something
+	// approximating a T,N,B inverse matrix
+	vec3 t_i = normalise (t - n * dot (n, t));
+
+	// get determinant of T,B,N 3x3 matrix by dot*cross method
+	float det = dot (cross (n, t), b);
+
+	out[0] = t_i.v[0];
+	out[1] = t_i.v[1];
+	out[2] = t_i.v[2];
+	out[3] = det < 0.0f ? -1.0f : 1.0f;
+}
+
+//
+// every attribute of a vertex before the next, as the old loader loop did, so
+// the sqrt and divides of the tangents overlap the copying. separate passes
+// were slower without SIMD to make up for reading normals twice
+static void _extract_range_scalar (void* user, int first, int last,
+	int worker) {
+	const Extract_Job* job = (const Extract_Job*)user;
+	int i;
+
+	(void)worker;
+	for (i = first; i < last; i++) {
+		if (job->vps) {
+			_extract_vec3 (&job->vertices[i * 3], job->correct_coords,
+				&job->vps[i * 3]);
+		}
+		if (job->vns) {
+			_extract_vec3 (&job->normals[i * 3], job->correct_coords,
+				&job->vns[i * 3]);
+		}
+		if (job->vts) {
+			job->vts[i * 2] = job->texcoords[i * 3];
+			job->vts[i * 2 + 1] = job->texcoords[i * 3 + 1];
+		}
+		if (job->vtangents) {
+			_extract_tangent (&job->tangents[i * 3], &job->bitangents[i * 3],
+				&job->normals[i * 3], &job->vtangents[i * 4]);
+		}
+	}
+}
+
+#ifdef MATHS_SIMD
+//
+// 4 vertices are 3 registers: x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3. each is
+// shuffled into x z y order and has its y lanes negated
+static inline void _store_vec3s (__m128 a, __m128 b, __m128 c,
+	bool correct_coords, float* out) {
+	const __m128 neg_2 = _mm_set_ps (0.0f, -0.0f, 0.0f, 0.0f);
+	const __m128 neg_1 = _mm_set_ps (0.0f, 0.0f, -0.0f, 0.0f);
+	const __m128 neg_03 = _mm_set_ps (-0.0f, 0.0f, 0.0f, -0.0f);
+
+	if (!correct_coords) {
+		_mm_storeu_ps (out, a);
+		_mm_storeu_ps (out + 4, b);
+		_mm_storeu_ps (out + 8, c);
+		return;
+	}
+	__m128 t1 = _mm_shuffle_ps (b, c, _MM_SHUFFLE (0, 0, 2, 2));
+	__m128 t2 = _mm_shuffle_ps (b, c, _MM_SHUFFLE (1, 1, 3, 3));
+	// x0 z0 y0 x1, z1 y1 x2 z2, y2 x3 z3 y3
+	__m128 o0 = _mm_shuffle_ps (a, a, _MM_SHUFFLE (3, 1, 2, 0));
+	__m128 o1 = _mm_shuffle_ps (b, t1, _MM_SHUFFLE (2, 0, 0, 1));
+	__m128 o2 = _mm_shuffle_ps (t2, c, _MM_SHUFFLE (2, 3, 2, 0));
+
+	_mm_storeu_ps (out, _mm_xor_ps (o0, neg_2));
+	_mm_storeu_ps (out + 4, _mm_xor_ps (o1, neg_1));
+	_mm_storeu_ps (out + 8, _mm_xor_ps (o2, neg_03));
+}
+
+// 4 vertices' x, y and z in a register each, from the 3 registers above
+static inline void _to_soa (__m128 a, __m128 b, __m128 c, __m128* x,
+	__m128* y, __m128* z) {
+	*x = _mm_shuffle_ps (a, _mm_shuffle_ps (b, c, _MM_SHUFFLE (1, 1, 2, 2)),
+		_MM_SHUFFLE (2, 0, 3, 0));
+	*y = _mm_shuffle_ps (_mm_shuffle_ps (a, b, _MM_SHUFFLE (0, 0, 1, 1)),
+		_mm_shuffle_ps (b, c, _MM_SHUFFLE (2, 2, 3, 3)), _MM_SHUFFLE (2, 0, 2, 0));
+	*z = _mm_shuffle_ps (_mm_shuffle_ps (a, b, _MM_SHUFFLE (1, 1, 2, 2)),
+		_mm_shuffle_ps (c, c, _MM_SHUFFLE (3, 3, 0, 0)), _MM_SHUFFLE (2, 0, 2, 0));
+}
+
+static inline void _load_soa (const float* in, __m128* x, __m128* y,
+	__m128* z) {
+	_to_soa (_mm_loadu_ps (in), _mm_loadu_ps (in + 4), _mm_loadu_ps (in + 8), x,
+		y, z);
+}
+
+//
+// 4 tangents, one in each lane, with the scalar version's sums in the same
+// order so the results match it bit for bit
+static inline void _extract_tangents (const float* tp, const float* bp,
+	__m128 nx, __m128 ny, __m128 nz, float* out) {
+	const __m128 zero = _mm_setzero_ps ();
+	const __m128 one = _mm_set1_ps (1.0f);
+	const __m128 minus_one = _mm_set1_ps (-1.0f);
+	__m128 tx, ty, tz, bx, by, bz;
+
+	_load_soa (tp, &tx, &ty, &tz);
+	_load_soa (bp, &bx, &by, &bz);
+	__m128 d = _mm_add_ps (_mm_add_ps (_mm_mul_ps (nx, tx),
+		_mm_mul_ps (ny, ty)), _mm_mul_ps (nz, tz));
+	__m128 ox = _mm_sub_ps (tx, _mm_mul_ps (nx, d));
+	__m128 oy = _mm_sub_ps (ty, _mm_mul_ps (ny, d));
+	__m128 oz = _mm_sub_ps (tz, _mm_mul_ps (nz, d));
+	__m128 l = _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (ox, ox),
+		_mm_mul_ps (oy, oy)), _mm_mul_ps (oz, oz)));
+	// a zero-length tangent stays zero rather than 0 / 0
+	__m128 nonzero = _mm_cmpneq_ps (l, zero);
+	__m128 cx = _mm_sub_ps (_mm_mul_ps (ny, tz), _mm_mul_ps (nz, ty));
+	__m128 cy = _mm_sub_ps (_mm_mul_ps (nz, tx), _mm_mul_ps (nx, tz));
+	__m128 cz = _mm_sub_ps (_mm_mul_ps (nx, ty), _mm_mul_ps (ny, tx));
+	__m128 det = _mm_add_ps (_mm_add_ps (_mm_mul_ps (cx, bx),
+		_mm_mul_ps (cy, by)), _mm_mul_ps (cz, bz));
+	__m128 negative = _mm_cmplt_ps (det, zero);
+	__m128 r0 = _mm_and_ps (_mm_div_ps (ox, l), nonzero);
+	__m128 r1 = _mm_and_ps (_mm_div_ps (oy, l), nonzero);
+	__m128 r2 = _mm_and_ps (_mm_div_ps (oz, l), nonzero);
+	__m128 r3 = _mm_or_ps (_mm_and_ps (negative, minus_one),
+		_mm_andnot_ps (negative, one));
+
+	_MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+	_mm_storeu_ps (out, r0);
+	_mm_storeu_ps (out + 4, r1);
+	_mm_storeu_ps (out + 8, r2);
+	_mm_storeu_ps (out + 12, r3);
+}
+
+//
+// 4 vertices at a time, every attribute before the next 4. normals are loaded
+// once for both their own stream and the tangents
+static void _extract_range (void* user, int first, int last, int worker) {
+	const Extract_Job* job = (const Extract_Job*)user;
+	int i = first;
+
+	for (; i + 4 <= last; i += 4) {
+		if (job->vps) {
+			const float* in = &job->vertices[i * 3];
+
+			_store_vec3s (_mm_loadu_ps (in), _mm_loadu_ps (in + 4),
+				_mm_loadu_ps (in + 8), job->correct_coords, &job->vps[i * 3]);
+		}
+		if (job->normals) {
+			const float* in = &job->normals[i * 3];
+			__m128 a = _mm_loadu_ps (in);
+			__m128 b = _mm_loadu_ps (in + 4);
+			__m128 c = _mm_loadu_ps (in + 8);
+
+			if (job->vns) {
+				_store_vec3s (a, b, c, job->correct_coords, &job->vns[i * 3]);
+			}
+			if (job->vtangents) {
+				__m128 nx, ny, nz;
+
+				_to_soa (a, b, c, &nx, &ny, &nz);
+				_extract_tangents (&job->tangents[i * 3], &job->bitangents[i * 3],
+					nx, ny, nz, &job->vtangents[i * 4]);
+			}
+		}
+		if (job->vts) {
+			const float* in = &job->texcoords[i * 3];
+			__m128 a = _mm_loadu_ps (in);
+			__m128 b = _mm_loadu_ps (in + 4);
+			__m128 c = _mm_loadu_ps (in + 8);
+			__m128 t = _mm_shuffle_ps (a, b, _MM_SHUFFLE (0, 0, 3, 3));
+
+			// s0 t0 s1 t1, s2 t2 s3 t3
+			_mm_storeu_ps (&job->vts[i * 2], _mm_shuffle_ps (a, t,
+				_MM_SHUFFLE (2, 0, 1, 0)));
+			_mm_storeu_ps (&job->vts[i * 2 + 4], _mm_shuffle_ps (b, c,
+				_MM_SHUFFLE (2, 1, 3, 2)));
+		}
+	}
+	_extract_range_scalar (user, i, last, worker);
+}
+#else
+static void _extract_range (void* user, int first, int last, int worker) {
+	_extract_range_scalar (user, first, last, worker);
+}
+#endif
+
+void extract_streams (const Extract_Input* in, int count, bool correct_coords,
+	Apg_Pool* pool, Extract_Output* out) {
+	Extract_Job job;
+
+	_init_job (in, correct_coords, out, &job);
+	if (!pool || pool->thread_count < 2 || count <= EXTRACT_CHUNK) {
+		_extract_range (&job, 0, count, 0);
+		return;
+	}
+	apg_pool_run (pool, count, EXTRACT_CHUNK, _extract_range, &job);
+}
+
+void extract_streams_scalar (const Extract_Input* in, int count,
+	bool correct_coords, Extract_Output* out) {
+	Extract_Job job;
+
+	_init_job (in, correct_coords, out, &job);
+	_extract_range_scalar (&job, 0, count, 0);
+}
@@ -8,36 +8,15 @@
 //
 
 #include "mesh_loader.hpp"
+#include "mesh_extract.hpp"
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
-
-Anim_Node::Anim_Node () {
-	int i;
-	
-	num_children = 0;
-	bone_index = -1;
-	has_bone = false;
-	for (i = 0; i < MAX_CHILDREN; i++) {
-		children[i] = NULL;
-	}
-}
-
-Anim_Node_Name_Map::Anim_Node_Name_Map () {
-	anim_node_ptr = NULL;
-}
+#include <string.h>
 
 Mesh::Mesh () {
-	int i;
-	
 	root_transform = identity_mat4 ();
-	for (i = 0; i < MAX_BONES; i++) {
-		bone_offset_mats[i] = identity_mat4 ();
-		current_bone_transforms[i] = identity_mat4 ();
-	}
-	root_node = NULL;
-	anim_duration = 0.0;
 	point_count = 0;
 	bone_count = 0;
 	anim_count = 0;
@@ -54,72 +33,426 @@ mat4 convert_assimp_matrix (aiMatrix4x4 m) {
 	);
 }
 
-bool get_bone_index_for_name (const Mesh& mesh, const aiString& name,
-	int& index) {
-	unsigned int i;
+//
+// FNV-1a
+static uint32_t _hash_name (const char* str, uint32_t len) {
+	uint32_t hash = 2166136261u;
+	uint32_t i;
 	
-	for (i = 0; i < mesh.bone_names.size (); i++) {
-		if (name == mesh.bone_names[i]) {
-			index = i;
-			return true;
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//
+// the slot holding the name, or else the free slot it would go in. there is
+// always a free slot as the table is kept at most half full
+static uint32_t _find_slot (const Name_Table* table, const char* str,
+	uint32_t len, uint32_t hash) {
+	uint32_t mask = (uint32_t)table->slots.size () - 1;
+	uint32_t slot = hash & mask;
+	
+	for (;;) {
+		int id = table->slots[slot];
+		
+		if (id < 0 || (table->hashes[id] == hash && table->lengths[id] == len &&
+			memcmp (&table->chars[table->offsets[id]], str, len) == 0)) {
+			return slot;
 		}
+		slot = (slot + 1) & mask;
 	}
-	index = -1;
-	return false;
 }
 
-bool initialise_node_and_children (Mesh& mesh, Anim_Node* my_node,
-	aiNode* ass_node) {
-	Anim_Node_Name_Map map;
+static void _grow_name_table (Name_Table* table) {
+	size_t size = table->slots.size () < 64 ? 64 : table->slots.size () * 2;
+	uint32_t mask = (uint32_t)size - 1;
+	size_t id;
+	
+	table->slots.assign (size, -1);
+	for (id = 0; id < table->hashes.size (); id++) {
+		uint32_t slot = table->hashes[id] & mask;
+		
+		while (table->slots[slot] > -1) {
+			slot = (slot + 1) & mask;
+		}
+		table->slots[slot] = (int)id;
+	}
+}
+
+int intern_name (Name_Table* table, const char* str, uint32_t len) {
+	uint32_t hash = _hash_name (str, len);
+	uint32_t slot = 0;
+	int id = -1;
+	
+	if ((table->hashes.size () + 1) * 2 > table->slots.size ()) {
+		_grow_name_table (table);
+	}
+	slot = _find_slot (table, str, len, hash);
+	if (table->slots[slot] > -1) {
+		return table->slots[slot];
+	}
+	id = (int)table->hashes.size ();
+	table->offsets.push_back ((uint32_t)table->chars.size ());
+	table->lengths.push_back (len);
+	table->hashes.push_back (hash);
+	table->chars.insert (table->chars.end (), str, str + len);
+	table->chars.push_back ('\0');
+	table->slots[slot] = id;
+	return id;
+}
+
+int find_name (const Name_Table* table, const char* str, uint32_t len) {
+	if (table->slots.empty ()) {
+		return -1;
+	}
+	return table->slots[_find_slot (table, str, len, _hash_name (str, len))];
+}
+
+//
+// interns an assimp name into the mesh's table, growing the per-name arrays
+// to match
+static int _intern_ai_name (Mesh& mesh, const aiString& name) {
+	int id = intern_name (&mesh.names, name.data, (uint32_t)name.length);
+	
+	if ((size_t)id >= mesh.name_bones.size ()) {
+		mesh.name_bones.resize (id + 1, -1);
+		mesh.name_nodes.resize (id + 1, -1);
+	}
+	return id;
+}
+
+//
+// lays the node tree out depth-first, numbered as a recursive walk would, but
+// with a stack of nodes still to visit. the tree is counted first so the node
+// array is allocated once. each node's children go together in node_children,
+// in assimp's order
+static void _build_node_tree (Mesh& mesh, const aiNode* ass_root) {
+	std::vector<const aiNode*> stack;
+	std::vector<int> stack_parents;
+	int count = 0;
+	int first = 0;
 	int i;
+	
+	if (!ass_root) {
+		return;
+	}
+	stack.push_back (ass_root);
+	while (!stack.empty ()) {
+		const aiNode* ass_node = stack.back ();
+		
+		stack.pop_back ();
+		count++;
+		for (i = 0; i < (int)ass_node->mNumChildren; i++) {
+			stack.push_back (ass_node->mChildren[i]);
+		}
+	}
+	mesh.nodes.resize (count);
+	mesh.node_children.resize (count - 1);
+	
+	stack.push_back (ass_root);
+	stack_parents.push_back (-1);
+	while (!stack.empty ()) {
+		const aiNode* ass_node = stack.back ();
+		int parent = stack_parents.back ();
+		int id = (int)mesh.anim_node_count++;
+		Anim_Node* node = &mesh.nodes[id];
+		int name_id = -1;
+		
+		stack.pop_back ();
+		stack_parents.pop_back ();
+		// work out if a bone is directly controlled by this node, and note the
+		// node under its name for binding animation channels later. the first
+		// node of a name keeps it
+		name_id = _intern_ai_name (mesh, ass_node->mName);
+		if (mesh.name_nodes[name_id] < 0) {
+			mesh.name_nodes[name_id] = id;
+		}
+		memset (node, 0, sizeof (Anim_Node));
+		node->id = id;
+		node->name = name_id;
+		node->parent = parent;
+		node->num_children = (int)ass_node->mNumChildren;
+		node->bone_index = mesh.name_bones[name_id];
+		node->has_bone = node->bone_index > -1;
+		// last child first, so the first is visited next
+		for (i = node->num_children - 1; i >= 0; i--) {
+			stack.push_back (ass_node->mChildren[i]);
+			stack_parents.push_back (id);
+		}
+	}
+	
+	//
+	// every node comes after its parent, so going through in id order adds
+	// each parent's children in the order they were visited
+	for (i = 0; i < count; i++) {
+		mesh.nodes[i].first_child = first;
+		first += mesh.nodes[i].num_children;
+		mesh.nodes[i].num_children = 0;
+	}
+	for (i = 1; i < count; i++) {
+		Anim_Node* p = &mesh.nodes[mesh.nodes[i].parent];
+		
+		mesh.node_children[p->first_child + p->num_children++] = i;
+	}
+}
+
+//
+// stretches a clip's duration to the last key of a channel
+template <typename Key>
+static void _extend_duration (const std::vector<Key>& pool, int first,
+	int count, double* duration) {
+	if (count > 0 && pool[first + count - 1].time > *duration) {
+		*duration = pool[first + count - 1].time;
+	}
+}
 
-	assert (my_node != NULL);
-	// get name and work out if a bone is directly controlled by this node
-	aiString ass_name = ass_node->mName;
+//
+// copies every animation into a clip with its name and duration, and its keys
+// into the mesh's pools. keys are counted per channel first, so each pool is
+// allocated once and holds the keys clip after clip, node after node
+static void _copy_anim_clips (Mesh& mesh, const aiScene* scene) {
+	// node id of each channel of each animation in turn, or -1
+	std::vector<int> channel_nodes;
+	int pos_total = 0, scale_total = 0, rot_total = 0;
+	int ch = 0;
 	
-	// make entry in name ptr map for later
-	map.ass_name = ass_name;
-	map.anim_node_ptr = my_node;
-	mesh.node_name_map.push_back (map);
+	mesh.clips.resize (scene->mNumAnimations);
+	for (unsigned int a_i = 0; a_i < scene->mNumAnimations; a_i++) {
+		const aiAnimation* anim = scene->mAnimations[a_i];
+		Anim_Clip* clip = &mesh.clips[a_i];
+		
+		if (anim->mName.length > 0) {
+			clip->name = anim->mName.data;
+		} else {
+			clip->name = "clip" + std::to_string (a_i);
+		}
+		clip->duration = 0.0;
+		clip->channels.resize (mesh.nodes.size ());
+		memset (clip->channels.data (), 0,
+			clip->channels.size () * sizeof (Anim_Channel));
+		for (unsigned int c_i = 0; c_i < anim->mNumChannels; c_i++) {
+			const aiNodeAnim* ass_node_anim = anim->mChannels[c_i];
+			const aiString& name = ass_node_anim->mNodeName;
+			int name_id = find_name (&mesh.names, name.data, (uint32_t)name.length);
+			int id = name_id > -1 ? mesh.name_nodes[name_id] : -1;
+			
+			channel_nodes.push_back (id);
+			if (id < 0) {
+				fprintf (stderr, "WARNING: no node named %s for animation channel\n",
+					name.data);
+				continue;
+			}
+			clip->channels[id].pos_count += (int)ass_node_anim->mNumPositionKeys;
+			clip->channels[id].scale_count += (int)ass_node_anim->mNumScalingKeys;
+			clip->channels[id].rot_count += (int)ass_node_anim->mNumRotationKeys;
+		}
+		for (size_t i = 0; i < clip->channels.size (); i++) {
+			Anim_Channel* c = &clip->channels[i];
+			
+			c->pos_first = pos_total;
+			c->scale_first = scale_total;
+			c->rot_first = rot_total;
+			pos_total += c->pos_count;
+			scale_total += c->scale_count;
+			rot_total += c->rot_count;
+			// counted up again as the keys are copied in
+			c->pos_count = 0;
+			c->scale_count = 0;
+			c->rot_count = 0;
+		}
+	}
+	mesh.pos_keyframes.resize (pos_total);
+	mesh.scale_keyframes.resize (scale_total);
+	mesh.rot_keyframes.resize (rot_total);
 	
-	int index = -1;
-	my_node->has_bone = get_bone_index_for_name (mesh, ass_name, index);
-	my_node->id = mesh.anim_node_count++;
-	my_node->bone_index = index;
-	my_node->num_children = ass_node->mNumChildren;
-	if (my_node->num_children >= MAX_CHILDREN) {
-		fprintf (stderr, "ERROR: too many children for bone. max %i\n",
-			MAX_CHILDREN);
+	for (unsigned int a_i = 0; a_i < scene->mNumAnimations; a_i++) {
+		const aiAnimation* anim = scene->mAnimations[a_i];
+		Anim_Clip* clip = &mesh.clips[a_i];
+		// assimp gives 0 if the file does not say
+		double ticks = anim->mTicksPerSecond > 0.0 ? anim->mTicksPerSecond : 25.0;
+		
+		for (unsigned int c_i = 0; c_i < anim->mNumChannels; c_i++) {
+			const aiNodeAnim* ass_node_anim = anim->mChannels[c_i];
+			int id = channel_nodes[ch++];
+			Anim_Channel* c = NULL;
+			
+			if (id < 0) {
+				continue;
+			}
+			c = &clip->channels[id];
+			// add position keyframes
+			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumPositionKeys;
+				p_i++) {
+				aiVectorKey vk = ass_node_anim->mPositionKeys[p_i];
+				pos_key& pkf = mesh.pos_keyframes[c->pos_first + c->pos_count++];
+				pkf.time = vk.mTime / ticks;
+				aiVector3D vector = vk.mValue;
+				pkf.v = vec3 (vector.x, vector.y, vector.z);
+			}
+			// add scale keyframes
+			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumScalingKeys; p_i++) {
+				aiVectorKey vk = ass_node_anim->mScalingKeys[p_i];
+				pos_key& pkf = mesh.scale_keyframes[c->scale_first + c->scale_count++];
+				pkf.time = vk.mTime / ticks;
+				aiVector3D vector = vk.mValue;
+				pkf.v = vec3 (vector.x, vector.y, vector.z);
+			}
+			// add rotation keyframes
+			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumRotationKeys;
+				p_i++) {
+				aiQuatKey qk = ass_node_anim->mRotationKeys[p_i];
+				rot_key& rkf = mesh.rot_keyframes[c->rot_first + c->rot_count++];
+				rkf.time = qk.mTime / ticks;
+				aiQuaternion versor = qk.mValue;
+				rkf.q.q[0] = versor.w;
+				rkf.q.q[1] = versor.x;
+				rkf.q.q[2] = versor.y;
+				rkf.q.q[3] = versor.z;
+				rkf.q = normalise (rkf.q);
+			}
+		} // end of channels loop
+		
+		//
+		// the longer of what the file says and the last key, so no key is cut off
+		clip->duration = anim->mDuration / ticks;
+		for (size_t i = 0; i < clip->channels.size (); i++) {
+			const Anim_Channel* c = &clip->channels[i];
+			
+			_extend_duration (mesh.pos_keyframes, c->pos_first, c->pos_count,
+				&clip->duration);
+			_extend_duration (mesh.scale_keyframes, c->scale_first, c->scale_count,
+				&clip->duration);
+			_extend_duration (mesh.rot_keyframes, c->rot_first, c->rot_count,
+				&clip->duration);
+		}
+	} // end of animations loop
+}
+
+//
+// appends count keys of from's pool starting at first to pool, returning
+// where they start
+template <typename Key>
+static int _append_keys (const std::vector<Key>& from, int first, int count,
+	std::vector<Key>& pool) {
+	int at = (int)pool.size ();
+	
+	pool.insert (pool.end (), from.begin () + first,
+		from.begin () + first + count);
+	return at;
+}
+
+bool merge_clips (Mesh* mesh, const Mesh* from) {
+	// mesh's node id for each of from's nodes, or -1
+	std::vector<int> node_map (from->nodes.size (), -1);
+	int matched = 0, dropped = 0;
+	size_t i, j;
+	
+	for (i = 0; i < from->nodes.size (); i++) {
+		const Anim_Node* node = &from->nodes[i];
+		const char* name = &from->names.chars[from->names.offsets[node->name]];
+		int name_id = find_name (&mesh->names, name,
+			from->names.lengths[node->name]);
+		
+		node_map[i] = name_id > -1 ? mesh->name_nodes[name_id] : -1;
+		if (node_map[i] > -1 && node->parent > -1 &&
+			mesh->nodes[node_map[i]].parent != node_map[node->parent]) {
+			fprintf (stderr, "WARNING: node %s has a different parent in %s\n", name,
+				from->file_name.c_str ());
+		}
+	}
+	for (i = 0; i < from->clips.size (); i++) {
+		for (j = 0; j < from->clips[i].channels.size (); j++) {
+			const Anim_Channel* c = &from->clips[i].channels[j];
+			
+			if (c->pos_count + c->scale_count + c->rot_count < 1) {
+				continue;
+			}
+			if (node_map[j] > -1) {
+				matched++;
+			} else {
+				dropped++;
+			}
+		}
+	}
+	if (matched < 1) {
+		fprintf (stderr, "ERROR: no animated node of %s is in %s\n",
+			from->file_name.c_str (), mesh->file_name.c_str ());
 		return false;
 	}
+	if (dropped > 0) {
+		fprintf (stderr, "WARNING: %i channels of %s are for nodes not in %s\n",
+			dropped, from->file_name.c_str (), mesh->file_name.c_str ());
+	}
 	
-	// recurse to children
-	for (i = 0; i < my_node->num_children; i++) {
-		my_node->children[i] = new Anim_Node;
-		assert (my_node->children[i] != NULL);
-		if (!initialise_node_and_children (mesh, my_node->children[i],
-			ass_node->mChildren[i])) {
-			fprintf (stderr, "ERROR: creating child of anim node\n");
-			return false;
+	for (i = 0; i < from->clips.size (); i++) {
+		const Anim_Clip* src = &from->clips[i];
+		Anim_Clip clip;
+		
+		clip.name = src->name;
+		clip.duration = src->duration;
+		clip.channels.resize (mesh->nodes.size ());
+		memset (clip.channels.data (), 0,
+			clip.channels.size () * sizeof (Anim_Channel));
+		for (j = 0; j < src->channels.size (); j++) {
+			const Anim_Channel* c = &src->channels[j];
+			Anim_Channel* d = NULL;
+			
+			if (node_map[j] < 0 || c->pos_count + c->scale_count + c->rot_count < 1) {
+				continue;
+			}
+			d = &clip.channels[node_map[j]];
+			d->pos_count = c->pos_count;
+			d->pos_first = _append_keys (from->pos_keyframes, c->pos_first,
+				c->pos_count, mesh->pos_keyframes);
+			d->scale_count = c->scale_count;
+			d->scale_first = _append_keys (from->scale_keyframes, c->scale_first,
+				c->scale_count, mesh->scale_keyframes);
+			d->rot_count = c->rot_count;
+			d->rot_first = _append_keys (from->rot_keyframes, c->rot_first,
+				c->rot_count, mesh->rot_keyframes);
 		}
+		mesh->clips.push_back (std::move (clip));
 	}
+	mesh->anim_count = (unsigned int)mesh->clips.size ();
 	return true;
 }
 
-Anim_Node* _get_anim_node_by_name (const Mesh& mesh, const aiString& name) {
-	Anim_Node* node_ptr = NULL;
-	unsigned int i = 0;
+//
+// keeps the largest APG_BONE_INFLUENCES weights on a vertex. false if one had
+// to be dropped
+static bool _add_influence (int* ids, float* weights, int bone, float weight) {
+	int smallest = 0;
+	int i;
 	
-	for (i = 0; i < mesh.node_name_map.size (); i++) {
-		if (name == mesh.node_name_map[i].ass_name) {
-			return mesh.node_name_map[i].anim_node_ptr;
+	for (i = 1; i < APG_BONE_INFLUENCES; i++) {
+		if (weights[i] < weights[smallest]) {
+			smallest = i;
 		}
 	}
-	return node_ptr;
+	if (weight > weights[smallest]) {
+		bool full = weights[smallest] > 0.0f;
+		
+		ids[smallest] = bone;
+		weights[smallest] = weight;
+		return !full;
+	}
+	return !(weight > 0.0f);
 }
 
 Mesh load_mesh (const char* file_name, bool correct_coords) {
-	int i;
+	// the largest APG_BONE_INFLUENCES weights seen on each vertex so far
+	std::vector<int> influence_ids;
+	std::vector<float> influence_weights;
+	int dropped_influences = 0;
+	// totals over all of the scene's meshes, to size every array once
+	size_t vp_count = 0, vn_count = 0, vt_count = 0, vtan_count = 0;
+	size_t index_count = 0, total_bones = 0, total_verts = 0;
+	// vertices written so far to each stream
+	size_t vp_at = 0, vn_at = 0, vt_at = 0, vtan_at = 0;
+	// for working out tangents of big meshes
+	Apg_Pool pool;
+	bool have_pool = false;
 	
 	printf ("loading mesh %s\n", file_name);
 	Mesh result;
@@ -144,175 +477,158 @@ Mesh load_mesh (const char* file_name, bool correct_coords) {
 	printf ("  meshes %i\n", (int)scene->mNumMeshes);
 	printf ("  textures %i\n", (int)scene->mNumTextures);
 	
-	// reset to 0 so meshes without anims can use matrix[0] as identity
-	for (i = 0; i < MAX_VERTICES; i++) {
-		result.vbone_ids[i] = 0;
+	for (unsigned int m_i = 0; m_i < scene->mNumMeshes; m_i++) {
+		const aiMesh* mesh = scene->mMeshes[m_i];
+		
+		vp_count += mesh->HasPositions () ? mesh->mNumVertices : 0;
+		vn_count += mesh->HasNormals () ? mesh->mNumVertices : 0;
+		vt_count += mesh->HasTextureCoords (0) ? mesh->mNumVertices : 0;
+		vtan_count += mesh->HasTangentsAndBitangents () ? mesh->mNumVertices : 0;
+		index_count += (size_t)mesh->mNumFaces * 3;
+		total_bones += mesh->HasBones () ? mesh->mNumBones : 0;
+		total_verts += mesh->mNumVertices;
+	}
+	if (total_bones > MAX_BONES) {
+		fprintf (stderr, "ERROR: too many bones. max %i\n", MAX_BONES);
+		exit (1);
+	}
+	result.vps.resize (vp_count * 3);
+	result.vns.resize (vn_count * 3);
+	result.vts.resize (vt_count * 2);
+	result.vtangents.resize (vtan_count * 4);
+	result.indices.reserve (index_count);
+	if (total_verts > EXTRACT_CHUNK) {
+		have_pool = apg_init_pool (0, &pool);
+	}
+	result.bone_offset_mats.reserve (total_bones);
+	if (total_bones > 0) {
+		influence_ids.resize (total_verts * APG_BONE_INFLUENCES, 0);
+		influence_weights.resize (total_verts * APG_BONE_INFLUENCES, 0.0f);
 	}
+	
 	unsigned int curr_bone = 0;
+	// index of first vertex of current mesh in the combined vertex arrays
+	unsigned int base_vertex = 0;
 	
 	// init each mesh in scene record per-vertex data
 	for (unsigned int m_i = 0; m_i < scene->mNumMeshes; m_i++) {
 		const aiMesh* mesh = scene->mMeshes[m_i];
-		for (unsigned int v_i = 0; v_i < mesh->mNumVertices; v_i++) {
-			if (mesh->HasPositions ()) {
-				const aiVector3D* vp = &(mesh->mVertices[v_i]);
-				if (correct_coords) {
-					result.vps.push_back (vp->x);
-					result.vps.push_back (vp->z);
-					result.vps.push_back (-vp->y);
-				} else {
-					result.vps.push_back (vp->x);
-					result.vps.push_back (vp->y);
-					result.vps.push_back (vp->z);
-				}
-			}
-			if (mesh->HasNormals ()) {
-				// assume normals are same coords as points
-				const aiVector3D* vn = &(mesh->mNormals[v_i]);
-				if (correct_coords) {
-					result.vns.push_back (vn->x);
-					result.vns.push_back (vn->z);
-					result.vns.push_back (-vn->y);
-				} else {
-					result.vns.push_back (vn->x);
-					result.vns.push_back (vn->y);
-					result.vns.push_back (vn->z);
-				}
+		int nv = (int)mesh->mNumVertices;
+		
+		// keep triangle indices. lines and points left by triangulation are skipped
+		for (unsigned int f_i = 0; f_i < mesh->mNumFaces; f_i++) {
+			const aiFace* face = &(mesh->mFaces[f_i]);
+			if (3 != face->mNumIndices) {
+				continue;
 			}
-			if (mesh->HasTextureCoords (0)) {
-				const aiVector3D* vt = &(mesh->mTextureCoords[0][v_i]);
-				result.vts.push_back (vt->x);
-				result.vts.push_back (vt->y);
-			}
-			if (mesh->HasTangentsAndBitangents ()) {
-				const aiVector3D* tangent = &(mesh->mTangents[v_i]);
-				const aiVector3D* bitangent = &(mesh->mBitangents[v_i]);
-				const aiVector3D* normal = &(mesh->mNormals[v_i]);
-
-				// put the three vectors into my vec3 struct format for doing maths
-				vec3 t (tangent->x, tangent->y, tangent->z);
-				vec3 n (normal->x, normal->y, normal->z);
-				vec3 b (bitangent->x, bitangent->y, bitangent->z);
-
-				// orthogonalise and normalise the tangent so we can use it in
-				// something approximating a T,N,B inverse matrix
-				vec3 t_i = normalise (t - n * dot (n, t));
-
-				// get determinant of T,B,N 3x3 matrix by dot*cross method
-				float det = (dot (cross (n, t), b));
-				if (det < 0.0f) {
-					det = -1.0f;
-				} else {
-					det = 1.0f;
-				}
-
-				// push back 4d vector for inverse tangent with determinant
-				result.vtangents.push_back (t_i.v[0]);
-				result.vtangents.push_back (t_i.v[1]);
-				result.vtangents.push_back (t_i.v[2]);
-				result.vtangents.push_back (det);
+			for (unsigned int i_i = 0; i_i < 3; i_i++) {
+				result.indices.push_back (base_vertex + face->mIndices[i_i]);
 			}
 		}
+		//
+		// every stream in one pass over this mesh's vertices. aiVector3D is 3
+		// floats. normals are assumed to be in the same coords as points
+		static_assert (sizeof (aiVector3D) == 3 * sizeof (float),
+			"assimp built with double precision");
+		Extract_Input ex_in;
+		Extract_Output ex_out;
+		memset (&ex_in, 0, sizeof (Extract_Input));
+		memset (&ex_out, 0, sizeof (Extract_Output));
+		if (mesh->HasPositions ()) {
+			ex_in.vertices = (const float*)mesh->mVertices;
+			ex_out.vps = &result.vps[vp_at * 3];
+			vp_at += nv;
+		}
+		if (mesh->HasNormals ()) {
+			ex_in.normals = (const float*)mesh->mNormals;
+			ex_out.vns = &result.vns[vn_at * 3];
+			vn_at += nv;
+		}
+		if (mesh->HasTextureCoords (0)) {
+			ex_in.texcoords = (const float*)mesh->mTextureCoords[0];
+			ex_out.vts = &result.vts[vt_at * 2];
+			vt_at += nv;
+		}
+		if (mesh->HasTangentsAndBitangents ()) {
+			ex_in.tangents = (const float*)mesh->mTangents;
+			ex_in.bitangents = (const float*)mesh->mBitangents;
+			ex_out.vtangents = &result.vtangents[vtan_at * 4];
+			vtan_at += nv;
+		}
+		extract_streams (&ex_in, nv, correct_coords, have_pool ? &pool : NULL,
+			&ex_out);
 	
 		if (mesh->HasBones ()) {
 			for (unsigned int b_i = 0; b_i < mesh->mNumBones; b_i++) {
 				const aiBone* bone = mesh->mBones[b_i];
-				result.bone_names.push_back (bone->mName);
+				// a bone shared by several meshes keeps its first index
+				int name_id = _intern_ai_name (result, bone->mName);
+				if (result.name_bones[name_id] < 0) {
+					result.name_bones[name_id] = (int)curr_bone;
+				}
 				// store offset matrix for bone (bone pos in mesh)
-				result.bone_offset_mats[curr_bone] = convert_assimp_matrix (
-					bone->mOffsetMatrix);
-				// store bone id for each vertex weighted by this bone
-				// TODO NOTE: this only allows 1 bone influencing each vertex
-				//printf ("db: weights loop\n");
+				result.bone_offset_mats.push_back (convert_assimp_matrix (
+					bone->mOffsetMatrix));
+				// store bone id and weight for each vertex weighted by this bone
 				for (unsigned int w_i = 0; w_i < bone->mNumWeights; w_i++) {
 					aiVertexWeight weight = bone->mWeights[w_i];
-					unsigned int vertex_id = weight.mVertexId;
-					if (MAX_VERTICES <= vertex_id) {
-						fprintf (stderr, "ERROR: vertex %i referred to by bone is bigger \
-							than max size of array; %i\n", vertex_id, MAX_VERTICES);
+					unsigned int vertex_id = base_vertex + weight.mVertexId;
+					if (mesh->mNumVertices <= weight.mVertexId) {
+						fprintf (stderr, "ERROR: bone weights vertex %i of %i\n",
+							weight.mVertexId, mesh->mNumVertices);
 						exit (1);
 					}
-					result.vbone_ids[vertex_id] = curr_bone;
+					if (!_add_influence (
+						&influence_ids[vertex_id * APG_BONE_INFLUENCES],
+						&influence_weights[vertex_id * APG_BONE_INFLUENCES],
+						curr_bone, weight.mWeight)) {
+						dropped_influences++;
+					}
 				}
 				curr_bone++;
 			} // end of for numbones loop
 		} // end of hasbones
+		base_vertex += mesh->mNumVertices;
 	} // end of mesh loop
 	
 	result.point_count = result.vps.size () / 3;
 	result.bone_count = curr_bone;
 	
 	// set up animation tree with some mappings to get rid of bone name searching
-	aiNode* ass_root_node = scene->mRootNode;
-	//printf ("root node is named %s\n", &ass_root_node->mName.data[0]);
-	result.root_node = new Anim_Node;
-	assert (result.root_node != NULL);
-	assert (initialise_node_and_children (result, result.root_node,
-		ass_root_node));
+	_build_node_tree (result, scene->mRootNode);
 	
-	// TODO only one animation supported atm
 	result.anim_count = scene->mNumAnimations;
-	if (result.anim_count > 1) {
-		fprintf (stderr, "WARNING! mesh has more than 1 animation. only 1 is \
-		stored"
-		"NOTE: to fix this store the root node in a vector of 'Animation'"
-		"structures, where each also contains the name of the animation\n");
-		exit (1);
-	}
-	//printf ("db: anim loop\n");
-	for (unsigned int a_i = 0; a_i < result.anim_count; a_i++) {
-		const aiAnimation* anim = scene->mAnimations[a_i];
-		result.anim_duration = anim->mDuration;
-	
-		for (unsigned int c_i = 0; c_i < anim->mNumChannels; c_i++) {
-			const aiNodeAnim* ass_node_anim = anim->mChannels[c_i];
-			
-			// look for node in tree by name ffs this is ridiculous assimp!
-			Anim_Node* my_node = _get_anim_node_by_name (
-				result,
-				ass_node_anim->mNodeName
-			);
-			assert (my_node != NULL);
-	
-			// store key-frames
-			// add position keyframes
-			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumPositionKeys;
-				p_i++) {
-				aiVectorKey vk = ass_node_anim->mPositionKeys[p_i];
-				pos_key pkf;
-				pkf.time = vk.mTime / anim->mTicksPerSecond;
-				aiVector3D vector = vk.mValue;
-				pkf.v = vec3 (vector.x, vector.y, vector.z);
-				my_node->pos_keyframes.push_back (pkf);
-			}
-			// add scale keyframes
-			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumScalingKeys; p_i++) {
-				aiVectorKey vk = ass_node_anim->mScalingKeys[p_i];
-				pos_key pkf;
-				pkf.time = vk.mTime / anim->mTicksPerSecond;
-				aiVector3D vector = vk.mValue;
-				pkf.v = vec3 (vector.x, vector.y, vector.z);
-				my_node->scale_keyframes.push_back (pkf);
-			}
-			// add rotation keyframes
-			for (unsigned int p_i = 0; p_i < ass_node_anim->mNumRotationKeys;
-				p_i++) {
-				aiQuatKey qk = ass_node_anim->mRotationKeys[p_i];
-				rot_key rkf;
-				rkf.time = qk.mTime / anim->mTicksPerSecond;
-				aiQuaternion versor = qk.mValue;
-				rkf.q.q[0] = versor.w;
-				rkf.q.q[1] = versor.x;
-				rkf.q.q[2] = versor.y;
-				rkf.q.q[3] = versor.z;
-				rkf.q = normalise (rkf.q);
-				my_node->rot_keyframes.push_back (rkf);
-			}
-		} // end of channels loop
-	} // end of animations loop
+	_copy_anim_clips (result, scene);
 	
-	// free scene
+	// free scene now everything is copied out of it, before packing weights
 	aiReleaseImport (scene);
+	scene = NULL;
+	if (have_pool) {
+		apg_free_pool (&pool);
+	}
+	
+	//
+	// pack to 8 bits each. vertices no bone weights get all of bone 0, so
+	// meshes without anims can use matrix[0] as identity
+	if (curr_bone > 0) {
+		size_t n = (size_t)result.point_count * APG_BONE_INFLUENCES;
+		
+		influence_ids.resize (n, 0);
+		influence_weights.resize (n, 0.0f);
+		result.vbone_ids.resize (n);
+		result.vbone_weights.resize (n);
+		for (size_t v_i = 0; v_i < n; v_i += APG_BONE_INFLUENCES) {
+			apg_encode_bone_weights (&influence_ids[v_i], &influence_weights[v_i],
+				APG_BONE_INFLUENCES, &result.vbone_ids[v_i],
+				&result.vbone_weights[v_i]);
+		}
+		if (dropped_influences > 0) {
+			printf ("  %i bone weights dropped to keep %i a vertex\n",
+				dropped_influences, APG_BONE_INFLUENCES);
+		}
+		std::vector<int> ().swap (influence_ids);
+		std::vector<float> ().swap (influence_weights);
+	}
 	
 	return result;
 }
@@ -0,0 +1,422 @@
+//
+// Mesh optimisation passes run by the converter before writing
+// First version 17 Oct 2026
+// see mesh_optimise.hpp
+//
+
+#include "mesh_optimise.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+
+//
+// FNV-1a over the 32-bit words of every stream of a vertex
+static uint32_t _hash_vertex (const Vertex_Stream* streams, int stream_count,
+	int v) {
+	uint32_t h = 2166136261u;
+	int i, j;
+
+	for (i = 0; i < stream_count; i++) {
+		const uint32_t* words = (const uint32_t*)(
+			(const char*)streams[i].data + (size_t)v * streams[i].stride);
+
+		for (j = 0; j < streams[i].stride / 4; j++) {
+			h = (h ^ words[j]) * 16777619u;
+		}
+	}
+	return h;
+}
+
+static bool _same_vertex (const Vertex_Stream* streams, int stream_count,
+	int a, int b) {
+	int i;
+
+	for (i = 0; i < stream_count; i++) {
+		const char* d = (const char*)streams[i].data;
+		int s = streams[i].stride;
+
+		if (memcmp (d + (size_t)a * s, d + (size_t)b * s, s) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int weld_vertices (Vertex_Stream* streams, int stream_count, int vert_count,
+	unsigned int* indices, int index_count) {
+	int* table = NULL; // open-addressed hash table of welded vertex ids
+	int* remap = NULL; // old vertex id -> welded vertex id
+	uint32_t mask = 0;
+	int welded_count = 0;
+	int i, v;
+
+	if (vert_count <= 0) {
+		return 0;
+	}
+	for (i = 0; i < stream_count; i++) {
+		assert (streams[i].stride > 0 && streams[i].stride % 4 == 0);
+	}
+	//
+	// table is a power of two at least twice the vertex count
+	mask = 1;
+	while (mask < (uint32_t)vert_count * 2) {
+		mask <<= 1;
+	}
+	table = (int*)malloc (mask * sizeof (int));
+	remap = (int*)malloc (vert_count * sizeof (int));
+	assert (table && remap);
+	memset (table, 0xFF, mask * sizeof (int));
+	mask--;
+
+	for (v = 0; v < vert_count; v++) {
+		uint32_t slot = _hash_vertex (streams, stream_count, v) & mask;
+
+		for (;;) {
+			int w = table[slot];
+
+			if (w < 0) {
+				//
+				// new vertex. compact it down into the next free welded slot, which
+				// is never ahead of v, so unread vertices are not overwritten
+				if (welded_count != v) {
+					for (i = 0; i < stream_count; i++) {
+						char* d = (char*)streams[i].data;
+						int s = streams[i].stride;
+
+						memcpy (d + (size_t)welded_count * s, d + (size_t)v * s, s);
+					}
+				}
+				table[slot] = welded_count;
+				remap[v] = welded_count++;
+				break;
+			}
+			// compare against the welded copy, which is identical to the original
+			if (_same_vertex (streams, stream_count, w, v)) {
+				remap[v] = w;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+	for (i = 0; i < index_count; i++) {
+		assert ((int)indices[i] < vert_count);
+		indices[i] = remap[indices[i]];
+	}
+	free (table);
+	free (remap);
+	return welded_count;
+}
+
+//
+// vertex scoring constants from Forsyth's article
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRI_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+// valences below this use a lookup table
+#define VALENCE_TABLE_SIZE 32
+
+static float _cache_score_table[VERTEX_CACHE_SIZE];
+static float _valence_score_table[VALENCE_TABLE_SIZE];
+
+static void _init_score_tables () {
+	int i;
+
+	for (i = 0; i < VERTEX_CACHE_SIZE; i++) {
+		if (i < 3) {
+			//
+			// vertices used by the last triangle get a fixed score so that the
+			// next triangle doesn't simply reuse the same edge in a strip
+			_cache_score_table[i] = LAST_TRI_SCORE;
+		} else {
+			float scaler = 1.0f / (VERTEX_CACHE_SIZE - 3);
+			_cache_score_table[i] = powf (1.0f - (i - 3) * scaler,
+				CACHE_DECAY_POWER);
+		}
+	}
+	_valence_score_table[0] = 0.0f;
+	for (i = 1; i < VALENCE_TABLE_SIZE; i++) {
+		_valence_score_table[i] = VALENCE_BOOST_SCALE *
+			powf ((float)i, -VALENCE_BOOST_POWER);
+	}
+}
+
+//
+// score of a vertex at the given cache position (-1 if not in cache) with
+// 'remaining' triangles still to be drawn. a vertex with few triangles left is
+// boosted so that lone triangles are cleared up rather than left behind
+static inline float _vertex_score (int cache_pos, int remaining) {
+	float score = 0.0f;
+
+	if (0 == remaining) {
+		return -1.0f;
+	}
+	if (cache_pos >= 0) {
+		score = _cache_score_table[cache_pos];
+	}
+	if (remaining < VALENCE_TABLE_SIZE) {
+		return score + _valence_score_table[remaining];
+	}
+	return score + VALENCE_BOOST_SCALE *
+		powf ((float)remaining, -VALENCE_BOOST_POWER);
+}
+
+void optimise_vertex_cache (unsigned int* indices, int index_count,
+	int vert_count) {
+	int tri_count = index_count / 3;
+	int* offsets = NULL; // first entry of each vertex in vert_tris
+	int* remaining = NULL; // triangles not yet drawn, per vertex
+	int* vert_tris = NULL; // not-yet-drawn triangles of each vertex first
+	int* cache_pos = NULL;
+	float* vert_scores = NULL;
+	float* tri_scores = NULL;
+	bool* emitted = NULL;
+	unsigned int* out = NULL;
+	int cache[VERTEX_CACHE_SIZE + 3];
+	int new_cache[VERTEX_CACHE_SIZE + 3];
+	int cache_count = 0;
+	int best_tri = -1;
+	int next_unemitted = 0; // fallback when the cache has nothing left to draw
+	int i, j, k, t;
+
+	if (tri_count < 2 || vert_count <= 0) {
+		return;
+	}
+	assert (index_count % 3 == 0);
+	_init_score_tables ();
+	offsets = (int*)calloc (vert_count + 1, sizeof (int));
+	remaining = (int*)calloc (vert_count, sizeof (int));
+	vert_tris = (int*)malloc (index_count * sizeof (int));
+	cache_pos = (int*)malloc (vert_count * sizeof (int));
+	vert_scores = (float*)malloc (vert_count * sizeof (float));
+	tri_scores = (float*)malloc (tri_count * sizeof (float));
+	emitted = (bool*)calloc (tri_count, sizeof (bool));
+	out = (unsigned int*)malloc (index_count * sizeof (unsigned int));
+	assert (offsets && remaining && vert_tris && cache_pos && vert_scores &&
+		tri_scores && emitted && out);
+
+	//
+	// triangle lists of each vertex, packed one after another
+	for (i = 0; i < index_count; i++) {
+		assert ((int)indices[i] < vert_count);
+		remaining[indices[i]]++;
+	}
+	for (i = 0; i < vert_count; i++) {
+		offsets[i + 1] = offsets[i] + remaining[i];
+		remaining[i] = 0;
+	}
+	for (i = 0; i < index_count; i++) {
+		int v = indices[i];
+		vert_tris[offsets[v] + remaining[v]++] = i / 3;
+	}
+	for (i = 0; i < vert_count; i++) {
+		cache_pos[i] = -1;
+		vert_scores[i] = _vertex_score (-1, remaining[i]);
+	}
+	for (t = 0; t < tri_count; t++) {
+		tri_scores[t] = vert_scores[indices[t * 3]] +
+			vert_scores[indices[t * 3 + 1]] + vert_scores[indices[t * 3 + 2]];
+		if (best_tri < 0 || tri_scores[t] > tri_scores[best_tri]) {
+			best_tri = t;
+		}
+	}
+
+	for (i = 0; i < tri_count; i++) {
+		int new_count = 0;
+		float best_score = -1.0f;
+
+		if (best_tri < 0) {
+			while (emitted[next_unemitted]) {
+				next_unemitted++;
+			}
+			best_tri = next_unemitted;
+		}
+		t = best_tri;
+		emitted[t] = true;
+		//
+		// draw it, and take it off each of its vertices' lists of remaining tris
+		for (j = 0; j < 3; j++) {
+			int v = indices[t * 3 + j];
+			int* tris = &vert_tris[offsets[v]];
+
+			out[i * 3 + j] = v;
+			for (k = 0; k < remaining[v]; k++) {
+				if (tris[k] == t) {
+					tris[k] = tris[--remaining[v]];
+					break;
+				}
+			}
+			new_cache[new_count++] = v;
+		}
+		//
+		// the triangle's vertices move to the front of the LRU cache
+		for (j = 0; j < cache_count; j++) {
+			int v = cache[j];
+
+			if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2]) {
+				new_cache[new_count++] = v;
+			}
+		}
+		//
+		// rescore everything in the cache, including up to 3 vertices that have
+		// just been pushed out, then pick the best triangle touching the cache
+		for (j = 0; j < new_count; j++) {
+			int v = new_cache[j];
+
+			cache_pos[v] = j < VERTEX_CACHE_SIZE ? j : -1;
+			vert_scores[v] = _vertex_score (cache_pos[v], remaining[v]);
+		}
+		best_tri = -1;
+		for (j = 0; j < new_count; j++) {
+			int v = new_cache[j];
+			const int* tris = &vert_tris[offsets[v]];
+
+			for (k = 0; k < remaining[v]; k++) {
+				int u = tris[k];
+				float score = vert_scores[indices[u * 3]] +
+					vert_scores[indices[u * 3 + 1]] + vert_scores[indices[u * 3 + 2]];
+
+				tri_scores[u] = score;
+				if (score > best_score) {
+					best_score = score;
+					best_tri = u;
+				}
+			}
+		}
+		cache_count = new_count < VERTEX_CACHE_SIZE ? new_count : VERTEX_CACHE_SIZE;
+		memcpy (cache, new_cache, cache_count * sizeof (int));
+	}
+	memcpy (indices, out, index_count * sizeof (unsigned int));
+	free (offsets);
+	free (remaining);
+	free (vert_tris);
+	free (cache_pos);
+	free (vert_scores);
+	free (tri_scores);
+	free (emitted);
+	free (out);
+}
+
+void vertex_cache_stats (const unsigned int* indices, int index_count,
+	int vert_count, int cache_size, float* acmr, float* atvr) {
+	int* stamps = NULL; // miss count when each vertex was last loaded
+	int misses = 0;
+	int i;
+
+	*acmr = *atvr = 0.0f;
+	if (index_count < 3 || vert_count <= 0) {
+		return;
+	}
+	stamps = (int*)malloc (vert_count * sizeof (int));
+	assert (stamps);
+	for (i = 0; i < vert_count; i++) {
+		stamps[i] = -cache_size - 1;
+	}
+	//
+	// in a FIFO a vertex is still cached if fewer than cache_size other
+	// vertices have been loaded since it was
+	for (i = 0; i < index_count; i++) {
+		int v = indices[i];
+
+		if (misses - stamps[v] >= cache_size) {
+			stamps[v] = misses++;
+		}
+	}
+	*acmr = (float)misses / (float)(index_count / 3);
+	*atvr = (float)misses / (float)vert_count;
+	free (stamps);
+}
+
+int optimise_vertex_fetch (Vertex_Stream* streams, int stream_count,
+	int vert_count, unsigned int* indices, int index_count) {
+	int* remap = NULL; // old vertex id -> new vertex id, or -1 if not used yet
+	int* order = NULL; // new vertex id -> old vertex id
+	char* scratch = NULL;
+	int max_stride = 0;
+	int new_count = 0;
+	int i, v;
+
+	if (vert_count <= 0) {
+		return 0;
+	}
+	for (i = 0; i < stream_count; i++) {
+		if (streams[i].stride > max_stride) {
+			max_stride = streams[i].stride;
+		}
+	}
+	remap = (int*)malloc (vert_count * sizeof (int));
+	order = (int*)malloc (vert_count * sizeof (int));
+	scratch = (char*)malloc ((size_t)vert_count * max_stride);
+	assert (remap && order && scratch);
+	memset (remap, 0xFF, vert_count * sizeof (int));
+	for (i = 0; i < index_count; i++) {
+		v = indices[i];
+		assert (v < vert_count);
+		if (remap[v] < 0) {
+			order[new_count] = v;
+			remap[v] = new_count++;
+		}
+		indices[i] = remap[v];
+	}
+	//
+	// gather each stream in the new order, then copy it back over the original
+	for (i = 0; i < stream_count; i++) {
+		char* d = (char*)streams[i].data;
+		int s = streams[i].stride;
+
+		for (v = 0; v < new_count; v++) {
+			memcpy (scratch + (size_t)v * s, d + (size_t)order[v] * s, s);
+		}
+		memcpy (d, scratch, (size_t)new_count * s);
+	}
+	free (remap);
+	free (order);
+	free (scratch);
+	return new_count;
+}
+
+int vertex_fetch_stats (const Vertex_Stream* streams, int stream_count,
+	int vert_count, const unsigned int* indices, int index_count) {
+	size_t cache[VERTEX_FETCH_CACHE_LINES];
+	size_t* bases = NULL; // first line of each stream
+	size_t next_base = 1; // 0 means an empty cache slot
+	int lines = 0;
+	int i, j;
+
+	if (stream_count <= 0) {
+		return 0;
+	}
+	bases = (size_t*)malloc (stream_count * sizeof (size_t));
+	assert (bases);
+	for (i = 0; i < stream_count; i++) {
+		bases[i] = next_base;
+		next_base += ((size_t)vert_count * streams[i].stride +
+			VERTEX_FETCH_LINE_SIZE - 1) / VERTEX_FETCH_LINE_SIZE;
+	}
+	memset (cache, 0, sizeof (cache));
+	//
+	// a vertex shader fetches all streams of one vertex before the next
+	for (j = 0; j < index_count; j++) {
+		for (i = 0; i < stream_count; i++) {
+			size_t s = streams[i].stride;
+			size_t start = (size_t)indices[j] * s;
+			size_t first = bases[i] + start / VERTEX_FETCH_LINE_SIZE;
+			size_t last = bases[i] + (start + s - 1) / VERTEX_FETCH_LINE_SIZE;
+			size_t line;
+
+			for (line = first; line <= last; line++) {
+				size_t* slot = &cache[line % VERTEX_FETCH_CACHE_LINES];
+
+				if (*slot != line) {
+					*slot = line;
+					lines++;
+				}
+			}
+		}
+	}
+	free (bases);
+	return lines;
+}
@@ -7,6 +7,8 @@
 // uses the Assimp asset importer library http://assimp.sourceforge.net/
 //
 #include "maths_funcs.hpp"
+#include "apg_loader.hpp"
+#include "apg_crowd.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 //#define GLEW_STATIC
@@ -38,50 +40,25 @@ GLint pP_loc = -1;
 GLint pV_loc = -1;
 GLint pM_loc = -1;
 
-#define MAX_ANIM_NAME_LEN 64
-struct TraAnimKey {
-	vec3 tra;
-	double time;
-};
-struct ScaAnimKey {
-	vec3 sca;
-	double time;
-};
-struct RotAnimKey {
-	versor rot;
-	double time;
-};
-struct Channel {
-	TraAnimKey* tra_keys;
-	int tra_keys_count;
-	ScaAnimKey* sca_keys;
-	int sca_keys_count;
-	RotAnimKey* rot_keys;
-	int rot_keys_count;
-};
-// an animation to be played using the skeleton hierarchy
-struct Animation {
-	char name[MAX_ANIM_NAME_LEN];
-	double duration;
-	// mem order of channels corresponds to anim nodes in hierarchy
-	Channel* channels;
-	int num_channels;
-};
-
 Animation* animations = NULL;
 int animation_count = 0;
 // the skeleton hierarchy
 mat4 root_transform_mat;
 mat4* offset_mats = NULL;
-mat4* current_bone_mats = NULL;
-int* anim_node_parents = NULL;
-int anim_node_children[MAX_BONES][MAX_BONES];
-int anim_node_num_children[MAX_BONES];
-int* anim_node_bone_ids = NULL;
+// skeleton, clips and bind matrices, and the one instance of them on screen.
+// its palette is what goes in the B uniforms
+Apg_Rig rig;
+Apg_Crowd crowd;
 int bone_count = 0;
 // vertex mesh
 GLuint vao = 0;
 int vert_count = 0;
+// indexed meshes are drawn with glDrawElements. older files have no indices
+int index_count = 0;
+GLenum index_type = GL_UNSIGNED_SHORT;
+// loaded file. key-frames and the skeleton arrays point into this for the life
+// of the programme
+Apg_Mesh mesh_data;
 
 void print_all_keys () {
 	for (int i = 0; i < animation_count; i++) {
@@ -99,463 +76,72 @@ void print_all_keys () {
 				print (animations[i].channels[j].sca_keys[k].sca);
 			}
 			for (int k = 0; k < animations[i].channels[j].rot_keys_count; k++) {
+				RotAnimKey key;
+				
+				apg_get_rot_keys (&animations[i], j, k, 1, &key);
 				printf ("  a%ic%i rot_key %i\n", i, j, k);
-				printf ("t %f\n", animations[i].channels[j].rot_keys[k].time);
-				print (animations[i].channels[j].rot_keys[k].rot);
+				printf ("t %f\n", key.time);
+				print (key.rot);
 			}
 		}
 	}
 }
 
-void _recurse_anim_tree (
-	Animation* animations,
-	double anim_time,
-	int my_anim_node,
-	mat4 parent_mat
-);
-
-void _recurse_anim_tree (
-	Animation* animations,
-	double anim_time,
-	int my_anim_node,
-	mat4 parent_mat
-) {
-	mat4 trans_mat, sca_mat, rot_mat, node_mat, global_trans_mat;
-
-	if (!animations) {
-		return;
-	}
-
-	trans_mat = identity_mat4 ();
-	sca_mat = identity_mat4 ();
-	rot_mat = identity_mat4 ();
-	// position
-	if (animations->channels[my_anim_node].tra_keys_count > 1) {
-		int previous_frame_index = 0;
-		int next_frame_index = 1;
-		double prev_t, next_t, t_factor;
-		vec3 vf, vi, p;
-		
-		// work out previous frame and next frame numbers
-		for (int i = 0; i <
-			animations->channels[my_anim_node].tra_keys_count - 1; i++) {
-			double t;
-			
-			t = animations->channels[my_anim_node].tra_keys[i].time;
-			if (t >= anim_time) {
-				break;
-			}
-			previous_frame_index = i;
-			next_frame_index = i + 1;
-		}
-		// get prev and next pos and time
-		prev_t =
-			animations->channels[my_anim_node].tra_keys[previous_frame_index].time;
-		next_t =
-			animations->channels[my_anim_node].tra_keys[next_frame_index].time;
-		t_factor = (anim_time - prev_t) / (next_t - prev_t);
-		// interp position
-		vf = animations->channels[my_anim_node].tra_keys[next_frame_index].tra;
-		vi = animations->channels[my_anim_node].tra_keys[previous_frame_index].tra;
-		p = vf * t_factor + vi * (1.0 - t_factor);
-		trans_mat = translate (identity_mat4 (), p);
-	} else if (1 == animations->channels[my_anim_node].tra_keys_count) {
-		vec3 vf;
-		
-		vf = animations->channels[my_anim_node].tra_keys[0].tra;
-		trans_mat = translate (identity_mat4 (), vf);
-	}
-
-	// scale
-	if (animations->channels[my_anim_node].sca_keys_count > 1) {
-		int previous_frame_index = 0;
-		int next_frame_index = 1;
-		double prev_t, next_t, t_factor;
-		vec3 vf, vi, p;
-		
-		// work out previous frame and next frame numbers
-		for (int i = 0; i <
-			animations->channels[my_anim_node].sca_keys_count - 1; i++) {
-			double t;
-			
-			t = animations->channels[my_anim_node].sca_keys[i].time;
-			if (t >= anim_time) {
-				break;
-			}
-			previous_frame_index = i;
-			next_frame_index = i + 1;
-		}
-		// get prev and next pos and time
-		prev_t =
-			animations->channels[my_anim_node].sca_keys[previous_frame_index].time;
-		next_t =
-			animations->channels[my_anim_node].sca_keys[next_frame_index].time;
-		t_factor = (anim_time - prev_t) / (next_t - prev_t);
-		// interp position
-		vf = animations->channels[my_anim_node].sca_keys[next_frame_index].sca;
-		vi = animations->channels[my_anim_node].sca_keys[previous_frame_index].sca;
-		p = vf * t_factor + vi * (1.0 - t_factor);
-		sca_mat = scale (identity_mat4 (), p);
-	} else if (1 == animations->channels[my_anim_node].sca_keys_count) {
-		vec3 vf;
-		
-		vf = animations->channels[my_anim_node].sca_keys[0].sca;
-		sca_mat = scale (identity_mat4 (), vf);
-	}
-	
-	// interp rotation
-	if (animations->channels[my_anim_node].rot_keys_count > 1) {
-		int previous_frame_index = 0;
-		int next_frame_index = 1;
-		double prev_t, next_t, t_factor;
-		versor qf, qi, slerped;
-
-		for (int i = 0; i <
-			animations->channels[my_anim_node].rot_keys_count - 1; i++) {
-			double t;
-			
-			t = animations->channels[my_anim_node].rot_keys[i].time;
-			if (t >= anim_time) {
-				break;
-			}
-			previous_frame_index = i;
-			next_frame_index = i + 1;
-		}
-		// get prev and next pos and time
-		prev_t =
-			animations->channels[my_anim_node].rot_keys[previous_frame_index].time;
-		next_t =
-			animations->channels[my_anim_node].rot_keys[next_frame_index].time;
-		t_factor = (anim_time - prev_t) / (next_t - prev_t);
-		// get the two quaternions
-		qf = animations->channels[my_anim_node].rot_keys[next_frame_index].rot;
-		qi = animations->channels[my_anim_node].rot_keys[previous_frame_index].rot;
-		slerped = slerp (qi, qf, t_factor);
-		rot_mat = quat_to_mat4 (slerped);
-	} else if (1 == animations->channels[my_anim_node].rot_keys_count) {
-		versor qf;
-		
-		qf = animations->channels[my_anim_node].rot_keys[0].rot;
-		rot_mat = quat_to_mat4 (qf);
-	}
-	
-	node_mat = trans_mat * rot_mat * sca_mat;
-	global_trans_mat = parent_mat * node_mat;
-
-	// update bone mats if bone linked to this node
-	if (anim_node_bone_ids[my_anim_node] > -1) {
-		current_bone_mats[anim_node_bone_ids[my_anim_node]] =
-			root_transform_mat * global_trans_mat *
-			offset_mats[anim_node_bone_ids[my_anim_node]];
-	}
-	//print (offset_mats[1]);
-
-	// transform children
-	for (int i = 0 ; i < anim_node_num_children[my_anim_node]; i++) {
-		_recurse_anim_tree (
-			animations,
-			anim_time,
-			anim_node_children[my_anim_node][i],
-			global_trans_mat
-		);
+void draw_mesh () {
+	if (index_count > 0) {
+		glDrawElements (GL_TRIANGLES, index_count, index_type, NULL);
+	} else {
+		glDrawArrays (GL_TRIANGLES, 0, vert_count);
 	}
 }
 
 bool load_mesh (const char* file_name) {
-	FILE* f;
-	float* vps = NULL;
-	float* vns = NULL;
-	float* vts = NULL;
-	float* vtans = NULL;
-	float* vbs = NULL; // HACK: as float cos i don't trust GL with ints
-	int vp_comps = 0;
-	int vn_comps = 0;
-	int vt_comps = 0;
-	int vtan_comps = 0;
-	int vb_comps = 0;
-	int offset_mat_comps = 0;
-	int current_anim_index = -1;
-	char line[1024];
 	GLuint points_vbo = 0;
 	GLuint normals_vbo = 0;
 	GLuint texcoords_vbo = 0;
 	GLuint bone_ids_vbo = 0;
+	GLuint bone_weights_vbo = 0;
+	GLuint index_vbo = 0;
+	uint8_t* bone_ids = NULL;
+	uint8_t* bone_weights = NULL;
 	
 	printf ("loading mesh %s\n", file_name);
-	f = fopen (file_name, "r");
-	if (!f) {
-		fprintf (stderr, "ERROR opening file %s\n", file_name);
+	if (!apg_load_mesh (file_name, &mesh_data)) {
 		return false;
 	}
-	
-	while (fgets (line, 1024, f)) {
-		if ('@' == line[0]) {
-			char code_str[32];
-			
-			sscanf (line, "@%s\n", code_str);
-			printf ("code: \"%s\"\n", code_str);
-			
-			if (strcmp (code_str, "Anton's") == 0) {
-			
-			} else if (strcmp (code_str, "vert_count") == 0) {
-				sscanf (line, "@vert_count %i\n", &vert_count);
-				
-			} else if (strcmp (code_str, "vp") == 0) {
-				sscanf (line, "@vp comps %i\n", &vp_comps);
-				vps = (float*)malloc (vert_count * vp_comps * sizeof (float));
-				//printf ("vc %i vvcvs;lksjhdflkjsdhfkjd %i\n", vert_count, vp_comps);
-				for (int i = 0; i < vert_count * vp_comps; i++) {
-					fscanf (f, "%f", &vps[i]);
-					//printf ("v %f\n", vps[i]);
-				}
-				fscanf (f, "\n");
-				
-			} else if (strcmp (code_str, "vn") == 0) {
-				sscanf (line, "@vn comps %i\n", &vn_comps);
-				vns = (float*)malloc (vert_count * vn_comps * sizeof (float));
-				for (int i = 0; i < vert_count * vn_comps; i++) {
-					fscanf (f, "%f", &vns[i]);
-				}
-				fscanf (f, "\n");
-			} else if (strcmp (code_str, "vt") == 0) {
-				sscanf (line, "@vt comps %i\n", &vt_comps);
-				vts = (float*)malloc (vert_count * vt_comps * sizeof (float));
-				for (int i = 0; i < vert_count * vt_comps; i++) {
-					fscanf (f, "%f", &vts[i]);
-				}
-				fscanf (f, "\n");
-			} else if (strcmp (code_str, "vtan") == 0) {
-				sscanf (line, "@vtan comps %i\n", &vtan_comps);
-				vtans = (float*)malloc (vert_count * vtan_comps * sizeof (float));
-				for (int i = 0; i < vert_count * vtan_comps; i++) {
-					fscanf (f, "%f", &vtans[i]);
-				}
-				fscanf (f, "\n");
-			} else if (strcmp (code_str, "vb") == 0) {
-				sscanf (line, "@vb comps %i\n", &vb_comps);
-				vbs = (float*)malloc (vert_count * vb_comps * sizeof (float));
-				for (int i = 0; i < vert_count * vb_comps; i++) {
-					fscanf (f, "%f", &vbs[i]);
-				}
-				fscanf (f, "\n");
-			//@skeleton bones 2 animations 1
-			} else if (strcmp (code_str, "skeleton") == 0) {
-				sscanf (
-					line,
-					"@skeleton bones %i animations %i\n",
-					&bone_count, &animation_count
-				);
-				animations = (Animation*)malloc (animation_count * sizeof (Animation));
-				/*
-				struct Animation {
-					char name[MAX_ANIM_NAME_LEN];
-					double duration;
-					// mem order of channels corresponds to anim nodes in hierarchy
-					Channel* channels;
-					int num_channels;
-				};
-				*/
-				for (int i = 0; i < animation_count; i++) {
-					animations[i].name[0] = '\0';
-					animations[i].duration = 0.0;
-					animations[i].channels = NULL;
-					animations[i].num_channels = 0;
-				}
-				
-				current_bone_mats = (mat4*)malloc (bone_count * sizeof (mat4));
-				for (int i = 0; i < bone_count; i++) {
-					current_bone_mats[i] = identity_mat4 ();
-				}
-			//@root_transform comps 16
-			} else if (strcmp (code_str, "root_transform") == 0) {
-				int mat_comps = 0;
-				
-				sscanf (line, "@root_transform comps %i\n", &mat_comps);
-				for (int j = 0; j < mat_comps; j++) {
-					fscanf (f, "%f", &root_transform_mat.m[j]);
-				}
-				printf ("root transform mat:");
-				print (root_transform_mat);
-				fscanf (f, "\n");
-			//@offset_mat comps 16
-			} else if (strcmp (code_str, "offset_mat") == 0) {
-				sscanf (line, "@offset_mat comps %i\n", &offset_mat_comps);
-				offset_mats = (mat4*)malloc (bone_count * sizeof (mat4));
-				for (int i = 0; i < bone_count; i++) {
-					for (int j = 0; j < offset_mat_comps; j++) {
-						fscanf (f, "%f", &offset_mats[i].m[j]);
-					}
-					fscanf (f, "\n");
-					//print (offset_mats[i]);
-				}
-			//@hierarchy nodes 5
-			} else if (strcmp (code_str, "hierarchy") == 0) {
-				int nodes = 0;
-				
-				sscanf (line, "@hierarchy nodes %i\n", &nodes);
-				anim_node_parents = (int*)malloc (nodes * sizeof (int));
-				anim_node_bone_ids = (int*)malloc (nodes * sizeof (int));
-				//parent -1 bone_id -1
-				for (int i = 0; i < nodes; i++) {
-					fscanf (
-						f,
-						"parent %i bone_id %i\n",
-						&anim_node_parents[i], &anim_node_bone_ids[i]
-					);
-					//printf ("%i %i\n", anim_node_parents[i], anim_node_bone_ids[i]);
-				}
-				// work out children of each node
-				for (int i = 0; i < nodes; i++) {
-					for (int j = 0; j < nodes; j++) {
-						if (anim_node_parents[j] == i) {
-							anim_node_children[i][anim_node_num_children[i]++] = j;
-						}
-					}
-				}
-				
-				for (int i = 0; i < animation_count; i++) {
-					animations[i].channels = (Channel*)malloc (nodes * sizeof (Channel));
-					/*
-					struct Channel {
-						TraAnimKey* tra_keys;
-						int tra_keys_count;
-						RotAnimKey* rot_keys;
-						int rot_keys_count;
-					};
-					*/
-					for (int j = 0; j < nodes; j++) {
-						animations[i].channels[j].tra_keys = NULL;
-						animations[i].channels[j].tra_keys_count = 0;
-						animations[i].channels[j].sca_keys = NULL;
-						animations[i].channels[j].sca_keys_count = 0;
-						animations[i].channels[j].rot_keys = NULL;
-						animations[i].channels[j].rot_keys_count = 0;
-					}
-					animations[i].num_channels = nodes;
-				}
-				
-			//@animation name TODO duration 0.000000
-			} else if (strcmp (code_str, "animation") == 0) {
-				current_anim_index++;
-				sscanf (
-					line,
-					"@animation name %s duration %lf\n",
-					animations[current_anim_index].name,
-					&animations[current_anim_index].duration
-				);
-				
-			//@tra_keys count 12 comps 3
-			} else if (strcmp (code_str, "tra_keys") == 0) {
-				int node = 0;
-				int count = 0;
-				int comps = 0;
-				
-				sscanf (
-					line, "@tra_keys node %i count %i comps %i\n", &node, &count, &comps
-				);
-				animations[current_anim_index].channels[node].tra_keys =
-					(TraAnimKey*)malloc (count * sizeof (TraAnimKey));
-				/*
-				vec3 tra;
-				double time;
-				*/
-				for (int i = 0; i < count; i++) {
-					animations[current_anim_index].channels[node].tra_keys[i].tra =
-						vec3 (0.0f, 0.0f, 0.0f);
-					animations[current_anim_index].channels[node].tra_keys[i].time = 0.0;
-				}
-				animations[current_anim_index].channels[node].tra_keys_count = count;
-				
-				//t 0.040000 TRA 0.000000 0.000000 0.000000
-				for (int i = 0; i < count; i++) {
-					fscanf (f, "t %lf TRA %f %f %f\n",
-						&animations[current_anim_index].channels[node].tra_keys[i].time,
-						&animations[current_anim_index].channels[node].tra_keys[i].tra.v[0],
-						&animations[current_anim_index].channels[node].tra_keys[i].tra.v[1],
-						&animations[current_anim_index].channels[node].tra_keys[i].tra.v[2]
-					);
-					//print (animations[current_anim_index].channels[node].tra_keys[i].tra);
-				}
-
-			//@sca_keys count 12 comps 3
-			} else if (strcmp (code_str, "sca_keys") == 0) {
-				int node = 0;
-				int count = 0;
-				int comps = 0;
-				
-				sscanf (
-					line, "@sca_keys node %i count %i comps %i\n", &node, &count, &comps
-				);
-				animations[current_anim_index].channels[node].sca_keys =
-					(ScaAnimKey*)malloc (count * sizeof (ScaAnimKey));
-				/*
-				vec3 tra;
-				double time;
-				*/
-				for (int i = 0; i < count; i++) {
-					animations[current_anim_index].channels[node].sca_keys[i].sca =
-						vec3 (0.0f, 0.0f, 0.0f);
-					animations[current_anim_index].channels[node].sca_keys[i].time = 0.0;
-				}
-				animations[current_anim_index].channels[node].sca_keys_count = count;
-				
-				//t 0.040000 SCA 0.000000 0.000000 0.000000
-				for (int i = 0; i < count; i++) {
-					fscanf (f, "t %lf SCA %f %f %f\n",
-						&animations[current_anim_index].channels[node].sca_keys[i].time,
-						&animations[current_anim_index].channels[node].sca_keys[i].sca.v[0],
-						&animations[current_anim_index].channels[node].sca_keys[i].sca.v[1],
-						&animations[current_anim_index].channels[node].sca_keys[i].sca.v[2]
-					);
-					//print (animations[current_anim_index].channels[node].sca_keys[i].sca);
-				}
-				
-			//@rot_keys count 12 comps 4
-			} else if (strcmp (code_str, "rot_keys") == 0) {
-				int node = 0;
-				int count = 0;
-				int comps = 0;
-				sscanf (
-					line, "@rot_keys node %i count %i comps %i\n", &node, &count, &comps
-				);
-				animations[current_anim_index].channels[node].rot_keys =
-					(RotAnimKey*)malloc (count * sizeof (RotAnimKey));
-				/*
-				versor rot;
-				double time;
-				*/
-				for (int i = 0; i < count; i++) {
-					animations[current_anim_index].channels[node].rot_keys[i].rot.q[0] = 0.0f;
-					animations[current_anim_index].channels[node].rot_keys[i].rot.q[1] = 0.0f;
-					animations[current_anim_index].channels[node].rot_keys[i].rot.q[2] = 0.0f;
-					animations[current_anim_index].channels[node].rot_keys[i].rot.q[3] = 0.0f;
-					animations[current_anim_index].channels[node].rot_keys[i].time = 0.0;
-				}
-				animations[current_anim_index].channels[node].rot_keys_count = count;
-				//t 0.040000 ROT 0.707107 0.707107 0.000000 0.000000
-				for (int i = 0; i < count; i++) {
-					fscanf (f, "t %lf ROT %f %f %f %f\n",
-						&animations[current_anim_index].channels[node].rot_keys[i].time,
-						&animations[current_anim_index].channels[node].rot_keys[i].rot.q[0],
-						&animations[current_anim_index].channels[node].rot_keys[i].rot.q[1],
-						&animations[current_anim_index].channels[node].rot_keys[i].rot.q[2],
-						&animations[current_anim_index].channels[node].rot_keys[i].rot.q[3]
-					);
-					//print (animations[current_anim_index].channels[node].rot_keys[i].rot);
-				} // endfor
-			} // endif
-		}
+	if (!mesh_data.vps) {
+		fprintf (stderr, "ERROR: mesh %s has no vertex points\n", file_name);
+		return false;
 	}
-	fclose (f);
-	
-	printf ("1st 3 vps: %f %f %f\n", vps[0], vps[1], vps[2]);
+	if (mesh_data.bone_count > MAX_BONES) {
+		fprintf (stderr, "ERROR: too many bones. max %i\n", MAX_BONES);
+		return false;
+	}
+	vert_count = mesh_data.vert_count;
+	bone_count = mesh_data.bone_count;
+	animation_count = mesh_data.animation_count;
+	animations = mesh_data.animations;
+	offset_mats = mesh_data.offset_mats;
+	//
+	// one instance playing the first clip, on this thread
+	if (animation_count > 0 && (!apg_init_rig (&mesh_data, &rig) ||
+		!apg_init_crowd (&rig, 1, 1, &crowd))) {
+		return false;
+	}
+	root_transform_mat = mesh_data.root_transform;
+	if (bone_count > 0) {
+		printf ("root transform mat:");
+		print (root_transform_mat);
+	}
+	printf ("1st 3 vps: %f %f %f\n", mesh_data.vps[0], mesh_data.vps[1],
+		mesh_data.vps[2]);
 	
 	glGenBuffers (1, &points_vbo);
 	glBindBuffer (GL_ARRAY_BUFFER, points_vbo);
 	glBufferData (
 		GL_ARRAY_BUFFER,
-		vp_comps * vert_count * sizeof (GLfloat),
-		vps,
+		mesh_data.vp_comps * vert_count * sizeof (GLfloat),
+		mesh_data.vps,
 		GL_STATIC_DRAW
 	);
 	
@@ -563,8 +149,8 @@ bool load_mesh (const char* file_name) {
 	glBindBuffer (GL_ARRAY_BUFFER, normals_vbo);
 	glBufferData (
 		GL_ARRAY_BUFFER,
-		vn_comps * vert_count * sizeof (GLfloat),
-		vns,
+		mesh_data.vn_comps * vert_count * sizeof (GLfloat),
+		mesh_data.vns,
 		GL_STATIC_DRAW
 	);
 	
@@ -572,46 +158,93 @@ bool load_mesh (const char* file_name) {
 	glBindBuffer (GL_ARRAY_BUFFER, texcoords_vbo);
 	glBufferData (
 		GL_ARRAY_BUFFER,
-		vt_comps * vert_count * sizeof (GLfloat),
-		vts,
+		mesh_data.vt_comps * vert_count * sizeof (GLfloat),
+		mesh_data.vts,
 		GL_STATIC_DRAW
 	);
 	
-	glGenBuffers (1, &bone_ids_vbo);
-	glBindBuffer (GL_ARRAY_BUFFER, bone_ids_vbo);
-	glBufferData (
-		GL_ARRAY_BUFFER,
-		vb_comps * vert_count * sizeof (GLfloat),
-		vbs,
-		GL_STATIC_DRAW
-	);
+	//
+	// 4 uint8 bone ids and 4 unorm8 weights per vertex, whatever the file held
+	if (animation_count > 0) {
+		bone_ids = (uint8_t*)malloc (vert_count * APG_BONE_INFLUENCES);
+		bone_weights = (uint8_t*)malloc (vert_count * APG_BONE_INFLUENCES);
+		assert (bone_ids && bone_weights);
+		if (!apg_mesh_packed_bones (&mesh_data, bone_ids, bone_weights)) {
+			free (bone_ids);
+			free (bone_weights);
+			return false;
+		}
+		glGenBuffers (1, &bone_ids_vbo);
+		glBindBuffer (GL_ARRAY_BUFFER, bone_ids_vbo);
+		glBufferData (GL_ARRAY_BUFFER, vert_count * APG_BONE_INFLUENCES,
+			bone_ids, GL_STATIC_DRAW);
+		glGenBuffers (1, &bone_weights_vbo);
+		glBindBuffer (GL_ARRAY_BUFFER, bone_weights_vbo);
+		glBufferData (GL_ARRAY_BUFFER, vert_count * APG_BONE_INFLUENCES,
+			bone_weights, GL_STATIC_DRAW);
+		free (bone_ids);
+		free (bone_weights);
+	}
 	glGenVertexArrays (1, &vao);
 	glBindVertexArray (vao);
 	glEnableVertexAttribArray (0);
 	glBindBuffer (GL_ARRAY_BUFFER, points_vbo);
-	glVertexAttribPointer (0, vp_comps, GL_FLOAT, GL_FALSE, 0, NULL);
+	glVertexAttribPointer (0, mesh_data.vp_comps, GL_FLOAT, GL_FALSE, 0, NULL);
 	glEnableVertexAttribArray (1);
 	glBindBuffer (GL_ARRAY_BUFFER, normals_vbo);
-	glVertexAttribPointer (1, vn_comps, GL_FLOAT, GL_FALSE, 0, NULL);
+	glVertexAttribPointer (1, mesh_data.vn_comps, GL_FLOAT, GL_FALSE, 0, NULL);
 	glEnableVertexAttribArray (2);
 	glBindBuffer (GL_ARRAY_BUFFER, texcoords_vbo);
-	glVertexAttribPointer (2, vt_comps, GL_FLOAT, GL_FALSE, 0, NULL);
+	glVertexAttribPointer (2, mesh_data.vt_comps, GL_FLOAT, GL_FALSE, 0, NULL);
 	if (animation_count > 0) {
 		glEnableVertexAttribArray (3);
 		glBindBuffer (GL_ARRAY_BUFFER, bone_ids_vbo);
-		glVertexAttribPointer (3, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+		// GLSL 1.20 has no integer attributes. small ints convert exactly
+#ifdef APPLE
+		glVertexAttribIPointer (3, APG_BONE_INFLUENCES, GL_UNSIGNED_BYTE, 0,
+			NULL);
+#else
+		glVertexAttribPointer (3, APG_BONE_INFLUENCES, GL_UNSIGNED_BYTE,
+			GL_FALSE, 0, NULL);
+#endif
+		glEnableVertexAttribArray (4);
+		glBindBuffer (GL_ARRAY_BUFFER, bone_weights_vbo);
+		glVertexAttribPointer (4, APG_BONE_INFLUENCES, GL_UNSIGNED_BYTE, GL_TRUE,
+			0, NULL);
+	}
+	// element buffer binding is part of the VAO state
+	if (mesh_data.indices) {
+		size_t index_size = 2;
+		
+		index_count = mesh_data.index_count;
+		if (APG_TYPE_U32 == mesh_data.index_type) {
+			index_type = GL_UNSIGNED_INT;
+			index_size = 4;
+		}
+		glGenBuffers (1, &index_vbo);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, index_vbo);
+		glBufferData (
+			GL_ELEMENT_ARRAY_BUFFER,
+			index_count * index_size,
+			mesh_data.indices,
+			GL_STATIC_DRAW
+		);
+		printf ("%i indices for %i vertices\n", index_count, vert_count);
 	}
 
 	printf ("mesh gpu data created\n");
 	
-	if (vps) {
-		free (vps);
-	}
-	if (vns) {
-		free (vns);
-	}
-	if (vts) {
-		free (vts);
+	// vertex data is on the GPU now. mapped data belongs to the file mapping
+	if (!mesh_data.mapped) {
+		free (mesh_data.vps);
+		free (mesh_data.vns);
+		free (mesh_data.vts);
+		free (mesh_data.vtans);
+		free (mesh_data.vbs);
+		free (mesh_data.vws);
+		free (mesh_data.indices);
+		mesh_data.vps = mesh_data.vns = mesh_data.vts = mesh_data.vtans = NULL;
+		mesh_data.vbs = mesh_data.vws = mesh_data.indices = NULL;
 	}
 	return true;
 }
@@ -666,20 +299,26 @@ bool create_shaders () {
 	"#version 150\n"
 	"in vec3 vp, vn;"
 	"in vec2 vt;"
-	"in float bone_id;"
-	"uniform mat4 P, V, B[32];"
+	"in uvec4 bone_ids;"
+	"in vec4 bone_weights;"
+	"uniform mat4 P, V;"
+	"uniform mat3x4 B[32];"
 	"uniform mat4 bone_mats[16];"
 	"out vec3 n_eye, p_eye, l_pos_eye;"
 	"out vec2 st;"
 	//"flat out float bone_id_f;"
 	"out float bone_id_f;"
 	"void main () {"
-	"  bone_id_f = bone_id;"
+	"  bone_id_f = float (bone_ids.x);"
 	"  p_eye = (V * vec4 (vp, 1.0)).xyz;"
 	"  n_eye = (V * vec4 (vn, 0.0)).xyz;"
 	"  l_pos_eye = (V * vec4 (2.0, 2.0, 15.0, 1.0)).xyz;"
 	"  st = vt;"
-	"  gl_Position = P * V * B[int (bone_id)] * vec4 (vp, 1.0);"
+	"  mat3x4 skin = B[bone_ids.x] * bone_weights.x +"
+	"    B[bone_ids.y] * bone_weights.y + B[bone_ids.z] * bone_weights.z +"
+	"    B[bone_ids.w] * bone_weights.w;"
+	"  vec3 vp_skinned = vec4 (vp, 1.0) * skin;"
+	"  gl_Position = P * V * vec4 (vp_skinned, 1.0);"
 	"}";
 	// * bone_mats[int (bone_id)] *
 	
@@ -712,20 +351,26 @@ bool create_shaders () {
 	"#version 120\n"
 	"attribute vec3 vp, vn;"
 	"attribute vec2 vt;"
-	"attribute float bone_id;"
-	"uniform mat4 P, V, B[32];"
+	"attribute vec4 bone_ids, bone_weights;"
+	"uniform mat4 P, V;"
+	"uniform mat3x4 B[32];"
 	"uniform mat4 bone_mats[16];"
 	"varying vec3 n_eye, p_eye, l_pos_eye;"
 	"varying vec2 st;"
 	//"flat out float bone_id_f;"
 	"varying float bone_id_f;"
 	"void main () {"
-	"  bone_id_f = bone_id;"
+	"  bone_id_f = bone_ids.x;"
 	"  p_eye = (V * vec4 (vp, 1.0)).xyz;"
 	"  n_eye = (V * vec4 (vn, 0.0)).xyz;"
 	"  l_pos_eye = (V * vec4 (2.0, 2.0, 15.0, 1.0)).xyz;"
 	"  st = vt;"
-	"  gl_Position = P * V * B[int (bone_id)] * vec4 (vp, 1.0);"
+	"  mat3x4 skin = B[int (bone_ids.x)] * bone_weights.x +"
+	"    B[int (bone_ids.y)] * bone_weights.y +"
+	"    B[int (bone_ids.z)] * bone_weights.z +"
+	"    B[int (bone_ids.w)] * bone_weights.w;"
+	"  vec3 vp_skinned = vec4 (vp, 1.0) * skin;"
+	"  gl_Position = P * V * vec4 (vp_skinned, 1.0);"
 	"}";
 	// * bone_mats[int (bone_id)] * 
 
@@ -776,7 +421,8 @@ bool create_shaders () {
 	glBindAttribLocation (shader_programme, 0, "vp");
 	glBindAttribLocation (shader_programme, 1, "vn");
 	glBindAttribLocation (shader_programme, 2, "vt");
-	glBindAttribLocation (shader_programme, 3, "bone_id");
+	glBindAttribLocation (shader_programme, 3, "bone_ids");
+	glBindAttribLocation (shader_programme, 4, "bone_weights");
 	glLinkProgram (shader_programme);
 	glGetProgramiv (shader_programme, GL_LINK_STATUS, &params);
 	assert (params == GL_TRUE);
@@ -787,7 +433,7 @@ bool create_shaders () {
 		char name[64];
 		sprintf (name, "B[%i]", i);
 		B_locs[i] = glGetUniformLocation (shader_programme, name);
-		glUniformMatrix4fv (B_locs[i], 1, GL_FALSE, identity_mat4 ().m);
+		glUniformMatrix3x4fv (B_locs[i], 1, GL_FALSE, identity_mat3x4 ().m);
 	}
 
 #ifdef APPLE
@@ -1010,10 +656,8 @@ GLuint load_texture (const char* file_name) {
 
 int main (int argc, char** argv) {
 	mat4 P, V;
-	double dur = 0.0;
 	float bpoints = 0.0f;
 	double previous_seconds;
-	double anim_timer = 0.0;
 	GLuint bpoints_vbo = 0;
 	GLuint bpoints_vao = 0;
 	
@@ -1052,9 +696,6 @@ int main (int argc, char** argv) {
 	
 	print_all_keys ();
 	
-	if (animation_count > 0) {
-		dur = animations[0].duration;
-	}
 	glClearColor (0.0, 0.0, 0.0, 1.0);
 	glDepthFunc (GL_LESS);
 	previous_seconds = glfwGetTime ();
@@ -1064,10 +705,6 @@ int main (int argc, char** argv) {
 		current_seconds = glfwGetTime ();
 		elapsed_seconds = current_seconds - previous_seconds;
 		previous_seconds = current_seconds;
-		anim_timer += elapsed_seconds;
-		if (anim_timer > dur) {
-			anim_timer = 0.0;
-		}
 		glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glEnable (GL_DEPTH_TEST);
 		if (animation_count > 0) {
@@ -1077,20 +714,13 @@ int main (int argc, char** argv) {
 				glUniformMatrix4fv (V_loc, 1, GL_FALSE, V.m);
 			}
 			
-			// anim update
-			_recurse_anim_tree (
-				animations,
-				anim_timer,
-				0,
-				identity_mat4 ()
-			);
-			//printf ("0 and 1 of %i\n", bone_count);
-			//print (current_bone_mats[0]);
-			//print (current_bone_mats[1]);
-			glUniformMatrix4fv (B_locs[0], bone_count, GL_FALSE,
-				current_bone_mats[0].m);
+			// anim update. loops the clip
+			apg_update_crowd (&crowd, elapsed_seconds);
+			// rows of a mat3x4 are the columns of GLSL's mat3x4, so no transpose
+			glUniformMatrix3x4fv (B_locs[0], bone_count, GL_FALSE,
+				apg_crowd_palette (&crowd, 0)[0].m);
 			glBindVertexArray (vao);
-			glDrawArrays (GL_TRIANGLES, 0, vert_count);
+			draw_mesh ();
 			glDisable (GL_DEPTH_TEST);
 			glEnable (GL_PROGRAM_POINT_SIZE);
 			glUseProgram (psp);
@@ -1112,7 +742,7 @@ int main (int argc, char** argv) {
 				glUniformMatrix4fv (no_skin_V_loc, 1, GL_FALSE, V.m);
 			}
 			glBindVertexArray (vao);
-			glDrawArrays (GL_TRIANGLES, 0, vert_count);
+			draw_mesh ();
 		}
 		cam_dirty = false;
 		glfwPollEvents ();
@@ -1120,6 +750,16 @@ int main (int argc, char** argv) {
 		if (GLFW_PRESS == glfwGetKey (window, GLFW_KEY_ESCAPE)) {
 			glfwSetWindowShouldClose (window, 1);
 		}
+		// 1, 2 and 3 pick slerp, nlerp or corrected nlerp for rotations
+		if (GLFW_PRESS == glfwGetKey (window, GLFW_KEY_1)) {
+			apg_set_rot_interp (APG_ROT_SLERP);
+		}
+		if (GLFW_PRESS == glfwGetKey (window, GLFW_KEY_2)) {
+			apg_set_rot_interp (APG_ROT_NLERP);
+		}
+		if (GLFW_PRESS == glfwGetKey (window, GLFW_KEY_3)) {
+			apg_set_rot_interp (APG_ROT_NLERP_CORRECTED);
+		}
 	} // endwhile
 	glfwTerminate();
 	